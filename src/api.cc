@@ -20,6 +20,7 @@
  */
 
 #include "api.h"
+#include "version.h" // CASPER_INOTIFY_NAME
 
 #include <string.h> // strerror
 
@@ -35,9 +36,33 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+// syscall
+#include <sys/syscall.h>
+
 // fcntl
 #include <fcntl.h>
 
+// socketpair, send, recv
+#include <sys/socket.h>
+
+// sockaddr_un
+#include <sys/un.h>
+
+// epoll_create1, epoll_ctl, epoll_wait
+#include <sys/epoll.h>
+
+// eventfd
+#include <sys/eventfd.h>
+
+// signalfd
+#include <sys/signalfd.h>
+
+// timerfd
+#include <sys/timerfd.h>
+
+// waitpid
+#include <sys/wait.h>
+
 // getpwnam
 #include <sys/types.h>
 #include <pwd.h>
@@ -45,18 +70,31 @@
 // initgroups
 #include <grp.h>
 
-// fnmatch
-#include <fnmatch.h>
+// DT_DIR, DT_UNKNOWN
+#include <dirent.h>
+
+// fanotify_init, fanotify_mark
+#include <sys/fanotify.h>
+
+// statfs
+#include <sys/vfs.h>
 
 #include "json/json.h"
 
 #include <fstream>
 #include <streambuf>
 #include <chrono> // std::chrono
+#include <algorithm> // std::max
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <signal.h>
 
+// pthread_setaffinity_np
+#include <pthread.h>
+
 // https://man7.org/linux/man-pages/man7/inotify.7.html
 
 const std::map<uint32_t, const casper::inotify::API::FieldInfo> casper::inotify::API::sk_field_id_to_name_map_ {
@@ -105,6 +143,33 @@ const std::map<std::string, uint32_t> casper::inotify::API::sk_field_key_to_id_m
     
 };
 
+const casper::inotify::API::ActionInfo casper::inotify::API::sk_actions_[] = {
+    { IN_OPEN                      , "open"     },
+    { IN_CLOSE                     , "closed"   },
+    { IN_ACCESS                    , "accessed" },
+    { IN_CREATE                    , "created"  },
+    { IN_MODIFY                    , "modified" },
+    { IN_DELETE | IN_DELETE_SELF   , "deleted"  },
+    { IN_MOVE                      , "renamed"  },
+    { IN_IGNORED                   , "ignored"  },
+    { 0                            , nullptr    }
+};
+
+const char* const casper::inotify::API::sk_variables_[] = {
+    "CASPER_INOTIFY_EVENT",
+    "CASPER_INOTIFY_OBJECT",
+    "CASPER_INOTIFY_NAME",
+    "CASPER_INOTIFY_PARENT_NAME",
+    "CASPER_INOTIFY_OLD_NAME",
+    "CASPER_INOTIFY_DATETIME",
+    "CASPER_INOTIFY_HOSTNAME",
+    "CASPER_INOTIFY_MSG",
+    "CASPER_INOTIFY_CMD"
+};
+
+thread_local struct casper::inotify::API::_Render casper::inotify::API::render_;
+thread_local struct casper::inotify::API::_Clock  casper::inotify::API::clock_;
+
 #define LOGGER_COLOR_PREFIX "\e"
 
 #define LOGGER_RESET_ATTRS        LOGGER_COLOR_PREFIX "[0m"
@@ -140,9 +205,36 @@ const std::map<std::string, uint32_t> casper::inotify::API::sk_field_key_to_id_m
 #define LOGGER_FAIL_SYMBOL    "✕"
 #define LOGGER_WARNING_SYMBOL "⚠︎"
 
+#define API_LOG_LINE_MAX_LENGTH                1024
+#define API_DEFAULT_LOG_FLUSH_INTERVAL_MS      50
+
 #define API_DEFAULT_SHELL "/bin/sh"
 #define API_DEFAULT_PATH  "/usr/bin:/usr/local/bin"
 
+#define API_DEFAULT_MAX_CONCURRENT 64
+#define API_DEFAULT_MAX_PENDING    4096
+
+#define API_DEFAULT_POOL_WORKERS   4
+#define API_POOL_MESSAGE_MAX_SIZE  ( 64 * 1024 )
+#define API_POOL_RESTART_MIN_MS    250   // delay before restarting a worker that failed to start, doubled on each failure
+#define API_POOL_RESTART_MAX_MS    30000 // ... up to this
+
+#define API_TIMER_TICK_MS          10
+#define API_TIMER_WHEEL_SLOTS      512
+#define API_MOVE_EXPIRY_MS         20 // IN_MOVED_FROM not followed by it's IN_MOVED_TO within this window is a deletion
+
+#define API_FANOTIFY_WD              0 // fanotify entries have no watch descriptor
+#define API_FANOTIFY_EVENTS          ( FAN_ACCESS | FAN_MODIFY | FAN_ATTRIB | FAN_CLOSE | FAN_OPEN | FAN_MOVE | FAN_CREATE | FAN_DELETE | FAN_DELETE_SELF | FAN_MOVE_SELF )
+#define API_FANOTIFY_BUFFER_SIZE     ( 64 * 1024 )
+#define API_FANOTIFY_PATHS_MAX       4096
+
+#define API_DEFAULT_METRICS_INTERVAL_MS 15000
+#define API_METRICS_SEND_TIMEOUT_MS     1000
+#define API_METRICS_MAX_CLIENTS         64
+
+#define API_DEFAULT_SCAN_THREADS_MAX 8
+#define API_SCAN_BUFFER_SIZE         ( 64 * 1024 )
+
 #define DEBUG_LEVEL_BASIC 1
 #define DEBUG_LEVEL_TRACE 2
 
@@ -164,10 +256,38 @@ const std::map<std::string, uint32_t> casper::inotify::API::sk_field_key_to_id_m
 casper::inotify::API::API ()
 {
     pid_         = getpid();
-    inotify_     = { -1, { 0 } };
-    log_         = { "", nullptr, API::LogLevel::_Event, 0, { 0 } };
+    fanotify_.fd_       = -1;
+    reactor_.fd_        = -1;
+    reactor_.wake_fd_   = -1;
+    reactor_.signal_fd_ = -1;
+    sigemptyset(&reactor_.signals_);
+    CPU_ZERO(&reactor_.affinity_);
+    log_         = { "", API::LogLevel::_Event, 0, API_DEFAULT_LOG_FLUSH_INTERVAL_MS };
+    timestamp_   = { 0, false };
     owner_       = { std::numeric_limits<uid_t>::max(), "", std::numeric_limits<gid_t>::max(), "", ( S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH ), { 0 } };
     quit_        = false;
+    halt_        = false;
+    reloading_   = nullptr;
+    limits_      = { API_DEFAULT_MAX_CONCURRENT, API_DEFAULT_MAX_PENDING };
+    children_.dropped_   = 0;
+    children_.launching_ = 0;
+    restarts_          = 0;
+    defaults_.max_concurrent_ = 0;
+    defaults_.workers_        = API_DEFAULT_POOL_WORKERS;
+    defaults_.debounce_ms_    = 0;
+    defaults_.reconcile_      = false;
+    stats_.overflows_         = 0;
+    stats_.reconciled_        = 0;
+    metrics_.interval_ms_     = API_DEFAULT_METRICS_INTERVAL_MS;
+    metrics_.entries_         = true;
+    metrics_.timer_fd_        = -1;
+    metrics_.socket_fd_       = -1;
+    defaults_.sink_           = "command";
+    sink_                     = { "", Stream::Format::_Binary, STREAM_DEFAULT_CAPACITY, Stream::Policy::_Drop, { "", RING_DEFAULT_SLOTS, RING_DEFAULT_SLOT_SIZE } };
+    journaling_               = { "", JOURNAL_DEFAULT_SEGMENT_SIZE, JOURNAL_DEFAULT_SEGMENTS, JOURNAL_DEFAULT_SYNC_INTERVAL_MS };
+    replay_                   = { false, 0, 0 };
+    handlers_                 = { PLUGINS_DEFAULT_THREADS, PLUGINS_DEFAULT_CAPACITY };
+    defaults_.scan_threads_   = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), API_DEFAULT_SCAN_THREADS_MAX));
 }
 
 /**
@@ -183,13 +303,16 @@ casper::inotify::API::~API ()
 /**
  * @brief Initialize instance.
  *
- * @param a_level One of \link API::LogLevel \link.
- * @param a_uri   Log file URI.
+ * @param a_level   One of \link API::LogLevel \link.
+ * @param a_uri     Log file URI.
+ * @param a_signals Signals blocked by the caller that should be handled on main loop.
  */
-void casper::inotify::API::Init (const LogLevel a_level, const std::string& a_uri)
+void casper::inotify::API::Init (const LogLevel a_level, const std::string& a_uri, const sigset_t& a_signals)
 {
     Unload();
     Open(a_uri, /* a_recycled */ false);
+    reactor_.signals_ = a_signals;
+    (void)sched_getaffinity(0, sizeof(reactor_.affinity_), &reactor_.affinity_);
     // ...
     owner_.hostname_[0] = '\0';
     if ( -1 == gethostname(owner_.hostname_, sizeof(owner_.hostname_) / sizeof(owner_.hostname_[0])) ) {
@@ -236,6 +359,7 @@ void casper::inotify::API::Load (const std::string& a_uri)
     };
     // ... log ...
     Log(API::LogLevel::_Info, "Loading '%s'...", a_uri.c_str());
+    config_ = a_uri;
     // ... log fields ...
     Log(API::LogLevel::_Debug, API::sk_field_id_to_name_map_);
     // ...
@@ -256,11 +380,175 @@ void casper::inotify::API::Load (const std::string& a_uri)
         }
     }
     // ... set defaults ...
-    defaults_.user_ = obj["user"].asString();
-    if ( true == obj.isMember("command") ) {
-        defaults_.command_ = obj["command"].asString();
-    }
+    defaults_.user_    = obj["user"].asString();
+    defaults_.command_ = obj.get("command", "").asString();
     defaults_.message_ = obj.get("message", "CASPER-INOTIFY :: WARNING :: ${CASPER_INOTIFY_NAME} ${CASPER_INOTIFY_OBJECT} was ${CASPER_INOTIFY_EVENT} @ ${CASPER_INOTIFY_HOSTNAME} [ ${CASPER_INOTIFY_DATETIME} ]").asString();
+    // ... concurrency limits ...
+    {
+        const Json::Value& limits = obj.get("limits", Json::Value::null);
+        limits_.max_concurrent_     = static_cast<size_t>(limits.get("max_concurrent", API_DEFAULT_MAX_CONCURRENT).asUInt());
+        limits_.max_pending_        = static_cast<size_t>(limits.get("max_pending", API_DEFAULT_MAX_PENDING).asUInt());
+        defaults_.max_concurrent_   = static_cast<size_t>(limits.get("max_concurrent_per_entry", 0).asUInt());
+    }
+    // ... persistent workers ...
+    {
+        const Json::Value& pool = obj.get("pool", Json::Value::null);
+        defaults_.executor_ = obj.get("executor", "process").asString();
+        defaults_.workers_  = static_cast<size_t>(pool.get("workers", API_DEFAULT_POOL_WORKERS).asUInt());
+        if ( 0 == defaults_.workers_ ) {
+            throw inotify::Exception("Invalid number of pool workers!");
+        }
+    }
+    // ... recursive watches ...
+    {
+        const Json::Value& scan = obj.get("scan", Json::Value::null);
+        defaults_.scan_threads_ = static_cast<size_t>(scan.get("threads", static_cast<Json::UInt>(defaults_.scan_threads_)).asUInt());
+        if ( 0 == defaults_.scan_threads_ ) {
+            throw inotify::Exception("Invalid number of scan threads!");
+        }
+    }
+    // ... snapshots, to recover from queue overflows ...
+    defaults_.reconcile_ = obj.get("reconcile", false).asBool();
+    // ... inotify instances, each drained by it's own thread ...
+    {
+        const Json::Value& shards = obj.get("shards", Json::Value::null);
+        const size_t       count  = static_cast<size_t>(shards.get("count", 1).asUInt());
+        if ( 0 == count ) {
+            throw inotify::Exception("Invalid number of shards!");
+        }
+        const Json::Value& cpus = shards.get("cpus", Json::Value::null);
+        // ... running shards are kept, entries must keep hashing to the same ones ...
+        if ( 0 != shards_.size() && count != shards_.size() ) {
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " number of shards changed from %zu to %zu, a restart is required to apply it!",
+                shards_.size(), count
+            );
+        }
+        const size_t target = ( 0 == shards_.size() ? count : shards_.size() );
+        while ( shards_.size() < target ) {
+            API::Shard* shard = new API::Shard();
+            shard->index_       = shards_.size();
+            shard->fd_          = -1;
+            shard->buffer_.resize(IN_BUFFER_MAX_LENGTH);
+            shard->timers_.fd_  = -1;
+            shard->timers_.tick_ = 0;
+            shard->epoll_fd_    = -1;
+            shard->wake_fd_     = -1;
+            shard->cpu_         = ( shard->index_ < cpus.size() ? cpus[static_cast<Json::ArrayIndex>(shard->index_)].asInt() : -1 );
+            shard->thread_      = nullptr;
+            shards_.push_back(shard);
+        }
+    }
+    // ... log ...
+    log_.flush_interval_ms_ = static_cast<uint32_t>(obj.get("log", Json::Value::null).get("flush_interval_ms", API_DEFAULT_LOG_FLUSH_INTERVAL_MS).asUInt());
+    logger_.SetFlushInterval(log_.flush_interval_ms_);
+    // ... timestamps ...
+    {
+        const Json::Value& timestamp = obj.get("timestamp", Json::Value::null);
+        const std::string  precision = timestamp.get("precision", "s").asString();
+        if ( 0 == precision.compare("s") ) {
+            timestamp_.precision_ = 0;
+        } else if ( 0 == precision.compare("ms") ) {
+            timestamp_.precision_ = 3;
+        } else if ( 0 == precision.compare("us") ) {
+            timestamp_.precision_ = 6;
+        } else {
+            throw inotify::Exception("Invalid timestamp precision '%s', expecting 's', 'ms' or 'us'!", precision.c_str());
+        }
+        const std::string timezone = timestamp.get("timezone", "utc").asString();
+        if ( 0 == timezone.compare("utc") ) {
+            timestamp_.local_ = false;
+        } else if ( 0 == timezone.compare("local") ) {
+            timestamp_.local_ = true;
+        } else {
+            throw inotify::Exception("Invalid timestamp timezone '%s', expecting 'utc' or 'local'!", timezone.c_str());
+        }
+    }
+    // ... coalescing window ...
+    defaults_.debounce_ms_ = static_cast<size_t>(obj.get("debounce_ms", 0).asUInt());
+    // ... metrics ...
+    {
+        const Json::Value& metrics = obj.get("metrics", Json::Value::null);
+        metrics_.file_        = metrics.get("file", "").asString();
+        metrics_.socket_      = metrics.get("socket", "").asString();
+        metrics_.interval_ms_ = static_cast<size_t>(metrics.get("interval_ms", API_DEFAULT_METRICS_INTERVAL_MS).asUInt());
+        metrics_.entries_     = metrics.get("entries", true).asBool();
+        if ( 0 == metrics_.interval_ms_ ) {
+            throw inotify::Exception("Invalid metrics interval!");
+        }
+        if ( metrics_.socket_.length() >= sizeof(((struct sockaddr_un*)nullptr)->sun_path) ) {
+            throw inotify::Exception("Metrics socket path '%s' is too long!", metrics_.socket_.c_str());
+        }
+    }
+    // ... events stream ...
+    {
+        defaults_.sink_ = obj.get("sink", "command").asString();
+        const Json::Value& stream = obj.get("stream", Json::Value::null);
+        sink_.socket_   = stream.get("socket", "").asString();
+        sink_.capacity_ = static_cast<size_t>(stream.get("queue", STREAM_DEFAULT_CAPACITY).asUInt());
+        if ( 0 == sink_.capacity_ ) {
+            throw inotify::Exception("Invalid stream queue size!");
+        }
+        const std::string format = stream.get("format", "binary").asString();
+        if ( 0 == format.compare("binary") ) {
+            sink_.format_ = Stream::Format::_Binary;
+        } else if ( 0 == format.compare("json") ) {
+            sink_.format_ = Stream::Format::_JSON;
+        } else {
+            throw inotify::Exception("Invalid stream format '%s', expecting 'binary' or 'json'!", format.c_str());
+        }
+        const std::string policy = stream.get("policy", "drop").asString();
+        if ( 0 == policy.compare("drop") ) {
+            sink_.policy_ = Stream::Policy::_Drop;
+        } else if ( 0 == policy.compare("disconnect") ) {
+            sink_.policy_ = Stream::Policy::_Disconnect;
+        } else {
+            throw inotify::Exception("Invalid stream policy '%s', expecting 'drop' or 'disconnect'!", policy.c_str());
+        }
+        const Json::Value& ring = obj.get("ring", Json::Value::null);
+        sink_.ring_.socket_    = ring.get("socket", "").asString();
+        sink_.ring_.slots_     = static_cast<size_t>(ring.get("slots", RING_DEFAULT_SLOTS).asUInt());
+        sink_.ring_.slot_size_ = static_cast<size_t>(ring.get("slot_size", RING_DEFAULT_SLOT_SIZE).asUInt());
+        if ( sink_.ring_.slots_ < 2 || sink_.ring_.slots_ > ( 1u << 24 ) || 0 != ( sink_.ring_.slots_ & ( sink_.ring_.slots_ - 1 ) ) ) {
+            throw inotify::Exception("Invalid ring slots %zu, expecting a power of two between 2 and %u!", sink_.ring_.slots_, 1u << 24);
+        }
+        if ( sink_.ring_.slot_size_ < 128 || sink_.ring_.slot_size_ > 65536 || 0 != ( sink_.ring_.slot_size_ % 64 ) ) {
+            throw inotify::Exception("Invalid ring slot size %zu, expecting a multiple of 64 between 128 and 65536!", sink_.ring_.slot_size_);
+        }
+    }
+    // ... events journal ...
+    {
+        const Json::Value& journal = obj.get("journal", Json::Value::null);
+        journaling_.directory_    = journal.get("directory", "").asString();
+        journaling_.segment_size_ = static_cast<size_t>(journal.get("segment_size", JOURNAL_DEFAULT_SEGMENT_SIZE).asUInt());
+        journaling_.segments_     = static_cast<size_t>(journal.get("segments", JOURNAL_DEFAULT_SEGMENTS).asUInt());
+        journaling_.interval_ms_  = static_cast<size_t>(journal.get("sync_interval_ms", JOURNAL_DEFAULT_SYNC_INTERVAL_MS).asUInt());
+        if ( journaling_.segment_size_ < ( 1u << 20 ) || journaling_.segment_size_ > ( 1u << 30 ) || 0 != ( journaling_.segment_size_ % 4096 ) ) {
+            throw inotify::Exception("Invalid journal segment size %zu, expecting a multiple of 4096 between %u and %u!", journaling_.segment_size_, 1u << 20, 1u << 30);
+        }
+        if ( journaling_.segments_ < 2 ) {
+            throw inotify::Exception("Invalid journal segments %zu, expecting at least 2!", journaling_.segments_);
+        }
+        if ( 0 == journaling_.interval_ms_ ) {
+            throw inotify::Exception("Invalid journal sync interval!");
+        }
+    }
+    // ... handler plugins threads ...
+    {
+        const Json::Value& plugins = obj.get("plugins", Json::Value::null);
+        handlers_.threads_  = static_cast<size_t>(plugins.get("threads", PLUGINS_DEFAULT_THREADS).asUInt());
+        handlers_.capacity_ = static_cast<size_t>(plugins.get("queue", PLUGINS_DEFAULT_CAPACITY).asUInt());
+        if ( 0 == handlers_.threads_ || handlers_.threads_ > 64 ) {
+            throw inotify::Exception("Invalid plugins threads %zu, expecting 1 to 64!", handlers_.threads_);
+        }
+        if ( 0 == handlers_.capacity_ ) {
+            throw inotify::Exception("Invalid plugins queue size!");
+        }
+    }
+    // ... what entries inherit ...
+    defaults_.key_ = defaults_.user_ + '\0' + defaults_.message_ + '\0' + defaults_.command_ + '\0' + defaults_.executor_
+                   + '\0' + std::to_string(defaults_.max_concurrent_) + '\0' + std::to_string(defaults_.workers_)
+                   + '\0' + std::to_string(defaults_.debounce_ms_) + '\0' + std::to_string(defaults_.reconcile_)
+                   + '\0' + defaults_.sink_;
     // ... load entries
     {
         const Json::Value dummy_string = "";
@@ -285,6 +573,8 @@ void casper::inotify::API::Load (const std::string& a_uri)
         {
             const Json::Value& files = obj.get("files", Json::Value::null);
             if ( false == files.isNull() && files.size() > 0 ) {
+                // ... one helper per directory ( and shard ), shared by all files in it ...
+                std::unordered_set<std::string> helpers;
                 for ( Json::ArrayIndex idx = 0 ; idx < files.size() ; ++idx ) {
                     const Json::Value& uri = files[idx].get("uri", Json::Value::null);
                     if ( true == uri.isNull() ) {
@@ -298,7 +588,7 @@ void casper::inotify::API::Load (const std::string& a_uri)
                         mask = mask | IN_DELETE_SELF;
                     }
                     // ... special case(s):
-                    if ( mask & IN_MODIFY ) {
+                    if ( ( mask & IN_MODIFY ) && 0 != files[idx].get("backend", "inotify").asString().compare("fanotify") ) {
                         const std::string tmp = uri.asString();
                         // ... also watch directory ...
                         std::string directory;
@@ -308,9 +598,12 @@ void casper::inotify::API::Load (const std::string& a_uri)
                         } else {
                             continue;
                         }
-                        Add(API::Type::_Directory, files[idx], directory, IN_CREATE,
-                                std::bind(&API::Handler, this, std::placeholders::_1, std::placeholders::_2)
-                        );
+                        const std::string helper = directory + '\0' + ( true == files[idx].isMember("shard") ? std::to_string(files[idx]["shard"].asUInt()) : "" );
+                        if ( true == helpers.insert(helper).second ) {
+                            Add(API::Type::_Directory, files[idx], directory, IN_CREATE,
+                                    std::bind(&API::Handler, this, std::placeholders::_1, std::placeholders::_2)
+                            );
+                        }
                     }
                     // ...
                     Add(API::Type::_File, files[idx], uri.asString(), mask);
@@ -327,14 +620,75 @@ int casper::inotify::API::Watch ()
 {
     // ... log ...
     Log(API::LogLevel::_Info, "%s...", "Initializing");
-    // ... initialize ...
-    inotify_.fd_ = inotify_init();
-    if ( inotify_.fd_ < 0 ) {
-        // ... report error ...
-        throw inotify::Exception("An error occurred while initializing library: %d - %s",
+    // ... initialize, one inotify instance per shard ...
+    for ( auto shard : shards_ ) {
+        shard->fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if ( shard->fd_ < 0 ) {
+            // ... report error ...
+            throw inotify::Exception("An error occurred while initializing library: %d - %s",
+                                     errno, strerror(errno)
+            );
+        }
+        shard->timers_.fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if ( shard->timers_.fd_ < 0 ) {
+            throw inotify::Exception("An error occurred while creating timerfd: %d - %s",
+                                     errno, strerror(errno)
+            );
+        }
+        shard->timers_.tick_ = 0;
+        shard->timers_.wheel_.clear();
+        shard->timers_.wheel_.resize(API_TIMER_WHEEL_SLOTS);
+        // ... shard #0 is drained by main loop ...
+        if ( 0 == shard->index_ ) {
+            continue;
+        }
+        shard->epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        shard->wake_fd_  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( shard->epoll_fd_ < 0 || shard->wake_fd_ < 0 ) {
+            throw inotify::Exception("An error occurred while creating shard #%zu reactor: %d - %s",
+                                     shard->index_, errno, strerror(errno)
+            );
+        }
+        for ( const int fd : { shard->fd_, shard->timers_.fd_, shard->wake_fd_ } ) {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events  = EPOLLIN;
+            ev.data.fd = fd;
+            if ( -1 == epoll_ctl(shard->epoll_fd_, EPOLL_CTL_ADD, fd, &ev) ) {
+                throw inotify::Exception("An error occurred while registering fd %d with shard #%zu epoll: %d - %s",
+                                         fd, shard->index_, errno, strerror(errno)
+                );
+            }
+        }
+    }
+    // ... reactor ...
+    reactor_.fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if ( reactor_.fd_ < 0 ) {
+        throw inotify::Exception("An error occurred while creating epoll instance: %d - %s",
+                                 errno, strerror(errno)
+        );
+    }
+    reactor_.wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ( reactor_.wake_fd_ < 0 ) {
+        throw inotify::Exception("An error occurred while creating eventfd: %d - %s",
                                  errno, strerror(errno)
         );
     }
+    reactor_.signal_fd_ = signalfd(-1, &reactor_.signals_, SFD_NONBLOCK | SFD_CLOEXEC);
+    if ( reactor_.signal_fd_ < 0 ) {
+        throw inotify::Exception("An error occurred while creating signalfd: %d - %s",
+                                 errno, strerror(errno)
+        );
+    }
+    for ( const int fd : { shards_[0]->fd_, reactor_.wake_fd_, reactor_.signal_fd_, shards_[0]->timers_.fd_ } ) {
+        Attach(fd);
+    }
+    // ... command workers ...
+    for ( auto& it : pools_ ) {
+        for ( size_t idx = 0 ; idx < it.second.workers_.size() ; ++idx ) {
+            Fork(it.second, idx);
+        }
+    }
     // ... log ...
     Log(API::LogLevel::_Info, "%s...", "Registering");
     // ... register & track ...
@@ -349,6 +703,39 @@ int casper::inotify::API::Watch ()
             log_.entry_ml_ = entry->uri_.length();
         }
     }
+    // ... entries on the same object share a watch ...
+    {
+        size_t watched = 0;
+        size_t watches = 0;
+        for ( auto shard : shards_ ) {
+            for ( auto watch : shard->watches_ ) {
+                if ( nullptr != watch ) {
+                    watched += watch->entries_.size();
+                    watches++;
+                }
+            }
+        }
+        Log(API::LogLevel::_Info, "%zu entries on %zu watch(es)", watched, watches);
+    }
+    // ... watch subdirectories of recursive entries and take snapshots ...
+    for ( size_t idx = 0 ; idx < entries_.all_.size() ; ++idx ) {
+        API::Entry* entry = entries_.all_[idx];
+        if ( true == entry->recursive_ && -1 != entry->wd_ ) {
+            Descend(entry, /* a_synthesize */ false);
+        }
+        if ( true == entry->reconcile_ && -1 != entry->wd_ ) {
+            List(*entry, entry->snapshot_);
+        }
+    }
+    // ... metrics file and / or socket, events stream ...
+    Expose();
+    Listen();
+    // ... dispatch journaled events again, before new ones ...
+    if ( true == replay_.enabled_ ) {
+        Replay();
+    }
+    // ... other shards are drained by their own threads ...
+    Resume();
     // ... log ...
     Log(entries_);
     Log(API::LogLevel::_Info, "%s...", "Ready");
@@ -372,10 +759,20 @@ int casper::inotify::API::Watch ()
         }
     }
     Log(API::LogLevel::_Info, "%s...", "Gone");
-    // ... unregister ...
-    for ( auto& it : entries_.good_ ) {
-        if ( true == Unregister(it.second) ) {
-            // ... TODO: report error
+    // ... stop shards threads ...
+    Join();
+    // ... unregister, subdirectories watches are released when inotify fd is closed ...
+    for ( auto shard : shards_ ) {
+        for ( auto watch : shard->watches_ ) {
+            if ( nullptr == watch || nullptr != watch->entries_[0]->root_ ) {
+                continue;
+            }
+            // ... one watch for all of it's entries ...
+            if ( true == Unregister(watch->entries_[0]) ) {
+                for ( auto entry : watch->entries_ ) {
+                    entry->wd_ = -1;
+                }
+            }
         }
     }
     // ... clean up  ...
@@ -389,56 +786,445 @@ int casper::inotify::API::Watch ()
  */
 void casper::inotify::API::Unload ()
 {
-    // ... clean entries ...
-    for ( auto& entry : entries_.all_ ) {
-        if ( -1 != entry->wd_ ) {
-            inotify_rm_watch(inotify_.fd_, entry->wd_);
+    // ... shards threads first, they might be using everything else ...
+    Join();
+    // ... handle events already queued for plugins, they are shut down along with their entries ...
+    plugins_.Stop();
+    // ... forget children, entries they refer to are about to be released ...
+    for ( const auto& it : children_.running_ ) {
+        children_.untracked_.insert(it.first);
+    }
+    children_.running_.clear();
+    children_.pending_.clear();
+    // ... release workers, they exit when their socket is closed ...
+    for ( auto& it : pools_ ) {
+        for ( auto& worker : it.second.workers_ ) {
+            if ( -1 != worker.fd_ ) {
+                close(worker.fd_);
+            }
         }
+    }
+    pools_.clear();
+    workers_.clear();
+    restarts_ = 0;
+    // ... clean entries, their watches are shared and released when inotify instances are closed ...
+    for ( auto& entry : entries_.all_ ) {
         delete entry;
     }
     entries_.all_.clear();
-    entries_.good_.clear();
+    for ( auto& entry : entries_.retired_ ) {
+        delete entry;
+    }
+    entries_.retired_.clear();
     entries_.bad_.clear();
     entries_.uris_.directories_.clear();
     entries_.uris_.files_.clear();
-    // ... clean inotify ...
-    if ( -1 != inotify_.fd_ ) {
-        close(inotify_.fd_);
-        inotify_.fd_ = -1;
-    }
-    // ... close log file ...
-    if ( nullptr != log_.fp_ ) {
-        fflush(log_.fp_);
-        if ( stdout != log_.fp_ ) {
-            fclose(log_.fp_);
+    credentials_.clear();
+    // ... clean shards: inotify, subdirectories entries, coalesced events and reactor ...
+    for ( auto shard : shards_ ) {
+        for ( auto& it : shard->derived_ ) {
+            delete it.second;
         }
-        log_.fp_ = nullptr;
+        for ( auto watch : shard->watches_ ) {
+            delete watch;
+        }
+        for ( const int fd : { shard->fd_, shard->timers_.fd_, shard->epoll_fd_, shard->wake_fd_ } ) {
+            if ( -1 != fd ) {
+                close(fd);
+            }
+        }
+        delete shard;
+    }
+    shards_.clear();
+    // ... clean fanotify, marks are released with it's group ...
+    for ( auto& it : fanotify_.mounts_ ) {
+        close(it.second);
+    }
+    fanotify_.mounts_.clear();
+    fanotify_.entries_.clear();
+    fanotify_.paths_.clear();
+    if ( -1 != fanotify_.fd_ ) {
+        close(fanotify_.fd_);
+        fanotify_.fd_ = -1;
+    }
+    // ... clean reactor ...
+    if ( -1 != reactor_.fd_ ) {
+        close(reactor_.fd_);
+        reactor_.fd_ = -1;
+    }
+    if ( -1 != reactor_.wake_fd_ ) {
+        close(reactor_.wake_fd_);
+        reactor_.wake_fd_ = -1;
+    }
+    if ( -1 != reactor_.signal_fd_ ) {
+        close(reactor_.signal_fd_);
+        reactor_.signal_fd_ = -1;
     }
+    // ... disconnect stream subscribers and ring readers, flush journal ...
+    stream_.Close();
+    ring_.Close();
+    journal_.Close();
+    // ... clean metrics ...
+    if ( -1 != metrics_.timer_fd_ ) {
+        close(metrics_.timer_fd_);
+        metrics_.timer_fd_ = -1;
+    }
+    if ( -1 != metrics_.socket_fd_ ) {
+        close(metrics_.socket_fd_);
+        (void)unlink(metrics_.bound_.c_str());
+        metrics_.socket_fd_ = -1;
+    }
+    Timeout(/* a_all */ true);
+    // ... write pending lines and close log file ...
+    logger_.Close();
 }
 
 /**
- * @brief Handle signals.
+ * @brief Handle signals, called from main loop when signalfd is readable.
  *
  * @param a_sig_no Signal number to process.
  */
 void casper::inotify::API::OnSignal (const int a_sig_no)
 {
+    // ... reap children ...
+    if ( SIGCHLD == a_sig_no ) {
+        Reap();
+        return;
+    }
     // ... log ...
     syslog(LOG_NOTICE, "Signal ( %d ) %s...", a_sig_no, strsignal(a_sig_no));
     if ( SIGUSR1 == a_sig_no ) {
         // ... recycle log if a log file is open ...
-        if ( nullptr != log_.fp_ ) {
+        if ( true == logger_.IsOpen() ) {
             // ... re-open log file ...
             Open(log_.uri_, /* a_recycled */ true);
         }
+    } else if ( SIGHUP == a_sig_no ) {
+        // ... apply configuration changes, without a restart ...
+        Reload();
     } else if ( SIGQUIT == a_sig_no || SIGTERM == a_sig_no ) {
-        quit_ = true;
+        // ... make sure whatever was logged so far hits the disk ...
+        logger_.Flush();
+        Stop();
     } else {
         syslog(LOG_NOTICE, "Signal %d vs %d vs %d...", a_sig_no, SIGQUIT, SIGTERM);
         syslog(LOG_NOTICE, "Signal ignored...");
     }
 }
 
+/**
+ * @brief Request main loop to stop.
+ *
+ * @note Async-signal-safe and thread-safe: only sets a flag and writes to an eventfd.
+ */
+void casper::inotify::API::Stop ()
+{
+    const uint64_t one = 1;
+    quit_ = true;
+    if ( -1 != reactor_.wake_fd_ ) {
+        (void)write(reactor_.wake_fd_, &one, sizeof(one));
+    }
+    for ( auto shard : shards_ ) {
+        if ( -1 != shard->wake_fd_ ) {
+            (void)write(shard->wake_fd_, &one, sizeof(one));
+        }
+    }
+}
+
+/**
+ * @brief Dispatch journaled events again, once configuration is loaded and before new events are read.
+ *
+ * @param a_sequence  First record to dispatch, 0 to select by timestamp only.
+ * @param a_timestamp Records older than this, in nanoseconds since epoch, are not dispatched.
+ *
+ * @note Must be called before \link API::Watch \link.
+ */
+void casper::inotify::API::Rewind (const uint64_t a_sequence, const uint64_t a_timestamp)
+{
+    replay_ = { true, a_sequence, a_timestamp };
+}
+
+/**
+ * @brief Stop and wait for all shards threads.
+ */
+void casper::inotify::API::Join ()
+{
+    for ( auto shard : shards_ ) {
+        if ( nullptr == shard->thread_ ) {
+            continue;
+        }
+        if ( false == quit_ ) {
+            Stop();
+        }
+        shard->thread_->join();
+        delete shard->thread_;
+        shard->thread_ = nullptr;
+    }
+}
+
+/**
+ * @brief Stop and wait for all shards threads, without stopping main loop; their events are queued
+ *        by the kernel until they are resumed.
+ */
+void casper::inotify::API::Suspend ()
+{
+    const uint64_t one = 1;
+    halt_ = true;
+    for ( auto shard : shards_ ) {
+        if ( nullptr == shard->thread_ ) {
+            continue;
+        }
+        (void)write(shard->wake_fd_, &one, sizeof(one));
+        shard->thread_->join();
+        delete shard->thread_;
+        shard->thread_ = nullptr;
+    }
+    halt_ = false;
+}
+
+/**
+ * @brief Start a thread for each shard, but #0, that is drained by main loop.
+ */
+void casper::inotify::API::Resume ()
+{
+    for ( size_t idx = 1 ; idx < shards_.size() ; ++idx ) {
+        if ( nullptr == shards_[idx]->thread_ ) {
+            shards_[idx]->thread_ = new std::thread(&API::Run, this, std::ref(*shards_[idx]));
+        }
+    }
+}
+
+/**
+ * @brief Re-read configuration and apply only what changed: entries still configured keep their watches,
+ *        new entries are registered before removed ones are released, so shared watches never go away.
+ */
+void casper::inotify::API::Reload ()
+{
+    const auto start = std::chrono::steady_clock::now();
+    // ... shards threads must not touch entries while they change, their events are queued meanwhile ...
+    Suspend();
+    // ... release entries removed by a previous reload whose commands are done ...
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = 0;
+        for ( auto entry : entries_.retired_ ) {
+            if ( 0 == entry->stats_.running_ && 0 == entry->stats_.pending_ ) {
+                delete entry;
+            } else {
+                entries_.retired_[count++] = entry;
+            }
+        }
+        entries_.retired_.resize(count);
+    }
+    // ... parse, unchanged entries are adopted by \link API::Add \link instead of being created ...
+    API::Reloading                                            reloading;
+    std::vector<API::Entry*>                                  previous;
+    std::unordered_map<std::string, std::vector<API::Entry*>> bad;
+    API::WatchedSets                                          uris;
+    previous.swap(entries_.all_);
+    uris.directories_.swap(entries_.uris_.directories_);
+    uris.files_.swap(entries_.uris_.files_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bad.swap(entries_.bad_);
+    }
+    reloading.unmatched_.reserve(previous.size());
+    entries_.uris_.files_.reserve(uris.files_.size());
+    entries_.uris_.directories_.reserve(uris.directories_.size());
+    for ( auto entry : previous ) {
+        reloading.unmatched_[entry->key_].push_back(entry);
+    }
+    reloading.kept_ = 0;
+    reloading_      = &reloading;
+    const API::Defaults defaults = defaults_;
+    const API::Limits   limits   = limits_;
+    const std::string   file     = metrics_.file_;
+    const std::string   socket   = metrics_.socket_;
+    const size_t        interval = metrics_.interval_ms_;
+    const bool          detailed = metrics_.entries_;
+    const API::_Sink    sink     = sink_;
+    const API::_Journaling journaling = journaling_;
+    const API::_Handlers   handlers   = handlers_;
+    const API::_Timestamp  timestamp  = timestamp_;
+    const uint32_t         flush_ms   = log_.flush_interval_ms_;
+    const auto          restore  = [&] (const char* const a_what) {
+        // ... keep current configuration ...
+        reloading_ = nullptr;
+        for ( auto entry : reloading.added_ ) {
+            delete entry;
+        }
+        entries_.all_.swap(previous);
+        entries_.uris_.directories_.swap(uris.directories_);
+        entries_.uris_.files_.swap(uris.files_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.bad_.clear();
+            entries_.bad_.swap(bad);
+        }
+        defaults_ = defaults;
+        limits_   = limits;
+        metrics_.file_        = file;
+        metrics_.socket_      = socket;
+        metrics_.interval_ms_ = interval;
+        metrics_.entries_     = detailed;
+        sink_                 = sink;
+        journaling_           = journaling;
+        handlers_             = handlers;
+        timestamp_            = timestamp;
+        log_.flush_interval_ms_ = flush_ms;
+        logger_.SetFlushInterval(flush_ms);
+        Log(API::LogLevel::_Error, LOGGER_FAIL_SYMBOL " reload failed, configuration was not changed: %s", a_what);
+        Resume();
+    };
+    try {
+        Load(config_);
+    } catch (const inotify::Exception& a_e) {
+        restore(a_e.what());
+        return;
+    } catch (const std::exception& a_e) {
+        restore(a_e.what());
+        return;
+    }
+    reloading_ = nullptr;
+    // ... current entries not found in new configuration are removed ...
+    const std::vector<API::Entry*>& added = reloading.added_;
+    std::vector<API::Entry*>              removed;
+    std::unordered_set<const API::Entry*> gone;
+    for ( auto& it : reloading.unmatched_ ) {
+        for ( auto entry : it.second ) {
+            removed.push_back(entry);
+            gone.insert(entry);
+        }
+    }
+    // ... register new entries first ...
+    for ( auto entry : added ) {
+        if ( true == Register(entry) ) {
+            Track(entry, true);
+        } else {
+            Track(entry, false);
+        }
+        if ( entry->uri_.length() > static_cast<size_t>(log_.entry_ml_) ) {
+            log_.entry_ml_ = static_cast<int>(entry->uri_.length());
+        }
+    }
+    // ... a recursive entry that was changed hands it's subdirectories over, their watches are kept ...
+    std::unordered_map<std::string, API::Entry*> trees;
+    for ( auto entry : added ) {
+        if ( true == entry->recursive_ && -1 != entry->wd_ ) {
+            trees[entry->uri_] = entry;
+        }
+    }
+    for ( auto entry : removed ) {
+        const auto tree = trees.find(entry->uri_);
+        if ( false == entry->recursive_ || -1 == entry->wd_ || trees.end() == tree || entry->shard_ != tree->second->shard_ ) {
+            continue;
+        }
+        std::vector<API::Entry*> derived;
+        for ( auto& it : entry->shard_->derived_ ) {
+            if ( entry == it.second->root_ ) {
+                derived.push_back(it.second);
+            }
+        }
+        for ( auto child : derived ) {
+            const int         wd  = child->wd_;
+            const std::string uri = child->uri_;
+            Forget(child);
+            // ... kernel watch still has the old entry's events ...
+            API::Entry* heir = Derive(tree->second, uri, wd);
+            Rewatch(*heir->shard_, *Lookup(*heir->shard_, wd), /* a_force */ true);
+        }
+    }
+    for ( auto entry : added ) {
+        if ( true == entry->recursive_ && -1 != entry->wd_ ) {
+            Descend(entry, /* a_synthesize */ false);
+        }
+        if ( true == entry->reconcile_ && -1 != entry->wd_ ) {
+            List(*entry, entry->snapshot_);
+        }
+    }
+    // ... kept entries that are not watched yet ...
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for ( auto& it : bad ) {
+            for ( auto entry : it.second ) {
+                if ( gone.end() == gone.find(entry) ) {
+                    entries_.bad_[it.first].push_back(entry);
+                }
+            }
+        }
+    }
+    // ... then release removed ones ...
+    if ( 0 != removed.size() ) {
+        for ( auto shard : shards_ ) {
+            for ( auto it = shard->deferred_.begin() ; shard->deferred_.end() != it ; ) {
+                if ( gone.end() != gone.find(it->first.entry_) ) {
+                    it = shard->deferred_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for ( auto entry : removed ) {
+            Drop(entry);
+        }
+    }
+    // ... workers for new users, those waiting to be restarted keep waiting ...
+    for ( auto& it : pools_ ) {
+        for ( size_t idx = 0 ; idx < it.second.workers_.size() ; ++idx ) {
+            if ( -1 == it.second.workers_[idx].fd_ && std::chrono::steady_clock::time_point() == it.second.workers_[idx].restart_ ) {
+                (void)Restart(it.second, idx);
+            }
+        }
+    }
+    // ... metrics file and / or socket might have changed ...
+    if ( file != metrics_.file_ || socket != metrics_.socket_ || interval != metrics_.interval_ms_ ) {
+        try {
+            Expose();
+        } catch (const inotify::Exception& a_e) {
+            Log(API::LogLevel::_Error, LOGGER_FAIL_SYMBOL " %s", a_e.what());
+        }
+    }
+    try {
+        Listen();
+    } catch (const inotify::Exception& a_e) {
+        Log(API::LogLevel::_Error, LOGGER_FAIL_SYMBOL " %s", a_e.what());
+    }
+    // ... done ...
+    Resume();
+    Log(API::LogLevel::_Info, "Reloaded in %lld ms: %zu entries added, %zu removed and %zu kept",
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()),
+        added.size(), removed.size(), reloading.kept_
+    );
+}
+
+/**
+ * @brief Start monitoring a file descriptor for readability on main loop.
+ *
+ * @param a_fd File descriptor to monitor.
+ */
+void casper::inotify::API::Attach (const int a_fd)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = a_fd;
+    if ( -1 == epoll_ctl(reactor_.fd_, EPOLL_CTL_ADD, a_fd, &ev) ) {
+        throw inotify::Exception("An error occurred while registering fd %d with epoll: %d - %s",
+                                 a_fd, errno, strerror(errno)
+        );
+    }
+}
+
+/**
+ * @brief Stop monitoring a file descriptor on main loop.
+ *
+ * @param a_fd File descriptor to forget.
+ */
+void casper::inotify::API::Detach (const int a_fd)
+{
+    (void)epoll_ctl(reactor_.fd_, EPOLL_CTL_DEL, a_fd, nullptr);
+}
+
 // MARK: -
 
 /**
@@ -448,7 +1234,12 @@ void casper::inotify::API::OnSignal (const int a_sig_no)
  */
 bool casper::inotify::API::Register (API::Entry* a_entry)
 {
-    a_entry->wd_ = inotify_add_watch(inotify_.fd_, a_entry->uri_.c_str(), a_entry->mask_);
+    // ... filesystem or mount wide?
+    if ( API::Backend::_FANotifyBackend == a_entry->backend_ ) {
+        return Mark(a_entry);
+    }
+    // ... other entries might be watching the same object, add to their events ...
+    a_entry->wd_ = inotify_add_watch(a_entry->shard_->fd_, a_entry->uri_.c_str(), a_entry->mask_ | IN_MASK_ADD);
     if ( -1 == a_entry->wd_ ) {
         // ... track error ...
         a_entry->error_ = "An error occurred while registering an event for " + a_entry->uri_ + ": " + std::to_string(errno) + " - " + strerror(errno);
@@ -474,8 +1265,14 @@ bool casper::inotify::API::Unregister (API::Entry* a_entry)
         // ... done ...
         return true;
     }
+    // ... fanotify marks are shared by all entries in the same filesystem, they're released with the group ...
+    if ( API::Backend::_FANotifyBackend == a_entry->backend_ ) {
+        fanotify_.entries_.erase(std::remove(fanotify_.entries_.begin(), fanotify_.entries_.end(), a_entry), fanotify_.entries_.end());
+        a_entry->wd_ = -1;
+        return true;
+    }
     // ... try to remove event ...
-    if ( 0 != inotify_rm_watch(inotify_.fd_, a_entry->wd_) ) {
+    if ( 0 != inotify_rm_watch(a_entry->shard_->fd_, a_entry->wd_) ) {
         // ... log ..
         Log(API::LogLevel::_Error, "An error occurred while unregistering event %d ( %s ): %d - %s",
             a_entry->wd_, a_entry->uri_.c_str(), errno, strerror(errno)
@@ -493,305 +1290,1416 @@ bool casper::inotify::API::Unregister (API::Entry* a_entry)
 }
 
 /**
- * @brief Wait for next event.
+ * @brief Add a fanotify mark that covers the filesystem ( or mount ) where an entry lives.
  *
- * @return True if we should try again, false when it's time to stop.
+ * @param a_entry See \link API::Entry \link.
  */
-bool casper::inotify::API::Wait ()
-{   
-    static const int timeout_us = 1000*1000;
-    int flags = fcntl(inotify_.fd_, F_GETFL);
-    if ( -1 == fcntl(inotify_.fd_, F_SETFL, flags | O_NONBLOCK) ) {
-        throw inotify::Exception("Unable to setup NON-BLOCK reading: %d - %s!", errno, strerror(errno));
-    }
-    int length;
-
-    while ( false == quit_ ) {
-        length = read(inotify_.fd_, inotify_.buffer_, IN_BUFFER_MAX_LENGTH);
-        if ( length < 0 ) {
-            if ( EWOULDBLOCK == errno || EAGAIN == errno ) {
-                usleep(timeout_us);
-                continue;
-            } else if ( EINTR == errno ) { 
-                return false;
-            }
-            throw inotify::Exception("read error: %d - %s!", errno, strerror(errno));
-        } else {
-            break;
+bool casper::inotify::API::Mark (API::Entry* a_entry)
+{
+    // ... one group for all entries ...
+    if ( -1 == fanotify_.fd_ ) {
+        const int fd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_CLOEXEC | O_LARGEFILE);
+        if ( -1 == fd ) {
+            a_entry->error_ = "An error occurred while initializing fanotify for " + a_entry->uri_ + ": " + std::to_string(errno) + " - " + strerror(errno);
+            return false;
         }
+        fanotify_.fd_ = fd;
+        fanotify_.buffer_.resize(API_FANOTIFY_BUFFER_SIZE);
+        Attach(fanotify_.fd_);
     }
-
-    if ( true == quit_ ) {
+    // ... files might not exist yet, mark their directory's filesystem ...
+    std::string path = a_entry->uri_;
+    if ( API::Type::_File == a_entry->type_ ) {
+        const size_t last_slash_idx = path.rfind('/');
+        path = ( std::string::npos != last_slash_idx && 0 != last_slash_idx ? path.substr(0, last_slash_idx) : "/" );
+    }
+    if ( 0 != fanotify_mark(fanotify_.fd_, FAN_MARK_ADD | a_entry->mark_, ( a_entry->mask_ & API_FANOTIFY_EVENTS ) | FAN_ONDIR, AT_FDCWD, path.c_str()) ) {
+        a_entry->error_ = "An error occurred while marking " + path + ": " + std::to_string(errno) + " - " + strerror(errno);
         return false;
     }
-    
+    // ... file handles are resolved relative to any object in the same filesystem ...
+    struct statfs st;
+    if ( 0 != statfs(path.c_str(), &st) ) {
+        a_entry->error_ = "An error occurred while reading filesystem of " + path + ": " + std::to_string(errno) + " - " + strerror(errno);
+        return false;
+    }
+    uint64_t fsid;
+    memcpy(&fsid, &st.f_fsid, sizeof(fsid));
+    if ( fanotify_.mounts_.end() == fanotify_.mounts_.find(fsid) ) {
+        const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if ( -1 == fd ) {
+            a_entry->error_ = "An error occurred while opening " + path + ": " + std::to_string(errno) + " - " + strerror(errno);
+            return false;
+        }
+        fanotify_.mounts_[fsid] = fd;
+    }
+    // ... clear error and / or warning ...
+    a_entry->wd_      = API_FANOTIFY_WD;
+    a_entry->error_   = "";
+    a_entry->warning_ = "";
+    // ... success ...
+    return true;
+}
+
+/**
+ * @brief Called when fanotify group is readable, dispatch events to all entries they apply to.
+ */
+void casper::inotify::API::OnFANotify ()
+{
+    ssize_t length;
+    while ( ( length = read(fanotify_.fd_, fanotify_.buffer_.data(), fanotify_.buffer_.size()) ) > 0 ) {
+        // ... main loop, latency is recorded with shard #0's ...
+        clock_.read_    = std::chrono::steady_clock::now();
+        clock_.latency_ = &shards_[0]->latency_;
+        const struct fanotify_event_metadata* metadata = reinterpret_cast<const struct fanotify_event_metadata*>(fanotify_.buffer_.data());
+        for ( ; FAN_EVENT_OK(metadata, length) ; metadata = FAN_EVENT_NEXT(metadata, length) ) {
+            if ( FANOTIFY_METADATA_VERSION != metadata->vers ) {
+                throw inotify::Exception("Unsupported fanotify metadata version %u!", static_cast<unsigned>(metadata->vers));
+            }
+            if ( metadata->mask & FAN_Q_OVERFLOW ) {
+                stats_.overflows_++;
+                Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " fanotify queue overflow #%llu, events were lost!",
+                    static_cast<unsigned long long>(stats_.overflows_)
+                );
+                continue;
+            }
+            // ... FAN_REPORT_DFID_NAME: directory file handle followed by object name ...
+            const struct fanotify_event_info_fid* info = reinterpret_cast<const struct fanotify_event_info_fid*>(metadata + 1);
+            if ( reinterpret_cast<const char*>(info) + sizeof(*info) > reinterpret_cast<const char*>(metadata) + metadata->event_len
+                || FAN_EVENT_INFO_TYPE_DFID_NAME != info->hdr.info_type ) {
+                continue;
+            }
+            const struct file_handle* handle = reinterpret_cast<const struct file_handle*>(info->handle);
+            const char*               name   = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+            uint64_t fsid;
+            memcpy(&fsid, &info->fsid, sizeof(fsid));
+            const std::string* directory = Path(fsid, handle);
+            if ( nullptr == directory ) {
+                continue;
+            }
+            const bool self = ( 0 == strcmp(name, ".") );
+            // ... directories were moved or deleted, cached paths might be stale ...
+            if ( ( metadata->mask & FAN_ONDIR ) && ( metadata->mask & ( FAN_MOVED_FROM | FAN_DELETE ) ) ) {
+                fanotify_.paths_.clear();
+            }
+            // ... dispatch ...
+            for ( size_t idx = 0 ; idx < fanotify_.entries_.size() ; ++idx ) {
+                API::Entry*    entry = fanotify_.entries_[idx];
+                // ... no cookies to pair moves with, they are reported as deletions and creations ...
+                const uint32_t mask  = Unpair(metadata->mask & ( entry->mask_ | IN_ISDIR ));
+                if ( 0 == ( mask & API_FANOTIFY_EVENTS ) ) {
+                    continue;
+                }
+                const std::string& uri = entry->uri_;
+                if ( API::Type::_File == entry->type_ ) {
+                    // ... exact match ...
+                    if ( false == self && directory->length() + 1 + strlen(name) == uri.length()
+                        && 0 == uri.compare(0, directory->length(), *directory) && '/' == uri[directory->length()]
+                        && 0 == uri.compare(directory->length() + 1, std::string::npos, name) ) {
+                        Dispatch(*entry, mask, nullptr);
+                    }
+                    continue;
+                }
+                // ... anywhere below directory, name is relative to it ...
+                if ( 0 == directory->compare(uri) ) {
+                    Dispatch(*entry, mask, true == self ? nullptr : name);
+                } else if ( directory->length() > uri.length() && 0 == directory->compare(0, uri.length(), uri) && '/' == (*directory)[uri.length()] ) {
+                    fanotify_.name_.assign(*directory, uri.length() + 1, std::string::npos);
+                    if ( false == self ) {
+                        fanotify_.name_.append(1, '/').append(name);
+                    }
+                    Dispatch(*entry, mask, fanotify_.name_.c_str());
+                }
+            }
+        }
+    }
+    clock_.latency_ = nullptr;
+    if ( length < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno ) {
+        throw inotify::Exception("fanotify read error: %d - %s!", errno, strerror(errno));
+    }
+}
+
+/**
+ * @brief Resolve a directory file handle to it's current path.
+ *
+ * @param a_fsid   Filesystem ID.
+ * @param a_handle File handle, as reported by fanotify.
+ *
+ * @return Path or nullptr if it could not be resolved ( deleted, unknown filesystem, etc ).
+ */
+const std::string* casper::inotify::API::Path (const uint64_t a_fsid, const void* a_handle)
+{
+    const struct file_handle* handle = reinterpret_cast<const struct file_handle*>(a_handle);
+    // ... cached?
+    std::string key(reinterpret_cast<const char*>(&a_fsid), sizeof(a_fsid));
+    key.append(reinterpret_cast<const char*>(handle), sizeof(*handle) + handle->handle_bytes);
+    const auto it = fanotify_.paths_.find(key);
+    if ( fanotify_.paths_.end() != it ) {
+        return &it->second;
+    }
+    // ... resolve ...
+    const auto mount = fanotify_.mounts_.find(a_fsid);
+    if ( fanotify_.mounts_.end() == mount ) {
+        return nullptr;
+    }
+    const int fd = open_by_handle_at(mount->second, const_cast<struct file_handle*>(handle), O_PATH | O_CLOEXEC);
+    if ( -1 == fd ) {
+        return nullptr;
+    }
+    char link[64];
+    char path[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    const ssize_t length = readlink(link, path, sizeof(path));
+    close(fd);
+    if ( length <= 0 || static_cast<size_t>(length) >= sizeof(path) ) {
+        return nullptr;
+    }
+    // ... directory no longer exists?
+    static const char   sk_deleted[]      = " (deleted)";
+    static const size_t sk_deleted_length = sizeof(sk_deleted) - 1;
+    if ( static_cast<size_t>(length) > sk_deleted_length && 0 == memcmp(path + length - sk_deleted_length, sk_deleted, sk_deleted_length) ) {
+        return nullptr;
+    }
+    // ... keep cache bounded ...
+    if ( fanotify_.paths_.size() >= API_FANOTIFY_PATHS_MAX ) {
+        fanotify_.paths_.clear();
+    }
+    return &( fanotify_.paths_[key] = std::string(path, static_cast<size_t>(length)) );
+}
+
+/**
+ * @brief Wait for, and process, next batch of main loop events.
+ *
+ * @return True if we should try again, false when it's time to stop.
+ */
+bool casper::inotify::API::Wait ()
+{
+    struct epoll_event events[16];
+
+    // ... block until something is ready or we're asked to stop ...
+    const int count = epoll_wait(reactor_.fd_, events, sizeof(events) / sizeof(events[0]), /* timeout */ -1);
+    if ( count < 0 ) {
+        if ( EINTR == errno ) {
+            return ( false == quit_ );
+        }
+        throw inotify::Exception("epoll_wait error: %d - %s!", errno, strerror(errno));
+    }
+    for ( int n = 0 ; n < count && false == quit_ ; ++n ) {
+        if ( events[n].data.fd == reactor_.wake_fd_ ) {
+            // ... drain wake up counter ...
+            uint64_t value;
+            (void)read(reactor_.wake_fd_, &value, sizeof(value));
+        } else if ( events[n].data.fd == reactor_.signal_fd_ ) {
+            // ... dispatch pending signals ...
+            struct signalfd_siginfo info;
+            while ( sizeof(info) == read(reactor_.signal_fd_, &info, sizeof(info)) ) {
+                OnSignal(static_cast<int>(info.ssi_signo));
+            }
+        } else if ( events[n].data.fd == shards_[0]->timers_.fd_ ) {
+            // ... coalesced events are due ...
+            OnTimer(*shards_[0]);
+        } else if ( events[n].data.fd == fanotify_.fd_ ) {
+            // ... filesystem or mount wide events ...
+            OnFANotify();
+        } else if ( events[n].data.fd == shards_[0]->fd_ ) {
+            Read(*shards_[0]);
+        } else if ( events[n].data.fd == metrics_.timer_fd_ ) {
+            // ... time to rewrite metrics file ...
+            Publish();
+        } else if ( events[n].data.fd == metrics_.socket_fd_ ) {
+            // ... a metrics client connected ...
+            Accept();
+        } else if ( metrics_.scrapes_.end() != metrics_.scrapes_.find(events[n].data.fd) ) {
+            // ... a metrics client can take more of it's text, or hung up ...
+            Send(events[n].data.fd);
+        } else if ( true == stream_.Owns(events[n].data.fd) ) {
+            // ... stream subscriber connected, hung up or can take queued events ...
+            stream_.OnEvent(events[n].data.fd, events[n].events);
+        } else if ( true == ring_.Owns(events[n].data.fd) ) {
+            // ... ring reader connected or hung up ...
+            ring_.OnEvent(events[n].data.fd, events[n].events);
+        } else {
+            // ... must be a command worker ...
+            OnWorker(events[n].data.fd);
+        }
+    }
+    // ... continue?
+    return ( false == quit_ );
+}
+
+/**
+ * @brief Shard thread loop, for all shards but #0.
+ *
+ * @param a_shard Shard to drain.
+ */
+void casper::inotify::API::Run (API::Shard& a_shard)
+{
+    // ... pin?
+    if ( -1 != a_shard.cpu_ ) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(a_shard.cpu_, &set);
+        const int rv = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if ( 0 != rv ) {
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " unable to pin shard #%zu to CPU %d: %d - %s", a_shard.index_, a_shard.cpu_, rv, strerror(rv));
+        }
+    }
+    struct epoll_event events[4];
+    while ( false == quit_ && false == halt_ ) {
+        try {
+            const int count = epoll_wait(a_shard.epoll_fd_, events, sizeof(events) / sizeof(events[0]), /* timeout */ -1);
+            if ( count < 0 ) {
+                if ( EINTR == errno ) {
+                    continue;
+                }
+                throw inotify::Exception("shard #%zu epoll_wait error: %d - %s!", a_shard.index_, errno, strerror(errno));
+            }
+            for ( int n = 0 ; n < count && false == quit_ && false == halt_ ; ++n ) {
+                if ( events[n].data.fd == a_shard.wake_fd_ ) {
+                    uint64_t value;
+                    (void)read(a_shard.wake_fd_, &value, sizeof(value));
+                } else if ( events[n].data.fd == a_shard.timers_.fd_ ) {
+                    OnTimer(a_shard);
+                } else if ( events[n].data.fd == a_shard.fd_ ) {
+                    Read(a_shard);
+                }
+            }
+        } catch (const std::exception& a_e) {
+            Log(API::LogLevel::_Error, "%s", a_e.what());
+        }
+    }
+}
+
+/**
+ * @brief Read and process a shard's pending inotify events.
+ *
+ * @param a_shard Shard whose inotify instance is readable.
+ */
+void casper::inotify::API::Read (API::Shard& a_shard)
+{
+    const int length = static_cast<int>(read(a_shard.fd_, a_shard.buffer_.data(), a_shard.buffer_.size()));
+    if ( length < 0 ) {
+        if ( EWOULDBLOCK == errno || EAGAIN == errno || EINTR == errno ) {
+            return;
+        }
+        throw inotify::Exception("read error: %d - %s!", errno, strerror(errno));
+    }
+
     // ... log ...
     DEBUG_LOG(DEBUG_LEVEL_TRACE, "length = %d", length);
     
-    std::vector<std::string> actions;
-    int idx = 0;
+    // ... metrics ...
+    a_shard.counters_.reads_.fetch_add(1, std::memory_order_relaxed);
+    a_shard.counters_.bytes_.fetch_add(static_cast<uint64_t>(length), std::memory_order_relaxed);
+    a_shard.sizes_.Record(static_cast<uint64_t>(length));
+    clock_.read_    = std::chrono::steady_clock::now();
+    clock_.latency_ = &a_shard.latency_;
+
+    int      idx      = 0;
+    bool     overflow = false;
+    uint64_t count    = 0;
     while ( idx < length ) {
         // ... grab event ...
-        struct inotify_event* event = (struct inotify_event*)&inotify_.buffer_[idx];
-        const auto entry = entries_.good_.find(event->wd);
-        if ( entries_.good_.end() == entry ) {
-            // ... log ...
-            DEBUG_LOG(DEBUG_LEVEL_TRACE, "%3d : event triggered, mask = 0x%08X...", idx, event->mask);
-            DEBUG_LOG(DEBUG_LEVEL_TRACE, "%s", "event NOT in watch list...");
+        struct inotify_event* event = (struct inotify_event*)&a_shard.buffer_[idx];
+        count++;
+        // ... events were lost?
+        if ( event->mask & IN_Q_OVERFLOW ) {
+            stats_.overflows_++;
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " inotify queue overflow #%llu, events were lost!",
+                static_cast<unsigned long long>(stats_.overflows_)
+            );
+            overflow = true;
             // ... next ...
             idx += IN_STRUCT_EVENT_SIZE + event->len;
             continue;
         }
-        // ...
-        const char* entry_target;
-        switch (entry->second->type_) {
-            case API::Type::_File:
-                entry_target = "file";
-                break;
-            case API::Type::_Directory:
-                entry_target = "directory";
-                break;
-            default:
-                entry_target = "???";
-                break;
-        }
-        // ...
-        API::Event e;
-        e.mask_             = event->mask;
-        e.iso_8601_with_tz_ = Now(log_.time_);
-        // When events are generated for objects inside a watched directory,
-        // the name field in the returned inotify_event structure identifies
-        // the name of the file within the directory.
-        e.inside_a_watched_directory_ = ( event->len > 0 );
-        if ( true == e.inside_a_watched_directory_ ) {
-            // ... event is for an object inside a watched directory ...
-            e.object_name_c_str_    = event->name;
-            e.parent_object_type_c_ = 'd';
-            e.parent_object_name_   = entry->second->uri_.c_str();
-        } else {
-            // ... event is for an object ....
-            e.object_name_c_str_    = entry->second->uri_.c_str();
-            e.parent_object_type_c_ = '-';
-            e.parent_object_name_   = nullptr;
-        }
-        // ...
-        if ( event->mask & IN_ISDIR ) {
-            e.object_type_c_     = 'd';
-            e.object_type_c_str_ = "directory";
-        } else {
-            e.object_type_c_     = 'f';
-            e.object_type_c_str_ = "file";
-        }
-        // ... debug ...
-        DEBUG_LOG(DEBUG_LEVEL_TRACE,
-                    "%3d : event triggered, wd = %3d, mask = 0x%08X, e.object_name_c_str_ = %s, entry_target = %s, e.object_type_c_str_ = %s, uri = %s...",
-                    idx, event->wd, event->mask, e.object_name_c_str_, entry_target, e.object_type_c_str_, entry->second->uri_.c_str()
-        );
-        // ... filter?
-        DEBUG_LOG(DEBUG_LEVEL_TRACE,
-                    "%3d : apply filter '%s' over '%s'", idx, entry->second->pattern_.c_str(), e.object_name_c_str_
-        )
-        if ( 0 != entry->second->pattern_.length() && 0 != fnmatch(entry->second->pattern_.c_str(), e.object_name_c_str_, /* flags */ 0) ) {
+        API::Group* watch = Lookup(a_shard, event->wd);
+        if ( nullptr == watch ) {
             // ... log ...
-            DEBUG_LOG(DEBUG_LEVEL_TRACE, "%3d : SKIPPED, no match for pattern %s", idx, entry->second->pattern_.c_str())
+            DEBUG_LOG(DEBUG_LEVEL_TRACE, "%3d : event triggered, mask = 0x%08X...", idx, event->mask);
+            DEBUG_LOG(DEBUG_LEVEL_TRACE, "%s", "event NOT in watch list...");
             // ... next ...
             idx += IN_STRUCT_EVENT_SIZE + event->len;
             continue;
         }
-#if 0 // DEBUG
-        //
-        // when monitoring a directory:
-        //
-        // the events marked below can occur both for the directory itself and for objects inside the directory:
-        //
-        // ( IN_ATTRIB, IN_CLOSE_NOWRITE, IN_OPEN )
-        if ( ( event->mask & IN_ATTRIB ) || ( event->mask & IN_CLOSE_NOWRITE ) || ( event->mask & IN_OPEN ) ) {
-            if ( event->mask & IN_ISDIR ) {
-                // TODO: implement
+        const char* const name = ( event->len > 0 ? event->name : nullptr );
+        // ... keep snapshots up to date ...
+        for ( auto entry : watch->entries_ ) {
+            if ( true == entry->reconcile_ ) {
+                Remember(entry, event->mask, name);
             }
         }
-        // ... and ...
-        //
-        // the events below occur only for objects inside the directory (not for the directory itself).
-        //
-        // ( IN_ACCESS, IN_CLOSE_WRITE, IN_CREATE, IN_DELETE, IN_MODIFY, IN_MOVED_FROM, IN_MOVED_TO )
-        if (
-            ( event->mask & IN_ACCESS ) || ( event->mask & IN_CREATE ) || ( event->mask & IN_DELETE ) || ( event->mask & IN_MODIFY )
-            ||
-            ( event->mask & IN_CLOSE_WRITE  )
-            ||
-            ( event->mask & IN_MOVED_FROM ) || ( event->mask & IN_MOVED_TO )
-            ) {
-                // TODO: implement
+        // ... renames: first half is held until the second one arrives, unpaired halves are reported as deleted or created ...
+        if ( ( event->mask & IN_MOVED_FROM ) && 0 != event->cookie && nullptr != name ) {
+            Hold(a_shard, *event, name);
+        } else if ( false == ( ( event->mask & IN_MOVED_TO ) && 0 != event->cookie && nullptr != name && true == Pair(a_shard, *event, *watch, name) ) ) {
+            Deliver(a_shard, *watch, event->mask, name);
+        }
+        // ... was removed explicitly (inotify_rm_watch(2)) or
+        //     automatically (file was deleted, or filesystem was unmounted) ...
+        if ( event->mask & IN_IGNORED ) {
+            watch->ignored_ = true;
+            const std::vector<API::Entry*> entries = watch->entries_;
+            for ( auto entry : entries ) {
+                if ( nullptr != entry->root_ ) {
+                    Forget(entry);
+                } else {
+                    Untrack(entry, /* a_reason */ "event was removed explicitly or automatically!", /* a_log */ true);
+                }
+            }
+        }
+        // ... next ...
+        idx += IN_STRUCT_EVENT_SIZE + event->len;
+    }
+    a_shard.counters_.events_.fetch_add(count, std::memory_order_relaxed);
+    clock_.latency_ = nullptr;
+    // ... recover what was lost ...
+    if ( true == overflow ) {
+        Reconcile(a_shard);
+    }
+}
+
+/**
+ * @brief Dispatch an event to all entries of a watch it applies to.
+ *
+ * @param a_shard Shard the watch belongs to.
+ * @param a_watch Watch where event was triggered.
+ * @param a_mask  Event mask.
+ * @param a_name  Object name, when inside a watched directory, nullptr otherwise.
+ */
+void casper::inotify::API::Deliver (API::Shard& a_shard, API::Group& a_watch, const uint32_t a_mask, const char* const a_name)
+{
+    // ... when shared, entries whose patterns match are found in a single pass ...
+    std::vector<size_t>& matches = a_shard.matches_;
+    const bool           shared  = ( a_watch.entries_.size() > 1 );
+    if ( true == shared ) {
+        a_watch.index_.Match(nullptr != a_name ? a_name : a_watch.entries_[0]->uri_.c_str(), matches);
+    }
+    size_t match = 0;
+    for ( size_t n = 0 ; n < a_watch.entries_.size() ; ++n ) {
+        API::Entry* entry = a_watch.entries_[n];
+        // ... events requested only by other entries, or watched only to keep recursive watches in sync,
+        //     are not reported, neither are subdirectories watches removals ...
+        const uint32_t mask     = a_mask & ~( ( IN_ALL_EVENTS & ~entry->mask_ ) | entry->extra_mask_ );
+        const uint32_t internal = IN_ISDIR | ( nullptr != entry->root_ ? IN_IGNORED : 0 );
+        const bool     matched  = ( false == shared || ( match < matches.size() && n == matches[match] ) );
+        if ( true == shared && true == matched ) {
+            match++;
+        }
+        if ( 0 != ( mask & ~internal ) ) {
+            if ( true == matched ) {
+                Dispatch(*entry, Unpair(mask), a_name, /* a_filter */ false == shared);
+            } else {
+                Count(nullptr != entry->root_ ? *entry->root_ : *entry, Unpair(mask), /* a_filtered */ true);
             }
-#endif
-        // ...
-        if ( event->mask & IN_OPEN ) {
-            actions.push_back("open");
         }
-        if ( event->mask & IN_CLOSE ) {
-            actions.push_back("closed");
+        // ... a subdirectory was created, moved in or moved out?
+        if ( true == entry->recursive_ && ( a_mask & IN_ISDIR ) && nullptr != a_name ) {
+            Propagate(entry, a_mask, a_name);
         }
-        if ( event->mask & IN_ACCESS ) {
-            actions.push_back("accessed");
+    }
+}
+
+/**
+ * @brief Keep an IN_MOVED_FROM event until it's IN_MOVED_TO arrives, or it expires.
+ *
+ * @param a_shard Shard where event was read.
+ * @param a_event IN_MOVED_FROM event.
+ * @param a_name  Object name.
+ */
+void casper::inotify::API::Hold (API::Shard& a_shard, const struct inotify_event& a_event, const char* const a_name)
+{
+    const uint64_t ticks = std::max<uint64_t>(2, ( API_MOVE_EXPIRY_MS + API_TIMER_TICK_MS - 1 ) / API_TIMER_TICK_MS);
+    a_shard.moves_[a_event.cookie] = { a_event.wd, a_name, a_event.mask, a_shard.timers_.tick_ + ticks };
+    // ... arm timer, if not armed yet ...
+    if ( 1 == a_shard.moves_.size() && true == a_shard.deferred_.empty() ) {
+        Arm(a_shard);
+    }
+}
+
+/**
+ * @brief Report an IN_MOVED_TO event and it's held IN_MOVED_FROM as a single rename.
+ *
+ * Entries watching the destination report it as renamed, entries that only watched the source
+ * report it as deleted. Subdirectories moved within a recursive entry keep their watches.
+ *
+ * @param a_shard Shard where event was read.
+ * @param a_event IN_MOVED_TO event.
+ * @param a_watch Watch where event was triggered, the destination directory.
+ * @param a_name  Object name.
+ *
+ * @return False when there's no IN_MOVED_FROM to pair it with, and it should be reported as created.
+ */
+bool casper::inotify::API::Pair (API::Shard& a_shard, const struct inotify_event& a_event, API::Group& a_watch, const char* const a_name)
+{
+    const auto it = a_shard.moves_.find(a_event.cookie);
+    if ( a_shard.moves_.end() == it ) {
+        return false;
+    }
+    const API::Move move = std::move(it->second);
+    a_shard.moves_.erase(it);
+    // ... source no longer watched?
+    API::Group* from = Lookup(a_shard, move.wd_);
+    if ( nullptr == from ) {
+        return false;
+    }
+    const std::string old_uri = from->entries_[0]->uri_ + '/' + move.name_;
+    const std::string new_uri = a_watch.entries_[0]->uri_ + '/' + a_name;
+    const uint32_t    isdir   = ( a_event.mask & IN_ISDIR );
+    // ... configured entries watching destination ...
+    std::vector<const API::Entry*> owners;
+    for ( auto entry : a_watch.entries_ ) {
+        owners.push_back(nullptr != entry->root_ ? entry->root_ : entry);
+    }
+    // ... object left the scope of entries that only watched the source ...
+    std::vector<const API::Entry*> trees;
+    const std::vector<API::Entry*> sources = from->entries_;
+    for ( auto entry : sources ) {
+        const API::Entry* owner = ( nullptr != entry->root_ ? entry->root_ : entry );
+        if ( owners.end() != std::find(owners.begin(), owners.end(), owner) ) {
+            if ( true == entry->recursive_ ) {
+                trees.push_back(owner);
+            }
+            continue;
         }
-        if ( event->mask & IN_CREATE ) {
-            actions.push_back("created");
+        const uint32_t mask = move.mask_ & ~( ( IN_ALL_EVENTS & ~entry->mask_ ) | entry->extra_mask_ );
+        if ( 0 != ( mask & ~IN_ISDIR ) ) {
+            Dispatch(*entry, Unpair(mask), move.name_.c_str());
         }
-        if ( event->mask & IN_MODIFY ) {
-            actions.push_back("modified");
+        if ( true == entry->recursive_ && 0 != isdir ) {
+            Propagate(entry, move.mask_, move.name_.c_str());
         }
-        if ( event->mask & IN_DELETE || event->mask & IN_DELETE_SELF ) {
-            actions.push_back("deleted");
+    }
+    // ... one rename for each entry watching destination ...
+    bool                           rebased = false;
+    const std::vector<API::Entry*> targets = a_watch.entries_;
+    for ( auto entry : targets ) {
+        const uint32_t mask = ( a_event.mask | IN_MOVED_FROM ) & ~( ( IN_ALL_EVENTS & ~entry->mask_ ) | entry->extra_mask_ );
+        if ( 0 != ( mask & IN_MOVE ) ) {
+            Dispatch(*entry, IN_MOVE | isdir, a_name, /* a_filter */ true, old_uri.c_str());
         }
-        if ( event->mask & IN_IGNORED ) {
-            actions.push_back("ignored");
+        if ( false == entry->recursive_ || 0 == isdir ) {
+            continue;
         }
-        //
-        if ( 0 != actions.size() ) {
-            for ( auto action : actions ) {
-                e.name_ += ", " + action;
+        // ... moved within a recursive entry, watches are kept and only their paths change ...
+        const API::Entry* owner = ( nullptr != entry->root_ ? entry->root_ : entry );
+        if ( trees.end() != std::find(trees.begin(), trees.end(), owner) ) {
+            if ( false == rebased ) {
+                Rebase(a_shard, old_uri, new_uri);
+                rebased = true;
             }
-            e.name_ = std::string(e.name_.c_str() + 2);
         } else {
-            e.name_ = "???";
+            Propagate(entry, a_event.mask, a_name);
         }
-        // ... log ...
-        if ( nullptr == entry->second->handler_ ) {
-            Log(API::LogLevel::_Info, e, *entry->second, actions); 
-        }                
-        // ...
-        if ( nullptr != entry->second->handler_ && false == entry->second->handler_(*entry->second, e) ) {
-            // ... log ...
-            DEBUG_LOG(DEBUG_LEVEL_BASIC, "➢ %u, %s, event skipped!", entry->second->wd_, e.name_.c_str());
-            // ... next ...
-            idx += IN_STRUCT_EVENT_SIZE + event->len;
+    }
+    // ... done ...
+    return true;
+}
+
+/**
+ * @brief Report IN_MOVED_FROM events that were not paired in time as deletions.
+ *
+ * @param a_shard Shard whose timer expired.
+ */
+void casper::inotify::API::Expire (API::Shard& a_shard)
+{
+    for ( auto it = a_shard.moves_.begin() ; a_shard.moves_.end() != it ; ) {
+        if ( it->second.deadline_ > a_shard.timers_.tick_ ) {
+            ++it;
             continue;
         }
-        // ... ignore or launch a process?
-        if ( 0 == e.name_.compare("???") || 0 == e.name_.length() ) {
-            Ignore(*entry->second, e);
-        } else if ( ! ( event->mask & IN_IGNORED ) ) {
-            Spawn(*entry->second, e);
+        const API::Move move = std::move(it->second);
+        it = a_shard.moves_.erase(it);
+        API::Group* watch = Lookup(a_shard, move.wd_);
+        if ( nullptr != watch ) {
+            Deliver(a_shard, *watch, move.mask_, move.name_.c_str());
         }
-        // ... was removed explicitly (inotify_rm_watch(2)) or
-        //     automatically (file was deleted, or filesystem was unmounted) ...
-        if ( event->mask & IN_IGNORED ) {
-            Untrack(entry->second, /* a_reason */ "event was removed explicitly or automatically!", /* a_log */ true);
-        }
-        // ... clean up ...
-        actions.clear();
-        // ... next ...
-        idx += IN_STRUCT_EVENT_SIZE + event->len;
     }
-    // ... continue ...
-    return true;
 }
 
-// MARK: -
-
 /**
- * @brief Open a log file.
+ * @brief Decode, filter and log an event, then launch, coalesce or ignore it.
  *
- * @param a_uri      Log file URI.
- * @param a_recycled True if it's a recycle request.
+ * @param a_entry Entry where event was triggered.
+ * @param a_mask  Event mask.
+ * @param a_name   Object name, when inside a watched directory, nullptr otherwise.
+ * @param a_filter False when entry's patterns were already matched.
+ * @param a_old_name Full path before a rename, nullptr otherwise.
  */
-void casper::inotify::API::Open (const std::string& a_uri, const bool a_recycled)
+void casper::inotify::API::Dispatch (API::Entry& a_entry, const uint32_t a_mask, const char* const a_name, const bool a_filter,
+                                     const char* const a_old_name)
 {
-    // ... close ...
-    if ( nullptr != log_.fp_ ) {
-        fflush(log_.fp_);
-        fclose(log_.fp_);
+    // ... subdirectories of recursive entries share their configuration ...
+    const API::Entry& owner = ( nullptr != a_entry.root_ ? *a_entry.root_ : a_entry );
+    // ... metrics ...
+    Count(owner, a_mask, /* a_filtered */ false);
+    // ... decode ...
+    API::Event e;
+    Decode(a_mask, a_name, a_entry, e);
+    e.old_object_name_ = a_old_name;
+    // ... debug ...
+    DEBUG_LOG(DEBUG_LEVEL_TRACE,
+                "event triggered, wd = %3d, mask = 0x%08X, e.object_name_c_str_ = %s, entry_target = %s, e.object_type_c_str_ = %s, uri = %s...",
+                a_entry.wd_, a_mask, e.object_name_c_str_, API::Type::_File == a_entry.type_ ? "file" : "directory", e.object_type_c_str_, a_entry.uri_.c_str()
+    );
+    // ... filter?
+    DEBUG_LOG(DEBUG_LEVEL_TRACE,
+                "apply filter '%s' over '%s'", owner.pattern_.c_str(), e.object_name_c_str_
+    )
+    if ( true == a_filter && false == owner.glob_.Match(e.object_name_c_str_) ) {
+        // ... log ...
+        DEBUG_LOG(DEBUG_LEVEL_TRACE, "SKIPPED, no match for pattern %s", owner.pattern_.c_str())
+        owner.counters_.filtered_.fetch_add(1, std::memory_order_relaxed);
+        // ... done ...
+        return;
     }
-    // ... open ...
-    log_.fp_ = fopen(a_uri.c_str(), a_recycled ? "w" : "w+");
-    if ( nullptr == log_.fp_ ) {
-        throw inotify::Exception("An error occurred while trying to open %s: %d - %s", 
-            a_uri.c_str(), errno, strerror(errno)
-        );
+#if 0 // DEBUG
+    //
+    // when monitoring a directory:
+    //
+    // the events marked below can occur both for the directory itself and for objects inside the directory:
+    //
+    // ( IN_ATTRIB, IN_CLOSE_NOWRITE, IN_OPEN )
+    if ( ( a_mask & IN_ATTRIB ) || ( a_mask & IN_CLOSE_NOWRITE ) || ( a_mask & IN_OPEN ) ) {
+        if ( a_mask & IN_ISDIR ) {
+            // TODO: implement
+        }
+    }
+    // ... and ...
+    //
+    // the events below occur only for objects inside the directory (not for the directory itself).
+    //
+    // ( IN_ACCESS, IN_CLOSE_WRITE, IN_CREATE, IN_DELETE, IN_MODIFY, IN_MOVED_FROM, IN_MOVED_TO )
+    if (
+        ( a_mask & IN_ACCESS ) || ( a_mask & IN_CREATE ) || ( a_mask & IN_DELETE ) || ( a_mask & IN_MODIFY )
+        ||
+        ( a_mask & IN_CLOSE_WRITE  )
+        ||
+        ( a_mask & IN_MOVED_FROM ) || ( a_mask & IN_MOVED_TO )
+        ) {
+            // TODO: implement
+        }
+#endif
+    // ... log ...
+    if ( nullptr == a_entry.handler_ ) {
+        Log(API::LogLevel::_Info, e, a_entry);
     }
-    log_.uri_ = a_uri;
     // ...
-    if ( false == a_recycled ) {
+    if ( nullptr != a_entry.handler_ && false == a_entry.handler_(a_entry, e) ) {
+        // ... log ...
+        DEBUG_LOG(DEBUG_LEVEL_BASIC, "➢ %u, %s, event skipped!", a_entry.wd_, e.name_);
         // ... done ...
         return;
     }
-    // ...
-    fprintf(log_.fp_, "--- --- ---\n");
-    fprintf(log_.fp_, "⌥ LOG FILE   : %s\n", log_.uri_.c_str());
-    fprintf(log_.fp_, "⌥ OWNERSHIP  : %4o\n", owner_.mode_);
-    // if ( not ( ( std::numeric_limits<uid_t>::max() == owner_.user_id_ || std::numeric_limits<gid_t>::max() == owner_.group_id_ ) || ( 0 == owner_.user_id_ || 0 == owner_.group_id_ ) ) ) {
-        fprintf(log_.fp_, "  - USER : %s ( %u )\n", owner_.user_name_.c_str() , owner_.user_id_);
-        fprintf(log_.fp_, "  - GROUP: %s ( %u )\n", owner_.group_name_.c_str(), owner_.group_id_);
-    // }
-    fprintf(log_.fp_, "⌥ PERMISSIONS:\n");
-    fprintf(log_.fp_, "  - MODE : %-4o\n", owner_.mode_);
-    fprintf(log_.fp_, "⌥ RECYCLED AT: %s\n", Now(log_.time_));
-    fprintf(log_.fp_, "--- --- ---\n");
-    fflush(log_.fp_);
-    // ... ensure ownership ... 
-    const int chown_status = chown(a_uri.c_str(), owner_.user_id_, owner_.group_id_);
-    if ( 0 != chown_status ) {
-        syslog(LOG_WARNING, "WARNING: failed to change ownership of %s to %u:%u ~ %d - %s\n", log_.uri_.c_str(), owner_.user_id_, owner_.group_id_, errno, strerror(errno));
-    }
-    const int chmod_status = chmod(a_uri.c_str(), owner_.mode_);
-    if ( 0 != chmod_status ) {
-        syslog(LOG_WARNING, "WARNING: failed to change permissions of %s to %o ~ %d - %s\n", log_.uri_.c_str(), owner_.mode_, errno, strerror(errno));
+    // ... read to dispatch latency, when dispatched while reading ...
+    if ( nullptr != clock_.latency_ ) {
+        clock_.latency_->Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clock_.read_).count()));
     }
-    // ... log ...
-    syslog(LOG_NOTICE, "%s recycled.", log_.uri_.c_str());
-}
-
-/**
- * @brief Log all entries.
- *
- * @param a_entry Entries to log.
- */
-void casper::inotify::API::Log (const API::Entries& a_entries)
-{
-    // ... log all entries ...
-    for ( auto& entry : a_entries.all_ ) {
-        if ( -1 != entry->wd_ ) {
-            Log(LOGGER_PASS_SYMBOL, *entry);
+    // ... ignore, coalesce or launch a process?
+    if ( 0 == e.actions_ ) {
+        Ignore(a_entry, e);
+    } else if ( ! ( a_mask & IN_IGNORED ) ) {
+        if ( 0 != a_entry.debounce_ms_ && nullptr == a_entry.handler_ ) {
+            Defer(a_entry, e);
         } else {
-            Log(LOGGER_FAIL_SYMBOL, *entry);
+            Spawn(a_entry, e);
         }
     }
 }
 
 /**
- * @brief Log an action trigger for a specific entry.
+ * @brief Decode an inotify event, no heap allocations are performed.
  *
- * @param a_symbol Symbol to log.
- * @param a_entry  Entry to log.
+ * @param a_mask  Event mask.
+ * @param a_name  Object name, when inside a watched directory, nullptr otherwise; must outlive \link API::Event \link.
+ * @param a_entry Entry where event was triggered, must outlive \link API::Event \link.
+ * @param o_event Decoded event.
  */
-void casper::inotify::API::Log (const char* const a_symbol, const API::Entry& a_entry)
+void casper::inotify::API::Decode (const uint32_t a_mask, const char* const a_name, const API::Entry& a_entry, API::Event& o_event) const
 {
-    const std::string log_suffix = 0 != a_entry.pattern_.length() ? ", " + a_entry.pattern_ : "";
-    // ...
-    char t;
-    switch(a_entry.type_) {
-        case API::Type::_Directory:
-            t = 'd';
-            break;
-        case API::Type::_File:
-            t = 'f';
-            break;
-        default:
-            t = '?';
-            break;
+    o_event.mask_ = a_mask;
+    Now(o_event.iso_8601_with_tz_);
+    // When events are generated for objects inside a watched directory,
+    // the name field in the returned inotify_event structure identifies
+    // the name of the file within the directory.
+    o_event.inside_a_watched_directory_ = ( nullptr != a_name );
+    o_event.old_object_name_            = nullptr;
+    if ( true == o_event.inside_a_watched_directory_ ) {
+        // ... event is for an object inside a watched directory ...
+        o_event.object_name_c_str_    = a_name;
+        o_event.parent_object_type_c_ = 'd';
+        o_event.parent_object_name_   = a_entry.uri_.c_str();
+    } else {
+        // ... event is for an object ....
+        o_event.object_name_c_str_    = a_entry.uri_.c_str();
+        o_event.parent_object_type_c_ = '-';
+        o_event.parent_object_name_   = nullptr;
     }
     // ...
-    if ( -1 != a_entry.wd_ ) {
-        Log(API::LogLevel::_Info, " %s [%c] %-*.*s, 0x%08X ⇥ %d%s",
-            a_symbol, t, log_.entry_ml_, log_.entry_ml_, a_entry.uri_.c_str(), a_entry.mask_, a_entry.wd_, log_suffix.c_str());
+    if ( a_mask & IN_ISDIR ) {
+        o_event.object_type_c_     = 'd';
+        o_event.object_type_c_str_ = "directory";
     } else {
-        Log(API::LogLevel::_Info, " %s [%c] %-*.*s, 0x%08X ⌁ " LOGGER_FAIL_SYMBOL,
-            a_symbol, t, log_.entry_ml_, log_.entry_ml_, a_entry.uri_.c_str(), a_entry.mask_);
-        if ( 0 != a_entry.error_.length() ) {
-            Log(API::LogLevel::_Error," " LOGGER_FAIL_SYMBOL " %s", a_entry.error_.c_str());
-        } else if ( 0 != a_entry.warning_.length() ) {
-            Log(API::LogLevel::_Warning," " LOGGER_WARNING_SYMBOL " %s", a_entry.warning_.c_str());
+        o_event.object_type_c_     = 'f';
+        o_event.object_type_c_str_ = "file";
+    }
+    // ... actions, as a bitfield over sk_actions_ and as a ', ' separated name ...
+    o_event.actions_ = 0;
+    size_t length    = 0;
+    for ( size_t idx = 0 ; nullptr != sk_actions_[idx].name_ ; ++idx ) {
+        if ( 0 == ( a_mask & sk_actions_[idx].mask_ ) ) {
+            continue;
+        }
+        o_event.actions_ |= static_cast<uint16_t>(1u << idx);
+        const size_t name_length = strlen(sk_actions_[idx].name_);
+        if ( length + name_length + 3 > sizeof(o_event.name_) ) {
+            break;
+        }
+        if ( 0 != length ) {
+            o_event.name_[length++] = ',';
+            o_event.name_[length++] = ' ';
+        }
+        memcpy(o_event.name_ + length, sk_actions_[idx].name_, name_length);
+        length += name_length;
+    }
+    if ( 0 == length ) {
+        memcpy(o_event.name_, "???", 3);
+        length = 3;
+    }
+    o_event.name_[length] = '\0';
+}
+
+/**
+ * @brief Report a move that could not be paired as the deletion or creation it is to the watching entry.
+ *
+ * @param a_mask Event mask.
+ *
+ * @return Event mask, IN_MOVED_FROM replaced by IN_DELETE and IN_MOVED_TO by IN_CREATE.
+ */
+uint32_t casper::inotify::API::Unpair (const uint32_t a_mask)
+{
+    uint32_t mask = ( a_mask & ~IN_MOVE );
+    if ( a_mask & IN_MOVED_FROM ) {
+        mask |= IN_DELETE;
+    }
+    if ( a_mask & IN_MOVED_TO ) {
+        mask |= IN_CREATE;
+    }
+    return mask;
+}
+
+/**
+ * @brief Coalesce an event with other events for the same entry and object, dispatch is delayed
+ *        by \link API::Entry::debounce_ms_ \link since the first one.
+ *
+ * @param a_entry Entry where event was triggered.
+ * @param a_event Decoded event.
+ */
+void casper::inotify::API::Defer (const API::Entry& a_entry, const API::Event& a_event)
+{
+    API::Shard&            shard = *a_entry.shard_;
+    const API::DeferredKey key = { &a_entry, true == a_event.inside_a_watched_directory_ ? a_event.object_name_c_str_ : "" };
+    const auto it = shard.deferred_.find(key);
+    if ( shard.deferred_.end() != it ) {
+        // ... merge ...
+        it->second.mask_ |= a_event.mask_;
+        it->second.count_++;
+        if ( nullptr != a_event.old_object_name_ ) {
+            it->second.old_name_ = a_event.old_object_name_;
+        }
+        return;
+    }
+    // ... first event in window, schedule ...
+    const uint64_t ticks = std::max<uint64_t>(1, ( a_entry.debounce_ms_ + API_TIMER_TICK_MS - 1 ) / API_TIMER_TICK_MS);
+    auto& deferred = shard.deferred_[key];
+    deferred = { a_event.mask_, a_event.inside_a_watched_directory_, shard.timers_.tick_ + ticks, 1,
+                 nullptr != a_event.old_object_name_ ? a_event.old_object_name_ : "" };
+    shard.timers_.wheel_[deferred.deadline_ % shard.timers_.wheel_.size()].push_back(key);
+    // ... arm timer, if not armed yet ...
+    if ( 1 == shard.deferred_.size() && true == shard.moves_.empty() ) {
+        Arm(shard);
+    }
+}
+
+/**
+ * @brief Start a shard's timer, it ticks every API_TIMER_TICK_MS while there's something to wait for.
+ *
+ * @param a_shard Shard whose timer should be armed.
+ */
+void casper::inotify::API::Arm (API::Shard& a_shard)
+{
+    struct itimerspec spec;
+    spec.it_interval.tv_sec  = 0;
+    spec.it_interval.tv_nsec = API_TIMER_TICK_MS * 1000 * 1000;
+    spec.it_value            = spec.it_interval;
+    if ( 0 != timerfd_settime(a_shard.timers_.fd_, 0, &spec, nullptr) ) {
+        throw inotify::Exception("An error occurred while arming timer: %d - %s", errno, strerror(errno));
+    }
+}
+
+/**
+ * @brief Called when a shard's timerfd expired, advance it's wheel and dispatch coalesced events that are due.
+ *
+ * @param a_shard Shard whose timer expired.
+ */
+void casper::inotify::API::OnTimer (API::Shard& a_shard)
+{
+    uint64_t expirations = 0;
+    if ( sizeof(expirations) != read(a_shard.timers_.fd_, &expirations, sizeof(expirations)) ) {
+        return;
+    }
+    for ( uint64_t n = 0 ; n < expirations && ( false == a_shard.deferred_.empty() || false == a_shard.moves_.empty() ) ; ++n ) {
+        a_shard.timers_.tick_++;
+        auto& slot = a_shard.timers_.wheel_[a_shard.timers_.tick_ % a_shard.timers_.wheel_.size()];
+        for ( size_t idx = 0 ; idx < slot.size() ; ) {
+            const auto it = a_shard.deferred_.find(slot[idx]);
+            if ( a_shard.deferred_.end() != it && it->second.deadline_ > a_shard.timers_.tick_ ) {
+                // ... not this lap ...
+                ++idx;
+                continue;
+            }
+            if ( a_shard.deferred_.end() != it ) {
+                const API::Entry& entry = *it->first.entry_;
+                API::Event e;
+                Decode(it->second.mask_, true == it->second.inside_ ? it->first.name_.c_str() : nullptr, entry, e);
+                e.old_object_name_ = ( 0 != it->second.old_name_.length() ? it->second.old_name_.c_str() : nullptr );
+                DEBUG_LOG(DEBUG_LEVEL_BASIC, "➢ %u, %s, %s, %zu event(s) coalesced", entry.wd_, e.object_name_c_str_, e.name_, it->second.count_);
+                Spawn(entry, e);
+                a_shard.deferred_.erase(it);
+            }
+            slot[idx] = std::move(slot.back());
+            slot.pop_back();
+        }
+    }
+    // ... renames that were not paired in time ...
+    Expire(a_shard);
+    // ... workers that are due to be restarted, shard #0 timer is dispatched by main loop, as workers sockets are ...
+    if ( 0 == a_shard.index_ && 0 != restarts_ ) {
+        Revive();
+    }
+    // ... nothing else to wait for? disarm ...
+    if ( true == a_shard.deferred_.empty() && true == a_shard.moves_.empty() && ( 0 != a_shard.index_ || 0 == restarts_ ) ) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        (void)timerfd_settime(a_shard.timers_.fd_, 0, &spec, nullptr);
+    }
+}
+
+/**
+ * @brief Count an event received by an entry.
+ *
+ * @param a_entry    Configured entry, subdirectories entries count in their root.
+ * @param a_mask     Event mask.
+ * @param a_filtered True when event was discarded by entry's patterns.
+ */
+void casper::inotify::API::Count (const API::Entry& a_entry, const uint32_t a_mask, const bool a_filtered)
+{
+    for ( uint32_t bits = a_mask & ( ( 1u << API_METRICS_EVENT_BITS ) - 1 ) ; 0 != bits ; bits &= bits - 1 ) {
+        a_entry.counters_.events_[__builtin_ctz(bits)].fetch_add(1, std::memory_order_relaxed);
+    }
+    if ( true == a_filtered ) {
+        a_entry.counters_.filtered_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// MARK: -
+
+/**
+ * @brief (Re)start metrics exporters: a timer to rewrite the Prometheus text file and / or a listening unix socket.
+ */
+void casper::inotify::API::Expose ()
+{
+    // ... release current ones ...
+    if ( -1 != metrics_.timer_fd_ ) {
+        Detach(metrics_.timer_fd_);
+        close(metrics_.timer_fd_);
+        metrics_.timer_fd_ = -1;
+    }
+    if ( -1 != metrics_.socket_fd_ ) {
+        Detach(metrics_.socket_fd_);
+        close(metrics_.socket_fd_);
+        (void)unlink(metrics_.bound_.c_str());
+        metrics_.socket_fd_ = -1;
+        metrics_.bound_     = "";
+    }
+    Timeout(/* a_all */ true);
+    // ... file ...
+    if ( 0 != metrics_.file_.length() ) {
+        metrics_.timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if ( metrics_.timer_fd_ < 0 ) {
+            throw inotify::Exception("An error occurred while creating metrics timerfd: %d - %s",
+                                     errno, strerror(errno)
+            );
+        }
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.it_interval.tv_sec  = static_cast<time_t>(metrics_.interval_ms_ / 1000);
+        spec.it_interval.tv_nsec = static_cast<long>(( metrics_.interval_ms_ % 1000 ) * 1000000);
+        spec.it_value            = spec.it_interval;
+        (void)timerfd_settime(metrics_.timer_fd_, 0, &spec, nullptr);
+        Attach(metrics_.timer_fd_);
+    }
+    // ... socket ...
+    if ( 0 != metrics_.socket_.length() ) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, metrics_.socket_.c_str(), sizeof(address.sun_path) - 1);
+        metrics_.socket_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if ( metrics_.socket_fd_ < 0 ) {
+            throw inotify::Exception("An error occurred while creating metrics socket: %d - %s",
+                                     errno, strerror(errno)
+            );
+        }
+        // ... left behind by a previous instance?
+        (void)unlink(metrics_.socket_.c_str());
+        if ( 0 != bind(metrics_.socket_fd_, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) || 0 != listen(metrics_.socket_fd_, 16) ) {
+            const int no = errno;
+            close(metrics_.socket_fd_);
+            metrics_.socket_fd_ = -1;
+            throw inotify::Exception("An error occurred while listening on metrics socket '%s': %d - %s",
+                                     metrics_.socket_.c_str(), no, strerror(no)
+            );
+        }
+        metrics_.bound_ = metrics_.socket_;
+        Attach(metrics_.socket_fd_);
+    }
+    // ... first snapshot, right away ...
+    if ( -1 != metrics_.timer_fd_ ) {
+        Publish();
+    }
+}
+
+/**
+ * @brief Rewrite metrics file, atomically: readers see either the previous or the new version.
+ */
+void casper::inotify::API::Publish ()
+{
+    uint64_t expirations;
+    (void)read(metrics_.timer_fd_, &expirations, sizeof(expirations));
+    Timeout();
+    Collect(metrics_.text_);
+    const std::string tmp = metrics_.file_ + ".tmp";
+    const int         fd  = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if ( -1 == fd ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " unable to write metrics to %s: %d - %s", tmp.c_str(), errno, strerror(errno));
+        return;
+    }
+    size_t written = 0;
+    while ( written < metrics_.text_.length() ) {
+        const ssize_t rv = write(fd, metrics_.text_.data() + written, metrics_.text_.length() - written);
+        if ( rv < 0 && EINTR == errno ) {
+            continue;
+        }
+        if ( rv <= 0 ) {
+            break;
+        }
+        written += static_cast<size_t>(rv);
+    }
+    const int no = errno;
+    close(fd);
+    if ( written != metrics_.text_.length() ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " unable to write metrics to %s: %d - %s", tmp.c_str(), no, strerror(no));
+        (void)unlink(tmp.c_str());
+    } else if ( 0 != rename(tmp.c_str(), metrics_.file_.c_str()) ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " unable to rename %s: %d - %s", tmp.c_str(), errno, strerror(errno));
+        (void)unlink(tmp.c_str());
+    }
+}
+
+/**
+ * @brief Serve current metrics to each pending connection, which is then closed.
+ */
+void casper::inotify::API::Accept ()
+{
+    Timeout();
+    int fd;
+    while ( ( fd = accept4(metrics_.socket_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) ) >= 0 ) {
+        // ... too many clients still being served?
+        if ( metrics_.scrapes_.size() >= API_METRICS_MAX_CLIENTS ) {
+            close(fd);
+            continue;
+        }
+        // ... what does not fit in socket buffer is sent as client takes it, main loop never waits for it ...
+        API::Scrape& scrape = metrics_.scrapes_[fd];
+        Collect(scrape.text_);
+        scrape.sent_     = 0;
+        scrape.deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(API_METRICS_SEND_TIMEOUT_MS);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLOUT;
+        ev.data.fd = fd;
+        if ( -1 == epoll_ctl(reactor_.fd_, EPOLL_CTL_ADD, fd, &ev) ) {
+            metrics_.scrapes_.erase(fd);
+            close(fd);
+            continue;
+        }
+        Send(fd);
+    }
+}
+
+/**
+ * @brief Send a metrics client as much of it's text as it takes, and close it once it has it all or it failed.
+ *
+ * @param a_fd Client socket.
+ */
+void casper::inotify::API::Send (const int a_fd)
+{
+    const auto it = metrics_.scrapes_.find(a_fd);
+    if ( metrics_.scrapes_.end() == it ) {
+        return;
+    }
+    API::Scrape& scrape = it->second;
+    while ( scrape.sent_ < scrape.text_.length() ) {
+        const ssize_t rv = send(a_fd, scrape.text_.data() + scrape.sent_, scrape.text_.length() - scrape.sent_, MSG_NOSIGNAL);
+        if ( rv < 0 && EINTR == errno ) {
+            continue;
+        }
+        if ( rv < 0 && ( EAGAIN == errno || EWOULDBLOCK == errno ) && std::chrono::steady_clock::now() < scrape.deadline_ ) {
+            // ... wait for EPOLLOUT ...
+            return;
+        }
+        if ( rv <= 0 ) {
+            break;
+        }
+        scrape.sent_ += static_cast<size_t>(rv);
+    }
+    Detach(a_fd);
+    close(a_fd);
+    metrics_.scrapes_.erase(it);
+}
+
+/**
+ * @brief Close metrics clients that did not take their text in time.
+ *
+ * @param a_all When true, all clients are closed.
+ */
+void casper::inotify::API::Timeout (const bool a_all)
+{
+    const auto now = std::chrono::steady_clock::now();
+    for ( auto it = metrics_.scrapes_.begin() ; metrics_.scrapes_.end() != it ; ) {
+        if ( true == a_all || now >= it->second.deadline_ ) {
+            if ( -1 != reactor_.fd_ ) {
+                Detach(it->first);
+            }
+            close(it->first);
+            it = metrics_.scrapes_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief Render all metrics in Prometheus text format.
+ *
+ * @param o_text Buffer to render to.
+ */
+void casper::inotify::API::Collect (std::string& o_text)
+{
+    static const std::vector<uint64_t> sk_latency_bounds_ns_ = {
+        1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 50000000, 100000000, 500000000, 1000000000
+    };
+    static const std::vector<uint64_t> sk_duration_bounds_us_ = {
+        1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 30000000, 60000000, 300000000
+    };
+    static const std::vector<uint64_t> sk_size_bounds_ = {
+        64, 256, 1024, 4096, 16384, 65536, 262144, 1048576
+    };
+    o_text.clear();
+    Exposition  exposition(o_text);
+    std::string labels;
+    // ... process wide ...
+    exposition.Family("casper_inotify_queue_overflows_total", "counter", "Number of inotify and fanotify queue overflows, events were lost.");
+    exposition.Sample("casper_inotify_queue_overflows_total", "", stats_.overflows_);
+    exposition.Family("casper_inotify_reconciled_events_total", "counter", "Number of events synthesized by reconciliation after an overflow.");
+    exposition.Sample("casper_inotify_reconciled_events_total", "", stats_.reconciled_);
+    // ... by shard ...
+    std::vector<std::string> shards;
+    for ( auto shard : shards_ ) {
+        labels.clear();
+        Exposition::Label("shard", std::to_string(shard->index_), labels);
+        shards.push_back(labels);
+    }
+    exposition.Family("casper_inotify_reads_total", "counter", "Number of inotify reads that returned events.");
+    for ( size_t idx = 0 ; idx < shards_.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_reads_total", shards[idx], shards_[idx]->counters_.reads_.load(std::memory_order_relaxed));
+    }
+    exposition.Family("casper_inotify_read_bytes_total", "counter", "Number of bytes read from inotify.");
+    for ( size_t idx = 0 ; idx < shards_.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_read_bytes_total", shards[idx], shards_[idx]->counters_.bytes_.load(std::memory_order_relaxed));
+    }
+    exposition.Family("casper_inotify_read_events_total", "counter", "Number of events read from inotify.");
+    for ( size_t idx = 0 ; idx < shards_.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_read_events_total", shards[idx], shards_[idx]->counters_.events_.load(std::memory_order_relaxed));
+    }
+    exposition.Family("casper_inotify_read_size_bytes", "histogram", "Size of inotify reads.");
+    for ( size_t idx = 0 ; idx < shards_.size() ; ++idx ) {
+        Histogram::Totals totals;
+        shards_[idx]->sizes_.Collect(totals);
+        exposition.Distribution("casper_inotify_read_size_bytes", shards[idx], totals, sk_size_bounds_, 1.0);
+    }
+    exposition.Family("casper_inotify_dispatch_latency_seconds", "histogram", "Time from reading an event to dispatching it ( fanotify events are in shard 0 ).");
+    for ( size_t idx = 0 ; idx < shards_.size() ; ++idx ) {
+        Histogram::Totals totals;
+        shards_[idx]->latency_.Collect(totals);
+        exposition.Distribution("casper_inotify_dispatch_latency_seconds", shards[idx], totals, sk_latency_bounds_ns_, 1e-9);
+    }
+    // ... commands, entries stats are copied while locked and rendered after ...
+    typedef struct {
+        uint64_t launched_;
+        uint64_t failed_;
+        uint64_t dropped_;
+        size_t   running_;
+        size_t   pending_;
+    } Figures;
+    std::vector<const API::Entry*> entries;
+    std::vector<Figures>           snapshots;
+    if ( true == metrics_.entries_ ) {
+        entries.reserve(entries_.all_.size());
+        for ( auto entry : entries_.all_ ) {
+            // ... helpers are internal ...
+            if ( nullptr == entry->handler_ ) {
+                entries.push_back(entry);
+            }
+        }
+        snapshots.resize(entries.size());
+    }
+    size_t   running;
+    size_t   pending;
+    uint64_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running = children_.running_.size();
+        pending = children_.pending_.size();
+        dropped = children_.dropped_;
+        for ( const auto& it : pools_ ) {
+            for ( const auto& worker : it.second.workers_ ) {
+                running += ( nullptr != worker.entry_ ? 1 : 0 );
+            }
+            pending += it.second.pending_.size();
+        }
+        for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+            const auto& stats = entries[idx]->stats_;
+            snapshots[idx] = { stats.launched_, stats.failed_, stats.dropped_, stats.running_, stats.pending_ };
+        }
+    }
+    exposition.Family("casper_inotify_commands_running", "gauge", "Number of running commands.");
+    exposition.Sample("casper_inotify_commands_running", "", running);
+    exposition.Family("casper_inotify_commands_pending", "gauge", "Number of commands waiting to be launched.");
+    exposition.Sample("casper_inotify_commands_pending", "", pending);
+    exposition.Family("casper_inotify_commands_dropped_total", "counter", "Number of commands dropped because queue was full.");
+    exposition.Sample("casper_inotify_commands_dropped_total", "", dropped);
+    {
+        Histogram::Totals totals;
+        metrics_.durations_.Collect(totals);
+        exposition.Family("casper_inotify_command_duration_seconds", "histogram", "Commands duration, from launch to exit.");
+        exposition.Distribution("casper_inotify_command_duration_seconds", "", totals, sk_duration_bounds_us_, 1e-6);
+    }
+    // ... events stream ...
+    if ( true == stream_.IsOpen() ) {
+        exposition.Family("casper_inotify_stream_subscribers", "gauge", "Number of connected stream subscribers.");
+        exposition.Sample("casper_inotify_stream_subscribers", "", stream_.count());
+        exposition.Family("casper_inotify_stream_published_total", "counter", "Number of events published to stream subscribers.");
+        exposition.Sample("casper_inotify_stream_published_total", "", stream_.published());
+        exposition.Family("casper_inotify_stream_dropped_total", "counter", "Number of events dropped because a subscriber's queue was full.");
+        exposition.Sample("casper_inotify_stream_dropped_total", "", stream_.dropped());
+        exposition.Family("casper_inotify_stream_disconnected_total", "counter", "Number of subscribers disconnected because their queue was full.");
+        exposition.Sample("casper_inotify_stream_disconnected_total", "", stream_.disconnected());
+    }
+    // ... events ring ...
+    if ( true == ring_.IsOpen() ) {
+        exposition.Family("casper_inotify_ring_readers", "gauge", "Number of connected ring readers.");
+        exposition.Sample("casper_inotify_ring_readers", "", ring_.count());
+        exposition.Family("casper_inotify_ring_published_total", "counter", "Number of events published to the ring.");
+        exposition.Sample("casper_inotify_ring_published_total", "", ring_.published());
+        exposition.Family("casper_inotify_ring_truncated_total", "counter", "Number of events whose strings were cut to fit a ring slot.");
+        exposition.Sample("casper_inotify_ring_truncated_total", "", ring_.truncated());
+    }
+    // ... events journal ...
+    if ( true == journal_.IsOpen() ) {
+        exposition.Family("casper_inotify_journal_records_total", "counter", "Number of events appended to the journal.");
+        exposition.Sample("casper_inotify_journal_records_total", "", journal_.records());
+        exposition.Family("casper_inotify_journal_bytes_total", "counter", "Number of bytes appended to the journal.");
+        exposition.Sample("casper_inotify_journal_bytes_total", "", journal_.bytes());
+        exposition.Family("casper_inotify_journal_failures_total", "counter", "Number of events that could not be appended to the journal.");
+        exposition.Sample("casper_inotify_journal_failures_total", "", journal_.failures());
+        exposition.Family("casper_inotify_journal_rotations_total", "counter", "Number of journal segments started.");
+        exposition.Sample("casper_inotify_journal_rotations_total", "", journal_.rotations());
+    }
+    // ... handler plugins ...
+    if ( true == plugins_.IsRunning() ) {
+        exposition.Family("casper_inotify_plugin_handled_total", "counter", "Number of events handled by plugins.");
+        exposition.Sample("casper_inotify_plugin_handled_total", "", plugins_.handled());
+        exposition.Family("casper_inotify_plugin_failed_total", "counter", "Number of events plugins failed to handle.");
+        exposition.Sample("casper_inotify_plugin_failed_total", "", plugins_.failed());
+        exposition.Family("casper_inotify_plugin_dropped_total", "counter", "Number of events dropped because a plugin queue was full.");
+        exposition.Sample("casper_inotify_plugin_dropped_total", "", plugins_.dropped());
+        exposition.Family("casper_inotify_plugin_queued", "gauge", "Number of events waiting to be handled by plugins.");
+        exposition.Sample("casper_inotify_plugin_queued", "", plugins_.queued());
+        Histogram::Totals totals;
+        plugins_.durations().Collect(totals);
+        exposition.Family("casper_inotify_plugin_duration_seconds", "histogram", "Time plugins took to handle an event.");
+        exposition.Distribution("casper_inotify_plugin_duration_seconds", "", totals, sk_latency_bounds_ns_, 1e-9);
+    }
+    // ... by entry ...
+    if ( 0 == entries.size() ) {
+        return;
+    }
+    std::vector<std::string> ids;
+    ids.reserve(entries.size());
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        labels.clear();
+        Exposition::Label("entry", std::to_string(idx), labels);
+        Exposition::Label("uri", entries[idx]->uri_, labels);
+        ids.push_back(labels);
+    }
+    exposition.Family("casper_inotify_entry_events_total", "counter", "Number of events received, before patterns are applied, by event.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        for ( size_t bit = 0 ; bit < API_METRICS_EVENT_BITS ; ++bit ) {
+            const uint64_t value = entries[idx]->counters_.events_[bit].load(std::memory_order_relaxed);
+            if ( 0 == value ) {
+                continue;
+            }
+            const auto field = sk_field_id_to_name_map_.find(1u << bit);
+            labels = ids[idx];
+            Exposition::Label("event", sk_field_id_to_name_map_.end() != field ? field->second.key_ : ( IN_UNMOUNT == ( 1u << bit ) ? "unmount" : "ignored" ), labels);
+            exposition.Sample("casper_inotify_entry_events_total", labels, value);
+        }
+    }
+    exposition.Family("casper_inotify_entry_filtered_total", "counter", "Number of events discarded by patterns.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_filtered_total", ids[idx], entries[idx]->counters_.filtered_.load(std::memory_order_relaxed));
+    }
+    exposition.Family("casper_inotify_entry_spawned_total", "counter", "Number of commands launched.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_spawned_total", ids[idx], snapshots[idx].launched_);
+    }
+    exposition.Family("casper_inotify_entry_spawn_failures_total", "counter", "Number of commands that could not be launched.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_spawn_failures_total", ids[idx], entries[idx]->counters_.spawn_failures_.load(std::memory_order_relaxed));
+    }
+    exposition.Family("casper_inotify_entry_failed_total", "counter", "Number of commands that could not be launched or exited with an error.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_failed_total", ids[idx], snapshots[idx].failed_);
+    }
+    exposition.Family("casper_inotify_entry_dropped_total", "counter", "Number of commands dropped because queue was full.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_dropped_total", ids[idx], snapshots[idx].dropped_);
+    }
+    exposition.Family("casper_inotify_entry_commands_running", "gauge", "Number of running commands.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_commands_running", ids[idx], snapshots[idx].running_);
+    }
+    exposition.Family("casper_inotify_entry_commands_pending", "gauge", "Number of queued commands.");
+    for ( size_t idx = 0 ; idx < entries.size() ; ++idx ) {
+        exposition.Sample("casper_inotify_entry_commands_pending", ids[idx], snapshots[idx].pending_);
+    }
+}
+
+/**
+ * @brief (Re)start events journal, stream, ring and plugins threads, if their settings changed.
+ */
+void casper::inotify::API::Listen ()
+{
+    const bool handled = std::any_of(entries_.all_.begin(), entries_.all_.end(), [] (const API::Entry* a_entry) {
+        return API::Sink::_PluginSink == a_entry->sink_;
+    });
+    if ( false == handled ) {
+        plugins_.Stop();
+    } else if ( false == plugins_.Matches(handlers_.threads_, handlers_.capacity_) ) {
+        plugins_.Start(handlers_.threads_, handlers_.capacity_);
+        Log(API::LogLevel::_Info, "Handling plugins events on %zu thread(s)", handlers_.threads_);
+    }
+    if ( 0 == journaling_.directory_.length() ) {
+        journal_.Close();
+    } else if ( false == journal_.Matches(journaling_.directory_, journaling_.segment_size_, journaling_.segments_, journaling_.interval_ms_) ) {
+        journal_.Open(journaling_.directory_, journaling_.segment_size_, journaling_.segments_, journaling_.interval_ms_);
+        Log(API::LogLevel::_Info, "Journaling events to %s, %zu segments of %zu bytes", journaling_.directory_.c_str(), journaling_.segments_, journaling_.segment_size_);
+    }
+    if ( 0 == sink_.socket_.length() ) {
+        stream_.Close();
+    } else if ( false == stream_.Matches(sink_.socket_, sink_.format_, sink_.capacity_, sink_.policy_) ) {
+        stream_.Open(sink_.socket_, sink_.format_, sink_.capacity_, sink_.policy_, reactor_.fd_);
+        Log(API::LogLevel::_Info, "Streaming events to %s", sink_.socket_.c_str());
+    }
+    if ( 0 == sink_.ring_.socket_.length() ) {
+        ring_.Close();
+    } else if ( false == ring_.Matches(sink_.ring_.socket_, sink_.ring_.slots_, sink_.ring_.slot_size_) ) {
+        ring_.Open(sink_.ring_.socket_, sink_.ring_.slots_, sink_.ring_.slot_size_, reactor_.fd_);
+        Log(API::LogLevel::_Info, "Publishing events to ring %s, %zu slots of %zu bytes", sink_.ring_.socket_.c_str(), sink_.ring_.slots_, sink_.ring_.slot_size_);
+    }
+}
+
+/**
+ * @brief Dispatch journaled events again, to the configured entry each one was dispatched for.
+ *
+ * @note Called from main loop before shards are resumed; records of entries no longer configured are skipped.
+ */
+void casper::inotify::API::Replay ()
+{
+    if ( 0 == journaling_.directory_.length() ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " nothing to replay, events are not being journaled!");
+        return;
+    }
+    // ... records name entries by configuration hash, or by URI if configuration changed since ...
+    std::unordered_map<uint64_t, API::Entry*>    ids;
+    std::unordered_map<std::string, API::Entry*> uris;
+    for ( auto entry : entries_.all_ ) {
+        if ( nullptr != entry->handler_ ) {
+            continue;
+        }
+        ids[entry->id_] = entry;
+        const auto it = uris.find(entry->uri_);
+        if ( uris.end() == it ) {
+            uris[entry->uri_] = entry;
+        } else {
+            it->second = nullptr; // ... ambiguous ...
+        }
+    }
+    const auto     start   = std::chrono::steady_clock::now();
+    uint64_t       skipped = 0;
+    std::string    uri, parent, name, old_name;
+    API::Event     event;
+    const uint64_t count = Journal::Read(journaling_.directory_, replay_.sequence_, replay_.timestamp_, [&] (const Journal::View& a_view) {
+        const JournalRecord& record = *a_view.header_;
+        uri.assign(a_view.entry_, record.entry_length_);
+        API::Entry* entry = nullptr;
+        const auto id = ids.find(record.entry_id_);
+        if ( ids.end() != id && id->second->uri_ == uri ) {
+            entry = id->second;
+        } else {
+            const auto it = uris.find(uri);
+            entry = ( uris.end() != it ? it->second : nullptr );
+        }
+        if ( nullptr == entry ) {
+            skipped++;
+            return;
+        }
+        parent.assign(a_view.parent_, record.parent_length_);
+        name.assign(a_view.name_, record.name_length_);
+        old_name.assign(a_view.old_name_, record.old_name_length_);
+        // ... as it was first dispatched, subdirectories of recursive entries included ...
+        const bool inside = ( 0 != ( record.flags_ & STREAM_FLAG_INSIDE ) );
+        Decode(record.mask_, true == inside ? name.c_str() : nullptr, *entry, event);
+        Now(event.iso_8601_with_tz_, record.timestamp_);
+        if ( true == inside ) {
+            event.parent_object_name_ = parent.c_str();
+        } else {
+            event.object_name_c_str_  = name.c_str();
+        }
+        event.old_object_name_ = ( 0 != old_name.length() ? old_name.c_str() : nullptr );
+        Spawn(*entry, event, /* a_journal */ false);
+    });
+    Log(API::LogLevel::_Info, "Replayed %llu journaled event(s) in %lld ms, %llu skipped",
+        static_cast<unsigned long long>(count - skipped),
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()),
+        static_cast<unsigned long long>(skipped)
+    );
+}
+
+// MARK: -
+
+/**
+ * @brief Open a log file.
+ *
+ * @param a_uri      Log file URI.
+ * @param a_recycled True if it's a recycle request.
+ */
+void casper::inotify::API::Open (const std::string& a_uri, const bool a_recycled)
+{
+    // ... open ...
+    const int fd = open(a_uri.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if ( -1 == fd ) {
+        throw inotify::Exception("An error occurred while trying to open %s: %d - %s", 
+            a_uri.c_str(), errno, strerror(errno)
+        );
+    }
+    // ... pending lines are written to previous file, then it's closed ...
+    logger_.Open(fd);
+    log_.uri_ = a_uri;
+    // ...
+    if ( false == a_recycled ) {
+        // ... done ...
+        return;
+    }
+    // ...
+    char now[API_TIMESTAMP_MAX_LENGTH];
+    Print("--- --- ---\n");
+    Print("⌥ LOG FILE   : %s\n", log_.uri_.c_str());
+    Print("⌥ OWNERSHIP  : %4o\n", owner_.mode_);
+    // if ( not ( ( std::numeric_limits<uid_t>::max() == owner_.user_id_ || std::numeric_limits<gid_t>::max() == owner_.group_id_ ) || ( 0 == owner_.user_id_ || 0 == owner_.group_id_ ) ) ) {
+        Print("  - USER : %s ( %u )\n", owner_.user_name_.c_str() , owner_.user_id_);
+        Print("  - GROUP: %s ( %u )\n", owner_.group_name_.c_str(), owner_.group_id_);
+    // }
+    Print("⌥ PERMISSIONS:\n");
+    Print("  - MODE : %-4o\n", owner_.mode_);
+    Print("⌥ RECYCLED AT: %s\n", Now(now));
+    Print("--- --- ---\n");
+    logger_.Flush();
+    // ... ensure ownership ... 
+    const int chown_status = chown(a_uri.c_str(), owner_.user_id_, owner_.group_id_);
+    if ( 0 != chown_status ) {
+        syslog(LOG_WARNING, "WARNING: failed to change ownership of %s to %u:%u ~ %d - %s\n", log_.uri_.c_str(), owner_.user_id_, owner_.group_id_, errno, strerror(errno));
+    }
+    const int chmod_status = chmod(a_uri.c_str(), owner_.mode_);
+    if ( 0 != chmod_status ) {
+        syslog(LOG_WARNING, "WARNING: failed to change permissions of %s to %o ~ %d - %s\n", log_.uri_.c_str(), owner_.mode_, errno, strerror(errno));
+    }
+    // ... log ...
+    syslog(LOG_NOTICE, "%s recycled.", log_.uri_.c_str());
+}
+
+/**
+ * @brief Log all entries.
+ *
+ * @param a_entry Entries to log.
+ */
+void casper::inotify::API::Log (const API::Entries& a_entries)
+{
+    // ... log all entries ...
+    for ( auto& entry : a_entries.all_ ) {
+        if ( -1 != entry->wd_ ) {
+            Log(LOGGER_PASS_SYMBOL, *entry);
+        } else {
+            Log(LOGGER_FAIL_SYMBOL, *entry);
+        }
+    }
+}
+
+/**
+ * @brief Log an action trigger for a specific entry.
+ *
+ * @param a_symbol Symbol to log.
+ * @param a_entry  Entry to log.
+ */
+void casper::inotify::API::Log (const char* const a_symbol, const API::Entry& a_entry)
+{
+    const std::string log_suffix = 0 != a_entry.pattern_.length() ? ", " + a_entry.pattern_ : "";
+    // ...
+    char t;
+    switch(a_entry.type_) {
+        case API::Type::_Directory:
+            t = 'd';
+            break;
+        case API::Type::_File:
+            t = 'f';
+            break;
+        default:
+            t = '?';
+            break;
+    }
+    // ...
+    if ( -1 != a_entry.wd_ ) {
+        Log(API::LogLevel::_Info, " %s [%c] %-*.*s, 0x%08X ⇥ %d%s",
+            a_symbol, t, log_.entry_ml_, log_.entry_ml_, a_entry.uri_.c_str(), a_entry.mask_, a_entry.wd_, log_suffix.c_str());
+    } else {
+        Log(API::LogLevel::_Info, " %s [%c] %-*.*s, 0x%08X ⌁ " LOGGER_FAIL_SYMBOL,
+            a_symbol, t, log_.entry_ml_, log_.entry_ml_, a_entry.uri_.c_str(), a_entry.mask_);
+        if ( 0 != a_entry.error_.length() ) {
+            Log(API::LogLevel::_Error," " LOGGER_FAIL_SYMBOL " %s", a_entry.error_.c_str());
+        } else if ( 0 != a_entry.warning_.length() ) {
+            Log(API::LogLevel::_Warning," " LOGGER_WARNING_SYMBOL " %s", a_entry.warning_.c_str());
         }
     }
 }
@@ -799,388 +2707,1860 @@ void casper::inotify::API::Log (const char* const a_symbol, const API::Entry& a_
 /**
  * @brief Log an event trigger for a specific entry.
  *
- * @param a_level   One of \link API::LogLevel \link.
- * @param a_entry   Entry to log.
- * @param a_event   Event to log.
- * @param a_actions Actions to log.
+ * @param a_level One of \link API::LogLevel \link.
+ * @param a_entry Entry to log.
+ * @param a_event Event to log.
+ */
+void casper::inotify::API::Log (const API::LogLevel a_level,
+                                const API::Event& a_event, const API::Entry& a_entry)
+{
+    // ... no log?
+    if ( false == logger_.IsOpen() || a_level > log_.level_ ) {
+        // ... nothing to do here ...
+        return;
+    }
+    // ... basic ...
+    const std::string pattern = 0 != a_entry.pattern_.length() ? ", " + a_entry.pattern_ : "";
+    Log(a_level, "➢ %u, %s%s", a_entry.wd_, a_entry.uri_.c_str(), pattern.c_str());
+    Log(a_level, "➢ 0x%08X", a_event.mask_);
+    if ( nullptr != a_event.old_object_name_ ) {
+        Log(a_level, "➢ renamed from %s", a_event.old_object_name_);
+    }
+    // ... extended ...
+    if ( a_level >= API::LogLevel::_Debug ) {
+        Log(API::LogLevel::_Debug, "➢ %c, 0x%08X, %s @ %s", a_event.object_type_c_, a_entry.mask_, a_event.object_name_c_str_, a_event.parent_object_name_);
+        for ( size_t idx = 0 ; nullptr != sk_actions_[idx].name_ ; ++idx ) {
+            if ( 0 != ( a_event.actions_ & ( 1u << idx ) ) ) {
+                Log(API::LogLevel::_Debug, "    ➢ %s", sk_actions_[idx].name_);
+            }
+        }
+    }
+    // ... basic ...
+    if ( nullptr != a_entry.plugin_ ) {
+        Log(a_level, " ⇥ PLUGIN %s", a_entry.plugin_->name());
+    } else {
+        Log(a_level, " ⇥ (%s) CMD %s", a_entry.user_.c_str(), a_entry.cmd_.c_str());
+    }
+}
+
+/**
+ * @brief Write a log entry.
+ *
+ * @param a_level  One of \link API::LogLevel \link.
+ * @param a_format fprintf like format.
+ * @param ...
+ */
+void casper::inotify::API::Log (const API::LogLevel a_level, const char* const a_format, ...)
+{
+    // ... no log?
+    if ( false == logger_.IsOpen() || a_level > log_.level_ ) {
+        // ... nothing to do here ...
+        return;
+    }
+    // .... log ....
+    const char* what;
+    const char* color = LOGGER_RESET_ATTRS;
+    switch(a_level) {
+        case API::LogLevel::_Info:
+            what = "Info";
+            break;
+        case API::LogLevel::_Warning:
+            what = "Warning";
+            color = LOGGER_COLOR(YELLOW);
+            break;
+        case API::LogLevel::_Error:
+            what = "Error";
+            color = LOGGER_COLOR(RED);
+            break;
+        case API::LogLevel::_Event:
+            what = "Event";
+            break;
+        case API::LogLevel::_Debug:
+            what = "Debug";
+            color = LOGGER_COLOR(DARK_GRAY);
+            break;
+        default:
+            what = "???";
+            color = LOGGER_COLOR(RED);
+            break;
+    }
+    // ... format in a stack buffer, lines that do not fit are rare ...
+    static const char   sk_suffix[]      = LOGGER_RESET_ATTRS "\n";
+    static const size_t sk_suffix_length = sizeof(sk_suffix) - 1;
+    char now[API_TIMESTAMP_MAX_LENGTH];
+    char buffer[API_LOG_LINE_MAX_LENGTH];
+    const int header = snprintf(buffer, sizeof(buffer), "%s, %8d, %-10.10s, %s", Now(now), pid_, what, color);
+    if ( header < 0 || static_cast<size_t>(header) >= sizeof(buffer) ) {
+        throw std::runtime_error {"string formatting error"};
+    }
+    std::va_list args;
+    va_start(args, a_format);
+    const int body = std::vsnprintf(buffer + header, sizeof(buffer) - static_cast<size_t>(header), a_format, args);
+    va_end(args);
+    if ( body < 0 ) {
+        throw std::runtime_error {"string formatting error"};
+    }
+    const size_t length = static_cast<size_t>(header) + static_cast<size_t>(body);
+    if ( length + sk_suffix_length < sizeof(buffer) ) {
+        memcpy(buffer + length, sk_suffix, sk_suffix_length);
+        logger_.Write(buffer, length + sk_suffix_length);
+    } else {
+        std::vector<char> temp(length + sk_suffix_length + 1);
+        memcpy(temp.data(), buffer, static_cast<size_t>(header));
+        va_start(args, a_format);
+        (void)std::vsnprintf(temp.data() + header, temp.size() - static_cast<size_t>(header), a_format, args);
+        va_end(args);
+        memcpy(temp.data() + length, sk_suffix, sk_suffix_length);
+        logger_.Write(temp.data(), length + sk_suffix_length);
+    }
+}
+
+/**
+ * @brief Write a raw line, no header is added.
+ *
+ * @param a_format printf like format.
+ * @param ...
+ */
+void casper::inotify::API::Print (const char* const a_format, ...)
+{
+    char buffer[API_LOG_LINE_MAX_LENGTH];
+    std::va_list args;
+    va_start(args, a_format);
+    const int length = std::vsnprintf(buffer, sizeof(buffer), a_format, args);
+    va_end(args);
+    if ( length < 0 ) {
+        throw std::runtime_error {"string formatting error"};
+    }
+    logger_.Write(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+}
+
+/**
+ * @brief Dump fields info.
+ *
+ * @param a_level  One of \link API::LogLevel \link.
+ * @param a_fields Fields info do dump.
+ */
+void casper::inotify::API::Log (const API::LogLevel a_level, const std::map<uint32_t, const FieldInfo>& a_fields)
+{
+     // ... no log?
+    if ( false == logger_.IsOpen() || a_level > log_.level_ ) {
+        // ... nothing to do here ...
+        return;
+    }
+    // .... log ....
+    const std::string spacer = std::string(140, '-') + '\n';
+    Print("%s", spacer.c_str());
+    for ( const auto& it : a_fields ) {
+        Print("\t0x%08X - %-16.16s - %-13.13s - %s\n", it.first, it.second.name_, it.second.key_, it.second.description_);
+    }
+    Print("%s", spacer.c_str());
+}
+
+// MARK: -
+
+/**
+ * @brief Entry constructor, everything but what is given is set to it's default.
+ *
+ * @param a_type    One of \link API::Type \link.
+ * @param a_uri     URI for file or directory.
+ * @param a_mask    Event mask.
+ * @param a_user    User commands are executed as.
+ * @param a_cmd     Command to execute.
+ * @param a_msg     Message to export.
+ * @param a_handler Management / special handler.
+ */
+casper::inotify::API::_Entry::_Entry (const API::Type a_type, const std::string& a_uri, const uint32_t a_mask,
+                                      const std::string& a_user, const std::string& a_cmd, const std::string& a_msg,
+                                      const std::function<bool(const struct _Entry&, const Event&)>& a_handler)
+    : type_(a_type), uri_(a_uri), mask_(a_mask), wd_(-1), user_(a_user), cmd_(a_cmd), msg_(a_msg), handler_(a_handler)
+{
+    credentials_    = nullptr;
+    pool_           = nullptr;
+    debounce_ms_    = 0;
+    max_concurrent_ = 0;
+    recursive_      = false;
+    extra_mask_     = 0;
+    root_           = nullptr;
+    backend_        = API::Backend::_INotifyBackend;
+    mark_           = 0;
+    reconcile_      = false;
+    shard_          = nullptr;
+    sink_           = API::Sink::_CommandSink;
+    id_             = 0;
+    stats_          = { 0, 0, 0, 0, 0, 0, 0 };
+    for ( size_t idx = 0 ; idx < API_METRICS_EVENT_BITS ; ++idx ) {
+        counters_.events_[idx] = 0;
+    }
+    counters_.filtered_       = 0;
+    counters_.spawn_failures_ = 0;
+}
+
+/**
+ * @brief Add a new entry.
+ * 
+ * @param a_type    One of \link API::Type \link.
+ * @param a_object  JSON object that defines this new entry.
+ * @param a_uri     URI for file or directory.
+ * @param a_mask    Event mask.
+ * @param a_handler Management / special handler.
+ */
+void casper::inotify::API::Add (const API::Type a_type, const Json::Value& a_object,
+                                const std::string& a_uri, uint32_t a_mask,
+                                std::function<bool(const struct _Entry&, const Event&)> a_handler)
+{
+    static const Json::Value dummy_string = Json::Value("");
+    // ... set ...
+    switch (a_type) {
+        case API::Type::_Directory:
+            if ( nullptr == a_handler ) {
+                entries_.uris_.directories_.insert(a_uri);
+            }            
+        break;
+        case API::Type::_File:
+            if ( nullptr == a_handler ) {
+                entries_.uris_.files_.insert(a_uri);
+            }           
+        break; 
+        default:
+            throw inotify::Exception("Unknown entry type: %u!", (unsigned)a_type);
+        break;
+    }
+    // ... unchanged since configuration was last loaded?
+    std::string key = std::to_string(a_type) + '\0' + a_uri + '\0' + std::to_string(a_mask) + '\0' + ( nullptr != a_handler ? "h" : "" )
+                    + '\0' + defaults_.key_ + '\0' + Json::FastWriter().write(a_object);
+    if ( nullptr != reloading_ ) {
+        const auto it = reloading_->unmatched_.find(key);
+        if ( reloading_->unmatched_.end() != it && false == it->second.empty() ) {
+            entries_.all_.push_back(it->second.back());
+            it->second.pop_back();
+            reloading_->kept_++;
+            return;
+        }
+    }
+    // ... collect ...
+    entries_.all_.push_back(new API::Entry(a_type, a_uri, a_mask,
+        a_object.get("user", defaults_.user_).asString(),
+        a_object.get("command", defaults_.command_).asString(),
+        a_object.get("message", defaults_.message_).asString(),
+        a_handler
+    ));
+    // ... parse command and message once ...
+    API::Entry* entry = entries_.all_.back();
+    entry->key_ = std::move(key);
+    entry->id_  = Journal::Hash(entry->key_);
+    if ( nullptr != reloading_ ) {
+        reloading_->added_.push_back(entry);
+    }
+    entry->cmd_tpl_.Compile(entry->cmd_, sk_variables_, API::Variable::_VariablesCount);
+    entry->msg_tpl_.Compile(entry->msg_, sk_variables_, API::Variable::_VariablesCount);
+    // ... and patterns, a string or an array of strings, '!' excludes ...
+    {
+        const Json::Value&       pattern = a_object.get("pattern", dummy_string);
+        std::vector<std::string> patterns;
+        if ( true == pattern.isArray() ) {
+            for ( Json::ArrayIndex idx = 0 ; idx < pattern.size() ; ++idx ) {
+                patterns.push_back(pattern[idx].asString());
+            }
+        } else if ( 0 != pattern.asString().length() ) {
+            patterns.push_back(pattern.asString());
+        }
+        for ( const auto& it : patterns ) {
+            entry->pattern_.append(0 != entry->pattern_.length() ? " " : "").append(it);
+        }
+        entry->glob_.Compile(patterns);
+    }
+    // ... resolve user once ...
+    entry->credentials_    = Resolve(entry->user_);
+    entry->max_concurrent_ = static_cast<size_t>(a_object.get("max_concurrent", static_cast<Json::UInt>(defaults_.max_concurrent_)).asUInt());
+    entry->debounce_ms_    = static_cast<size_t>(a_object.get("debounce_ms", static_cast<Json::UInt>(defaults_.debounce_ms_)).asUInt());
+    // ... backend, management entries always use inotify ...
+    const std::string backend = a_object.get("backend", "inotify").asString();
+    if ( 0 == backend.compare("inotify") || nullptr != a_handler ) {
+        entry->backend_ = API::Backend::_INotifyBackend;
+        entry->mark_    = 0;
+    } else if ( 0 == backend.compare("fanotify") ) {
+        entry->backend_ = API::Backend::_FANotifyBackend;
+        const std::string mark = a_object.get("mark", "filesystem").asString();
+        if ( 0 == mark.compare("filesystem") ) {
+            entry->mark_ = FAN_MARK_FILESYSTEM;
+        } else if ( 0 == mark.compare("mount") ) {
+            entry->mark_ = FAN_MARK_MOUNT;
+        } else {
+            throw inotify::Exception("Unknown fanotify mark '%s' for %s!", mark.c_str(), a_uri.c_str());
+        }
+    } else {
+        throw inotify::Exception("Unknown backend '%s' for %s!", backend.c_str(), a_uri.c_str());
+    }
+    // ... shard, explicit or by directory, so that file entries share it with their IN_CREATE helper;
+    //     fanotify events are always read on main loop ...
+    size_t shard = 0;
+    if ( API::Backend::_FANotifyBackend == entry->backend_ ) {
+        shard = 0;
+    } else if ( true == a_object.isMember("shard") ) {
+        shard = static_cast<size_t>(a_object["shard"].asUInt());
+        if ( shard >= shards_.size() ) {
+            throw inotify::Exception("Invalid shard #%zu for %s, only %zu shard(s) configured!", shard, a_uri.c_str(), shards_.size());
+        }
+    } else {
+        shard = std::hash<std::string>()(API::Type::_File == a_type ? a_uri.substr(0, a_uri.rfind('/')) : a_uri) % shards_.size();
+    }
+    entry->shard_          = shards_[shard];
+    // ... snapshots are only kept for inotify entries ...
+    entry->reconcile_      = ( API::Backend::_INotifyBackend == entry->backend_ && nullptr == a_handler
+                              && true == a_object.get("reconcile", defaults_.reconcile_).asBool() );
+    // ... fanotify directory entries already cover the whole tree ...
+    entry->recursive_      = ( API::Type::_Directory == a_type && nullptr == a_handler && API::Backend::_INotifyBackend == entry->backend_
+                              && true == a_object.get("recursive", false).asBool() );
+    if ( true == entry->recursive_ ) {
+        // ... subdirectories must be tracked, even if those events were not requested ...
+        const uint32_t required = ( IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO );
+        entry->extra_mask_ = ( required & ~entry->mask_ );
+        entry->mask_      |= required;
+    }
+    // ... commands executed by a persistent pool of workers?
+    const std::string executor = a_object.get("executor", defaults_.executor_).asString();
+    if ( 0 == executor.compare("pool") ) {
+        API::Pool& pool = pools_[entry->user_];
+        if ( 0 == pool.workers_.size() ) {
+            API::Worker worker;
+            worker.fd_       = -1;
+            worker.pid_      = -1;
+            worker.entry_    = nullptr;
+            worker.failures_ = 0;
+            pool.credentials_ = entry->credentials_;
+            pool.workers_.resize(defaults_.workers_, worker);
+        }
+        entry->pool_ = &pool;
+    } else if ( 0 != executor.compare("process") ) {
+        throw inotify::Exception("Unknown executor '%s' for %s!", executor.c_str(), a_uri.c_str());
+    }
+    // ... or events published to stream subscribers or ring readers, or handled by a plugin, instead of commands?
+    const std::string sink = ( true == a_object.isMember("plugin") ? "plugin" : a_object.get("sink", defaults_.sink_).asString() );
+    if ( 0 == sink.compare("socket") && nullptr == a_handler ) {
+        if ( 0 == sink_.socket_.length() ) {
+            throw inotify::Exception("Sink of %s is a socket, but no stream socket is configured!", a_uri.c_str());
+        }
+        entry->sink_ = API::Sink::_SocketSink;
+    } else if ( 0 == sink.compare("ring") && nullptr == a_handler ) {
+        if ( 0 == sink_.ring_.socket_.length() ) {
+            throw inotify::Exception("Sink of %s is a ring, but no ring socket is configured!", a_uri.c_str());
+        }
+        entry->sink_ = API::Sink::_RingSink;
+    } else if ( 0 == sink.compare("plugin") && nullptr == a_handler ) {
+        // ... { "library": "<shared object>", "config": <any, handed to it's init as JSON text> } ...
+        const Json::Value& plugin  = a_object.get("plugin", Json::Value::null);
+        const std::string  library = plugin.get("library", "").asString();
+        if ( 0 == library.length() ) {
+            throw inotify::Exception("Sink of %s is a plugin, but no plugin library is configured!", a_uri.c_str());
+        }
+        std::string config = Json::FastWriter().write(plugin.get("config", Json::Value(Json::objectValue)));
+        while ( 0 != config.length() && '\n' == config.back() ) {
+            config.pop_back();
+        }
+        entry->plugin_ = plugins_.Load(library, config);
+        entry->sink_   = API::Sink::_PluginSink;
+    } else if ( 0 == sink.compare("command") || nullptr != a_handler ) {
+        entry->sink_ = API::Sink::_CommandSink;
+    } else {
+        throw inotify::Exception("Unknown sink '%s' for %s!", sink.c_str(), a_uri.c_str());
+    }
+}
+
+// MARK: -
+
+/**
+ * @brief Call when an entry must be tracked. 
+ * 
+ * @param a_entry Entry to track.
+ * @param a_good  True when it's a good entry.
+ * @param a_log   True when a log entry should be created.
+ */
+
+void casper::inotify::API::Track (API::Entry* a_entry, const bool a_good, const bool a_log)
+{
+    if ( true == a_good && API::Backend::_FANotifyBackend == a_entry->backend_ ) {
+        // ... as 'good' entry, not indexed by watch descriptor ...
+        fanotify_.entries_.push_back(a_entry);
+        // ... log?
+        if ( true == a_log ) {
+            Log(LOGGER_PASS_SYMBOL, *a_entry);
+        }
+    } else if ( true == a_good ) {
+        // ... as 'good' entry ...
+        std::vector<API::Group*>& watches = a_entry->shard_->watches_;
+        if ( static_cast<size_t>(a_entry->wd_) >= watches.size() ) {
+            watches.resize(static_cast<size_t>(a_entry->wd_) + 1, nullptr);
+        }
+        if ( nullptr == watches[a_entry->wd_] ) {
+            // ... watch was just added for this entry ...
+            watches[a_entry->wd_] = new API::Group();
+            watches[a_entry->wd_]->mask_ = a_entry->mask_;
+        }
+        // ... sharing it with other entries on the same object?
+        API::Group* watch = watches[a_entry->wd_];
+        watch->entries_.push_back(a_entry);
+        watch->index_.Add(nullptr != a_entry->root_ ? a_entry->root_->glob_ : a_entry->glob_);
+        Rewatch(*a_entry->shard_, *watch);
+        // ... log?
+        if ( true == a_log ) {
+            Log(LOGGER_PASS_SYMBOL, *a_entry);
+        }
+    } else {
+        // ... as 'bad' entry ...
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.bad_[a_entry->uri_].push_back(a_entry);
+        }
+        // ... log?
+        if ( true == a_log ) {
+            Log(LOGGER_FAIL_SYMBOL, *a_entry);
+        }
+    }
+}
+
+
+/**
+ * @brief Call when an entry must be untracked. 
+ * 
+ * @param a_entry  Entry to untrack.
+ * @param a_reason Reason for this call.
+ * @param a_log    True when a log entry should be created.
+ */
+void casper::inotify::API::Untrack (API::Entry* a_entry, const char* const a_reason, const bool a_log)
+{
+    // ... untrack ...
+    Release(a_entry);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.bad_[a_entry->uri_].push_back(a_entry);
+    }
+    a_entry->wd_      = -1;
+    a_entry->warning_ = ( nullptr != a_reason ? a_reason : "" );
+    // ... log?
+    if ( true == a_log ) {
+        Log(LOGGER_FAIL_SYMBOL, *a_entry);
+    }
+}
+
+/**
+ * @brief Find tracked entries by their watch descriptor.
+ *
+ * @param a_shard Shard whose inotify instance allocated the watch descriptor.
+ * @param a_wd    Watch descriptor.
+ *
+ * @return Entries sharing this watch descriptor, nullptr if none.
+ */
+casper::inotify::API::Group* casper::inotify::API::Lookup (const API::Shard& a_shard, const int a_wd) const
+{
+    if ( a_wd < 0 || static_cast<size_t>(a_wd) >= a_shard.watches_.size() ) {
+        return nullptr;
+    }
+    return a_shard.watches_[a_wd];
+}
+
+/**
+ * @brief Remove a tracked entry from it's watch, the watch is released with it's last entry.
+ *
+ * @param a_entry Entry to remove.
+ */
+void casper::inotify::API::Release (API::Entry* a_entry)
+{
+    API::Shard& shard = *a_entry->shard_;
+    API::Group* watch = Lookup(shard, a_entry->wd_);
+    if ( nullptr == watch ) {
+        return;
+    }
+    const auto it = std::find(watch->entries_.begin(), watch->entries_.end(), a_entry);
+    if ( watch->entries_.end() == it ) {
+        return;
+    }
+    watch->entries_.erase(it);
+    if ( false == watch->entries_.empty() ) {
+        // ... re-index remaining ...
+        watch->index_.Clear();
+        for ( auto entry : watch->entries_ ) {
+            watch->index_.Add(nullptr != entry->root_ ? entry->root_->glob_ : entry->glob_);
+        }
+        // ... events only it requested are no longer watched ...
+        Rewatch(shard, *watch);
+        return;
+    }
+    // ... last one, caller decides if kernel watch is removed ...
+    delete watch;
+    shard.watches_[a_entry->wd_] = nullptr;
+    // ... wds are allocated cyclically, release trailing slots ...
+    while ( false == shard.watches_.empty() && nullptr == shard.watches_.back() ) {
+        shard.watches_.pop_back();
+    }
+}
+
+/**
+ * @brief Set a shared kernel watch to the union of it's entries masks, when that changed.
+ *
+ * @param a_shard Shard the watch belongs to.
+ * @param a_watch Watch, with at least one entry.
+ * @param a_force When true, mask is set even if it's believed to be unchanged.
+ */
+void casper::inotify::API::Rewatch (API::Shard& a_shard, API::Group& a_watch, const bool a_force)
+{
+    uint32_t mask = 0;
+    for ( auto entry : a_watch.entries_ ) {
+        mask |= entry->mask_;
+    }
+    if ( true == a_watch.ignored_ || ( mask == a_watch.mask_ && false == a_force ) ) {
+        return;
+    }
+    // ... without IN_MASK_ADD, mask replaces the current one ...
+    const API::Entry* entry = a_watch.entries_[0];
+    const int         wd    = inotify_add_watch(a_shard.fd_, entry->uri_.c_str(), mask);
+    if ( wd == entry->wd_ ) {
+        a_watch.mask_ = mask;
+        return;
+    }
+    // ... path no longer names the watched object: a watch added by mistake is removed, a watch of other entries
+    //     is set back to their mask ...
+    if ( -1 != wd ) {
+        API::Group* other = Lookup(a_shard, wd);
+        if ( nullptr == other ) {
+            (void)inotify_rm_watch(a_shard.fd_, wd);
+        } else if ( mask != other->mask_ ) {
+            (void)inotify_add_watch(a_shard.fd_, entry->uri_.c_str(), other->mask_);
+        }
+    }
+    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " unable to set events of %s to 0x%08X!", entry->uri_.c_str(), mask);
+}
+
+/**
+ * @brief Watch all subdirectories of a recursive entry.
+ *
+ * @param a_entry      Recursive entry, or one of it's subdirectories, already watched.
+ * @param a_synthesize When true, objects found are reported as created; used for new directories, that
+ *                     might have been populated before being watched, and walked by the shard thread alone.
+ */
+void casper::inotify::API::Descend (API::Entry* a_entry, const bool a_synthesize)
+{
+    API::Entry* root = ( nullptr != a_entry->root_ ? a_entry->root_ : a_entry );
+    // ... walk ...
+    const auto             start = std::chrono::steady_clock::now();
+    std::vector<Scanned>   scanned;
+    std::vector<Found>     found;
+    // ... only (re)loads walk in parallel, a burst of new directories must not start threads on a shard ...
+    const size_t           threads = ( true == a_synthesize ? 1 : defaults_.scan_threads_ );
+    Scan(a_entry->shard_->fd_, a_entry->uri_, root->mask_, threads, scanned, true == a_synthesize ? &found : nullptr);
+    // ... track ...
+    size_t         added  = 0;
+    size_t         failed = 0;
+    const Scanned* error  = nullptr;
+    for ( const auto& it : scanned ) {
+        if ( -1 == it.wd_ ) {
+            if ( nullptr == error ) {
+                error = &it;
+            }
+            failed++;
+            continue;
+        }
+        // ... already watched for this tree ( e.g. reported by both an event and a scan ) ?
+        if ( true == Covers(*a_entry->shard_, it.wd_, root) ) {
+            continue;
+        }
+        (void)Derive(root, it.uri_, it.wd_);
+        added++;
+    }
+    // ... log ...
+    Log(true == a_synthesize ? API::LogLevel::_Debug : API::LogLevel::_Info, "➢ %s, %zu subdirectories watched in %lld ms",
+        a_entry->uri_.c_str(), added,
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count())
+    );
+    if ( nullptr != error ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " %zu subdirectories of %s are not watched, first was %s: %d - %s",
+            failed, a_entry->uri_.c_str(), error->uri_.c_str(), error->errno_, strerror(error->errno_)
+        );
+    }
+    // ... report objects that were created before their directory was watched ...
+    for ( const auto& it : found ) {
+        API::Entry* parent = a_entry;
+        if ( it.parent_ != a_entry->uri_ ) {
+            const auto derived = a_entry->shard_->derived_.find(it.parent_);
+            if ( a_entry->shard_->derived_.end() == derived ) {
+                continue;
+            }
+            parent = derived->second;
+        }
+        if ( 0 != ( ( parent->mask_ & ~parent->extra_mask_ ) & IN_CREATE ) ) {
+            Dispatch(*parent, IN_CREATE | ( true == it.directory_ ? IN_ISDIR : 0 ), it.name_.c_str());
+        }
+    }
+}
+
+/**
+ * @brief Walk a directory tree and watch every subdirectory, before listing it's contents.
+ *
+ * @param a_fd      inotify instance to add watches to.
+ * @param a_uri     Directory to walk, it's not watched by this call.
+ * @param a_mask    Event mask for subdirectories.
+ * @param a_threads Number of threads to walk the tree with.
+ * @param o_scanned Subdirectories found and their watch descriptors.
+ * @param o_found   When not nullptr, all objects found.
+ *
+ * @note Does not touch this instance's state, so it can be called from multiple threads.
+ */
+void casper::inotify::API::Scan (const int a_fd, const std::string& a_uri, const uint32_t a_mask, const size_t a_threads,
+                                 std::vector<API::Scanned>& o_scanned, std::vector<API::Found>* o_found) const
+{
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::deque<std::string> queue = { a_uri };
+    size_t                  busy  = 0;
+    // ... each thread pops a directory, lists it with large getdents64 batches and queues subdirectories ...
+    const auto walk = [&] () {
+        std::vector<char>        buffer(API_SCAN_BUFFER_SIZE);
+        std::vector<Scanned>     scanned;
+        std::vector<Found>       found;
+        std::vector<std::string> next;
+        while ( true ) {
+            std::string directory;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&queue, &busy] { return false == queue.empty() || 0 == busy; });
+                if ( true == queue.empty() ) {
+                    break;
+                }
+                directory = std::move(queue.front());
+                queue.pop_front();
+                busy++;
+            }
+            const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | ( directory != a_uri ? O_NOFOLLOW : 0 ));
+            if ( -1 != fd ) {
+                long length;
+                while ( ( length = syscall(SYS_getdents64, fd, buffer.data(), buffer.size()) ) > 0 ) {
+                    for ( long offset = 0 ; offset < length ; ) {
+                        const struct dirent64* entry = reinterpret_cast<const struct dirent64*>(buffer.data() + offset);
+                        offset += entry->d_reclen;
+                        if ( '.' == entry->d_name[0] && ( '\0' == entry->d_name[1] || ( '.' == entry->d_name[1] && '\0' == entry->d_name[2] ) ) ) {
+                            continue;
+                        }
+                        bool is_directory = ( DT_DIR == entry->d_type );
+                        if ( DT_UNKNOWN == entry->d_type ) {
+                            struct stat st;
+                            is_directory = ( 0 == fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) && S_ISDIR(st.st_mode) );
+                        }
+                        if ( nullptr != o_found ) {
+                            found.push_back({ directory, entry->d_name, is_directory });
+                        }
+                        if ( false == is_directory ) {
+                            continue;
+                        }
+                        // ... watch before listing, so that objects created meanwhile are reported ...
+                        std::string uri = directory + '/' + entry->d_name;
+                        const int   wd  = inotify_add_watch(a_fd, uri.c_str(), a_mask | IN_ONLYDIR | IN_DONT_FOLLOW | IN_MASK_ADD);
+                        scanned.push_back({ uri, wd, -1 == wd ? errno : 0 });
+                        if ( -1 != wd ) {
+                            next.push_back(std::move(uri));
+                        }
+                    }
+                }
+                close(fd);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for ( auto& uri : next ) {
+                    queue.push_back(std::move(uri));
+                }
+                busy--;
+            }
+            next.clear();
+            cv.notify_all();
+        }
+        // ... merge ...
+        std::lock_guard<std::mutex> lock(mutex);
+        o_scanned.insert(o_scanned.end(), std::make_move_iterator(scanned.begin()), std::make_move_iterator(scanned.end()));
+        if ( nullptr != o_found ) {
+            o_found->insert(o_found->end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+        }
+    };
+    // ... this thread is one of the walkers ...
+    std::vector<std::thread> threads;
+    for ( size_t idx = 1 ; idx < a_threads ; ++idx ) {
+        threads.emplace_back(walk);
+    }
+    walk();
+    for ( auto& thread : threads ) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Keep subdirectories of a recursive entry watched when they are created or moved.
+ *
+ * @param a_entry Recursive entry, or one of it's subdirectories, where event was triggered.
+ * @param a_mask  Event mask.
+ * @param a_name  Subdirectory name.
+ */
+void casper::inotify::API::Propagate (API::Entry* a_entry, const uint32_t a_mask, const char* const a_name)
+{
+    const std::string uri = a_entry->uri_ + '/' + a_name;
+    if ( a_mask & ( IN_CREATE | IN_MOVED_TO ) ) {
+        API::Entry* root = ( nullptr != a_entry->root_ ? a_entry->root_ : a_entry );
+        // ... other entries might be watching it already, add to their events ...
+        const int   wd   = inotify_add_watch(a_entry->shard_->fd_, uri.c_str(), root->mask_ | IN_ONLYDIR | IN_DONT_FOLLOW | IN_MASK_ADD);
+        if ( -1 == wd ) {
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " %s is not watched: %d - %s", uri.c_str(), errno, strerror(errno));
+            return;
+        }
+        if ( true == Covers(*a_entry->shard_, wd, root) ) {
+            return;
+        }
+        // ... it might have been populated before it was watched ...
+        Descend(Derive(root, uri, wd), /* a_synthesize */ true);
+    } else if ( a_mask & IN_MOVED_FROM ) {
+        // ... moved out, or renamed, watches for old path(s) are no longer valid ...
+        Prune(*a_entry->shard_, uri);
+    }
+}
+
+/**
+ * @return True when a watch already reports to a recursive entry, directly or through one of it's subdirectories.
+ *
+ * @param a_shard Shard the recursive entry belongs to.
+ * @param a_wd    Subdirectory watch descriptor.
+ * @param a_root  Configured recursive entry.
+ */
+bool casper::inotify::API::Covers (const API::Shard& a_shard, const int a_wd, const API::Entry* a_root) const
+{
+    const API::Group* watch = Lookup(a_shard, a_wd);
+    if ( nullptr == watch ) {
+        return false;
+    }
+    for ( const auto entry : watch->entries_ ) {
+        if ( a_root == entry || a_root == entry->root_ ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Create and track an entry for a subdirectory of a recursive entry.
+ *
+ * @param a_root Configured recursive entry.
+ * @param a_uri  Subdirectory URI.
+ * @param a_wd   Subdirectory watch descriptor.
+ *
+ * @return New entry, owned by it's root's \link Shard::derived_ \link.
+ */
+casper::inotify::API::Entry* casper::inotify::API::Derive (API::Entry* a_root, const std::string& a_uri, const int a_wd)
+{
+    // ... command, message, user, pattern, limits and stats are the root's ...
+    API::Entry* entry = new API::Entry(a_root->type_, a_uri, a_root->mask_);
+    entry->wd_             = a_wd;
+    entry->credentials_    = a_root->credentials_;
+    entry->pool_           = a_root->pool_;
+    entry->debounce_ms_    = a_root->debounce_ms_;
+    entry->max_concurrent_ = a_root->max_concurrent_;
+    entry->recursive_      = true;
+    entry->extra_mask_     = a_root->extra_mask_;
+    entry->root_           = a_root;
+    entry->backend_        = a_root->backend_;
+    entry->mark_           = a_root->mark_;
+    entry->reconcile_      = a_root->reconcile_;
+    entry->shard_          = a_root->shard_;
+    entry->sink_           = a_root->sink_;
+    entry->id_             = a_root->id_;
+    entry->plugin_         = a_root->plugin_;
+    if ( true == entry->reconcile_ ) {
+        List(*entry, entry->snapshot_);
+    }
+    // ... a stale entry for the same path?
+    std::map<std::string, API::Entry*>& derived = entry->shard_->derived_;
+    const auto it = derived.find(a_uri);
+    if ( derived.end() != it ) {
+        Forget(it->second);
+    }
+    derived[a_uri] = entry;
+    Track(entry, /* a_good */ true);
+    return entry;
+}
+
+/**
+ * @brief Stop watching a subdirectory of a recursive entry and all it's subdirectories.
+ *
+ * @param a_shard Shard the recursive entry belongs to.
+ * @param a_uri   Subdirectory URI.
+ */
+void casper::inotify::API::Prune (API::Shard& a_shard, const std::string& a_uri)
+{
+    std::vector<API::Entry*> entries;
+    const auto it = a_shard.derived_.find(a_uri);
+    if ( a_shard.derived_.end() != it ) {
+        entries.push_back(it->second);
+    }
+    const std::string prefix = a_uri + '/';
+    for ( auto child = a_shard.derived_.lower_bound(prefix) ; a_shard.derived_.end() != child && 0 == child->first.compare(0, prefix.length(), prefix) ; ++child ) {
+        entries.push_back(child->second);
+    }
+    for ( auto entry : entries ) {
+        const int wd = entry->wd_;
+        Forget(entry);
+        // ... watch is kept while configured entries share it ...
+        if ( nullptr == Lookup(a_shard, wd) ) {
+            (void)inotify_rm_watch(a_shard.fd_, wd);
+        }
+    }
+}
+
+/**
+ * @brief Follow a subdirectory of a recursive entry, and all it's subdirectories, that was moved
+ *        within it; watch descriptors are still valid, only paths change.
+ *
+ * @param a_shard Shard the recursive entry belongs to.
+ * @param a_from  Subdirectory old URI.
+ * @param a_to    Subdirectory new URI.
+ */
+void casper::inotify::API::Rebase (API::Shard& a_shard, const std::string& a_from, const std::string& a_to)
+{
+    std::vector<API::Entry*> entries;
+    const auto it = a_shard.derived_.find(a_from);
+    if ( a_shard.derived_.end() != it ) {
+        entries.push_back(it->second);
+    }
+    const std::string prefix = a_from + '/';
+    for ( auto child = a_shard.derived_.lower_bound(prefix) ; a_shard.derived_.end() != child && 0 == child->first.compare(0, prefix.length(), prefix) ; ++child ) {
+        entries.push_back(child->second);
+    }
+    for ( auto entry : entries ) {
+        API::Entry*       root = entry->root_;
+        const int         wd   = entry->wd_;
+        const std::string uri  = a_to + entry->uri_.substr(a_from.length());
+        Forget(entry);
+        (void)Derive(root, uri, wd);
+    }
+}
+
+/**
+ * @brief Untrack and release an entry created for a subdirectory of a recursive entry.
+ *
+ * @param a_entry Entry to release, it's no longer valid after this call.
+ */
+void casper::inotify::API::Forget (API::Entry* a_entry)
+{
+    API::Shard& shard = *a_entry->shard_;
+    Release(a_entry);
+    const auto it = shard.derived_.find(a_entry->uri_);
+    if ( shard.derived_.end() != it && a_entry == it->second ) {
+        shard.derived_.erase(it);
+    }
+    // ... coalesced events refer to it ...
+    for ( auto deferred = shard.deferred_.begin() ; shard.deferred_.end() != deferred ; ) {
+        if ( a_entry == deferred->first.entry_ ) {
+            deferred = shard.deferred_.erase(deferred);
+        } else {
+            ++deferred;
+        }
+    }
+    delete a_entry;
+}
+
+/**
+ * @brief Stop watching a configured entry that was removed by a reload, and release it.
+ *
+ * @param a_entry Entry to release, it's no longer valid after this call.
+ */
+void casper::inotify::API::Drop (API::Entry* a_entry)
+{
+    if ( API::Backend::_FANotifyBackend == a_entry->backend_ ) {
+        (void)Unregister(a_entry);
+    } else if ( -1 != a_entry->wd_ ) {
+        API::Shard& shard = *a_entry->shard_;
+        // ... subdirectories first ...
+        if ( true == a_entry->recursive_ ) {
+            std::vector<API::Entry*> derived;
+            for ( auto& it : shard.derived_ ) {
+                if ( a_entry == it.second->root_ ) {
+                    derived.push_back(it.second);
+                }
+            }
+            for ( auto entry : derived ) {
+                const int wd = entry->wd_;
+                Forget(entry);
+                if ( nullptr == Lookup(shard, wd) ) {
+                    (void)inotify_rm_watch(shard.fd_, wd);
+                }
+            }
+        }
+        // ... watch is kept while other entries share it, events only it requested are filtered out ...
+        const int wd = a_entry->wd_;
+        Release(a_entry);
+        if ( nullptr == Lookup(shard, wd) ) {
+            (void)inotify_rm_watch(shard.fd_, wd);
+        }
+        a_entry->wd_ = -1;
+    }
+    // ... running or pending commands still refer to it?
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( 0 != a_entry->stats_.running_ || 0 != a_entry->stats_.pending_ ) {
+        entries_.retired_.push_back(a_entry);
+    } else {
+        delete a_entry;
+    }
+}
+
+/**
+ * @brief Collect the state of an entry's objects.
+ *
+ * @param a_entry    Entry to list.
+ * @param o_snapshot Directory contents or, for files, the file itself ( named "" ).
+ */
+void casper::inotify::API::List (const API::Entry& a_entry, API::Snapshot& o_snapshot) const
+{
+    o_snapshot.clear();
+    struct stat st;
+    if ( API::Type::_File == a_entry.type_ ) {
+        if ( 0 == stat(a_entry.uri_.c_str(), &st) ) {
+            o_snapshot[""] = { static_cast<int64_t>(st.st_size), static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec, false };
+        }
+        return;
+    }
+    const int fd = open(a_entry.uri_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if ( -1 == fd ) {
+        return;
+    }
+    char buffer[API_SCAN_BUFFER_SIZE];
+    long length;
+    while ( ( length = syscall(SYS_getdents64, fd, buffer, sizeof(buffer)) ) > 0 ) {
+        for ( long offset = 0 ; offset < length ; ) {
+            const struct dirent64* entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+            if ( '.' == entry->d_name[0] && ( '\0' == entry->d_name[1] || ( '.' == entry->d_name[1] && '\0' == entry->d_name[2] ) ) ) {
+                continue;
+            }
+            if ( 0 != fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) ) {
+                continue;
+            }
+            o_snapshot[entry->d_name] = {
+                static_cast<int64_t>(st.st_size), static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec, S_ISDIR(st.st_mode)
+            };
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief Update an entry's snapshot with an event.
+ *
+ * @param a_entry Entry where event was triggered.
+ * @param a_mask  Event mask.
+ * @param a_name  Object name, when inside a watched directory, nullptr otherwise.
+ */
+void casper::inotify::API::Remember (API::Entry* a_entry, const uint32_t a_mask, const char* const a_name)
+{
+    // ... directories themselves are not part of their snapshot ...
+    if ( nullptr == a_name && API::Type::_Directory == a_entry->type_ ) {
+        return;
+    }
+    const std::string key = ( nullptr != a_name ? a_name : "" );
+    if ( a_mask & ( IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED ) ) {
+        a_entry->snapshot_.erase(key);
+        return;
+    }
+    // ... only events that might change size or modification time ...
+    if ( 0 == ( a_mask & ( IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB ) ) ) {
+        return;
+    }
+    struct stat st;
+    const std::string uri = ( nullptr != a_name ? a_entry->uri_ + '/' + a_name : a_entry->uri_ );
+    if ( 0 == fstatat(AT_FDCWD, uri.c_str(), &st, AT_SYMLINK_NOFOLLOW) ) {
+        a_entry->snapshot_[key] = {
+            static_cast<int64_t>(st.st_size), static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec, S_ISDIR(st.st_mode)
+        };
+    } else {
+        a_entry->snapshot_.erase(key);
+    }
+}
+
+/**
+ * @brief Rescan all entries of a shard that keep a snapshot, called after it's queue overflowed.
+ *
+ * @param a_shard Shard whose events were lost.
+ */
+void casper::inotify::API::Reconcile (API::Shard& a_shard)
+{
+    const auto     start      = std::chrono::steady_clock::now();
+    const uint64_t reconciled = stats_.reconciled_;
+    // ... by watch descriptor, entries might be created or released while reconciling ...
+    std::vector<int> wds;
+    for ( size_t wd = 0 ; wd < a_shard.watches_.size() ; ++wd ) {
+        if ( nullptr != a_shard.watches_[wd] ) {
+            wds.push_back(static_cast<int>(wd));
+        }
+    }
+    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " reconciling %zu watches...", wds.size());
+    for ( const int wd : wds ) {
+        const API::Group* watch = Lookup(a_shard, wd);
+        if ( nullptr == watch ) {
+            continue;
+        }
+        const std::vector<API::Entry*> entries = watch->entries_;
+        for ( auto entry : entries ) {
+            if ( true == entry->reconcile_ ) {
+                Reconcile(entry);
+            }
+        }
+    }
+    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " reconciled in %lld ms, %llu event(s) synthesized",
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()),
+        static_cast<unsigned long long>(stats_.reconciled_ - reconciled)
+    );
+}
+
+/**
+ * @brief Rescan an entry, report differences from it's snapshot as events and replace it.
+ *
+ * @param a_entry Entry to reconcile.
+ */
+void casper::inotify::API::Reconcile (API::Entry* a_entry)
+{
+    API::Snapshot current;
+    List(*a_entry, current);
+    // ... only what was requested is reported ...
+    const uint32_t requested = ( a_entry->mask_ & ~a_entry->extra_mask_ ) | IN_ISDIR;
+    const auto report = [this, a_entry, requested] (const uint32_t a_mask, const std::string& a_name) {
+        if ( 0 != ( a_mask & requested & IN_ALL_EVENTS ) ) {
+            stats_.reconciled_++;
+            Dispatch(*a_entry, a_mask & requested, API::Type::_File == a_entry->type_ ? nullptr : a_name.c_str());
+        }
+    };
+    std::vector<std::string> created;
+    std::vector<std::string> deleted;
+    for ( const auto& it : current ) {
+        const uint32_t type = ( true == it.second.directory_ ? IN_ISDIR : 0 );
+        const auto     old  = a_entry->snapshot_.find(it.first);
+        if ( a_entry->snapshot_.end() == old ) {
+            report(( API::Type::_File == a_entry->type_ ? IN_MODIFY | IN_CLOSE_WRITE : IN_CREATE ) | type, it.first);
+            if ( true == it.second.directory_ ) {
+                created.push_back(it.first);
+            }
+        } else if ( false == it.second.directory_ && ( old->second.size_ != it.second.size_ || old->second.mtime_ != it.second.mtime_ ) ) {
+            report(IN_MODIFY | IN_CLOSE_WRITE, it.first);
+        }
+    }
+    for ( const auto& it : a_entry->snapshot_ ) {
+        if ( current.end() == current.find(it.first) ) {
+            report(( API::Type::_File == a_entry->type_ ? IN_DELETE_SELF : IN_DELETE ) | ( true == it.second.directory_ ? IN_ISDIR : 0 ), it.first);
+            if ( true == it.second.directory_ ) {
+                deleted.push_back(it.first);
+            }
+        }
+    }
+    a_entry->snapshot_.swap(current);
+    // ... keep subdirectories watches in sync ...
+    if ( true == a_entry->recursive_ ) {
+        for ( const auto& name : deleted ) {
+            Prune(*a_entry->shard_, a_entry->uri_ + '/' + name);
+        }
+        for ( const auto& name : created ) {
+            Propagate(a_entry, IN_CREATE | IN_ISDIR, name.c_str());
+        }
+    }
+}
+
+/**
+ * @brief Call when an event was ignored. 
+ * 
+ * @param a_entry Entry where an event was triggered.
+ * @param a_event Event that is being ignored.
+ */
+void casper::inotify::API::Ignore (const API::Entry& a_entry, const API::Event& a_event)
+{
+    Log(API::LogLevel::_Event, "[%c%c] %s '%s' was 0x%08X.", 
+        a_event.parent_object_type_c_, a_event.object_type_c_, a_event.object_type_c_str_, a_event.object_name_c_str_, a_event.mask_);
+    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " event ignored!");
+}
+
+/**
+ * @brief Launch a process for a specific entry / event. 
+ * 
+ * @param a_entry   Entry where an event was triggered.
+ * @param a_event   Event to process.
+ * @param a_journal False when event is being replayed from the journal, so it's not journaled again.
+ */
+void casper::inotify::API::Spawn (const API::Entry& a_entry, const API::Event& a_event, const bool a_journal)
+{
+    // ... subdirectories of recursive entries share configuration, limits and stats ...
+    if ( nullptr != a_entry.root_ ) {
+        Spawn(*a_entry.root_, a_event, a_journal);
+        return;
+    }
+    const Stream::Event event = {
+        a_event.mask_, a_event.inside_a_watched_directory_, a_event.name_, a_entry.uri_.c_str(), a_event.parent_object_name_,
+        a_event.object_name_c_str_, a_event.old_object_name_, a_event.iso_8601_with_tz_
+    };
+    // ... journaled before it's dispatched, whatever the sink, so it can be dispatched again ...
+    if ( true == a_journal && true == journal_.IsOpen() ) {
+        (void)journal_.Append(event, a_entry.id_);
+    }
+    // ... handled in process, by a plugin thread ...
+    if ( API::Sink::_PluginSink == a_entry.sink_ ) {
+        const casper_inotify_event_t handled = {
+            a_event.mask_, true == a_event.inside_a_watched_directory_ ? 1 : 0, a_event.name_, a_event.object_type_c_str_,
+            a_entry.uri_.c_str(), a_event.parent_object_name_, a_event.object_name_c_str_, a_event.old_object_name_, a_event.iso_8601_with_tz_
+        };
+        if ( false == plugins_.Submit(a_entry.plugin_, handled) ) {
+            a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    // ... published to stream subscribers or ring readers, no process is involved ...
+    if ( API::Sink::_CommandSink != a_entry.sink_ ) {
+        if ( API::Sink::_RingSink == a_entry.sink_ ) {
+            ring_.Publish(event);
+        } else {
+            stream_.Publish(event);
+        }
+        return;
+    }
+    const char* const sk_dbg_symbol = "➢";
+    // ...
+    const char* vars[API::Variable::_VariablesCount];
+    vars[API::Variable::_EventVar]      = a_event.name_;
+    vars[API::Variable::_ObjectVar]     = a_event.object_type_c_str_;
+    vars[API::Variable::_NameVar]       = a_event.object_name_c_str_;
+    vars[API::Variable::_ParentNameVar] = nullptr != a_event.parent_object_name_ ? a_event.parent_object_name_ : "";
+    vars[API::Variable::_OldNameVar]    = nullptr != a_event.old_object_name_ ? a_event.old_object_name_ : "";
+    vars[API::Variable::_DateTimeVar]   = a_event.iso_8601_with_tz_;
+    vars[API::Variable::_HostNameVar]   = owner_.hostname_;
+    vars[API::Variable::_MsgVar]        = a_entry.msg_.c_str();
+    vars[API::Variable::_CmdVar]        = a_entry.cmd_.c_str();
+    // TODO: check for dependencies w/lemmon ?
+    // ... debug ...
+    if ( log_.level_ >= API::LogLevel::_Debug ) {
+        syslog(LOG_DEBUG, "%s (%s) DBG", sk_dbg_symbol, a_entry.user_.c_str());
+        // ... dump env vars ...
+        for ( size_t idx = 0 ; idx < API::Variable::_VariablesCount ; ++idx ) {
+            syslog(LOG_DEBUG, "    %s VAR %-*.*s: %s", sk_dbg_symbol, 26, 26, sk_variables_[idx], vars[idx]);
+        }
+    }    
+    // ... render message first, so that ${CASPER_INOTIFY_MSG} is expanded in command ...
+    std::string& msg = render_.msg_;
+    std::string& cmd = render_.cmd_;
+    a_entry.msg_tpl_.Render(vars, msg);
+    vars[API::Variable::_MsgVar] = msg.c_str();
+    a_entry.cmd_tpl_.Render(vars, cmd);
+    // ... debug ...
+    if ( log_.level_ >= API::LogLevel::_Debug ) {
+        syslog(LOG_DEBUG, "%s (%s) DBG", sk_dbg_symbol, a_entry.user_.c_str());
+        // ... dump message?
+        if ( a_entry.msg_.length() > 0 ) {
+            syslog(LOG_DEBUG, "    %s MSG %s", sk_dbg_symbol, msg.c_str());
+        }
+        // ... dump command ...
+        syslog(LOG_DEBUG, "    %s CMD %s", sk_dbg_symbol, cmd.c_str());
+    }
+    // ... credentials were resolved at load time ...
+    const API::Credentials& credentials = *a_entry.credentials_;
+    if ( 0 != credentials.error_.length() ) {
+        a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+        syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to launch %s", cmd.c_str());
+        syslog(LOG_ERR, "  ⌃ %s", credentials.error_.c_str());
+        return;
+    }
+    // ... environment, set only if not as root ...
+    size_t count = 0;
+    if ( 0 != credentials.uid_ ) {
+        const char* const fixed[6][2] = {
+            { "PATH"    , API_DEFAULT_PATH            },
+            { "LOGNAME" , credentials.name_.c_str()   },
+            { "USER"    , credentials.name_.c_str()   },
+            { "USERNAME", credentials.name_.c_str()   },
+            { "HOME"    , credentials.home_.c_str()   },
+            { "SHELL"   , credentials.shell_.c_str()  }
+        };
+        render_.env_.resize(6 + API::Variable::_VariablesCount);
+        for ( size_t idx = 0 ; idx < 6 ; ++idx ) {
+            render_.env_[count].assign(fixed[idx][0]).append(1, '=').append(fixed[idx][1]);
+            ++count;
+        }
+        for ( size_t idx = 0 ; idx < API::Variable::_VariablesCount ; ++idx ) {
+            render_.env_[count].assign(sk_variables_[idx]).append(1, '=').append(vars[idx]);
+            ++count;
+        }
+    }
+    render_.env_.resize(count);
+    // ... children, pools and entries stats are shared by all shards ...
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // ... delegate to a persistent worker, unless none is running ...
+        if ( nullptr != a_entry.pool_ && true == Submit(*a_entry.pool_, a_entry, cmd, render_.env_) ) {
+            return;
+        }
+        // ... as a process, unless it was queued or dropped ...
+        if ( false == Admit(a_entry, cmd, render_.env_) ) {
+            return;
+        }
+    }
+    // ... launch, without the lock: other shards, workers and reaping must not wait for vfork(2) / execve(2) ...
+    (void)Execute(a_entry, cmd, render_.env_);
+}
+
+/**
+ * @brief Reserve a process for a rendered command, or queue it while over limits; must be called with \link mutex_ \link held.
+ *
+ * @param a_entry Entry where an event was triggered.
+ * @param a_cmd   Rendered command.
+ * @param a_env   Environment strings, KEY=VALUE.
+ *
+ * @return True if it was reserved, caller must then \link Execute \link it after releasing \link mutex_ \link.
+ */
+bool casper::inotify::API::Admit (const API::Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env)
+{
+    // ... over limits?
+    if ( false == CanLaunch(a_entry) ) {
+        if ( children_.pending_.size() >= limits_.max_pending_ ) {
+            // ... drop it ...
+            a_entry.stats_.dropped_++;
+            children_.dropped_++;
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " %s, CMD dropped, %zu pending command(s)!",
+                a_entry.uri_.c_str(), children_.pending_.size());
+            return false;
+        }
+        // ... queue it ...
+        children_.pending_.push_back({ &a_entry, a_cmd, a_env });
+        a_entry.stats_.pending_++;
+        DEBUG_LOG(DEBUG_LEVEL_BASIC, "%s, CMD queued, %zu pending command(s)", a_entry.uri_.c_str(), children_.pending_.size());
+        return false;
+    }
+    // ... reserve, it counts towards limits while it's being launched ...
+    a_entry.stats_.running_++;
+    children_.launching_++;
+    return true;
+}
+
+/**
+ * @brief Launch a rendered command reserved by \link Admit \link and supervise it's process; must be called
+ *        without \link mutex_ \link held.
+ *
+ * @param a_entry Entry where an event was triggered.
+ * @param a_cmd   Rendered command.
+ * @param a_env   Environment strings, KEY=VALUE.
+ *
+ * @return True if the process was launched.
+ */
+bool casper::inotify::API::Execute (const API::Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env)
+{
+    render_.envp_.resize(a_env.size() + 1);
+    for ( size_t idx = 0 ; idx < a_env.size() ; ++idx ) {
+        render_.envp_[idx] = const_cast<char*>(a_env[idx].c_str());
+    }
+    render_.envp_[a_env.size()] = nullptr;
+    // ... launch ...
+    const char* what  = nullptr;
+    int         no    = 0;
+    const auto  start = std::chrono::steady_clock::now();
+    const pid_t pid   = Launch(*a_entry.credentials_, a_cmd, render_.envp_.data(), what, no);
+    // ... log ...
+    if ( pid < 0 ) {
+        syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to launch %s", a_cmd.c_str());
+        syslog(LOG_ERR, "  ⌃ %s - ( %d ) %s", what, no, strerror(no));
+    } else {
+        syslog(LOG_NOTICE, LOGGER_PASS_SYMBOL " (%s) CMD %s", a_entry.user_.c_str(), a_cmd.c_str());
+    }
+    // ... supervise ...
+    bool freed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        children_.launching_--;
+        if ( pid < 0 ) {
+            a_entry.stats_.running_--;
+            a_entry.stats_.failed_++;
+            a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+            freed = true;
+        } else {
+            a_entry.stats_.launched_++;
+            // ... reaped before we got here?
+            const auto it = children_.reaped_.find(pid);
+            if ( children_.reaped_.end() != it ) {
+                Exited(a_entry, pid, it->second, start);
+                children_.reaped_.erase(it);
+                freed = true;
+            } else {
+                children_.running_[pid] = { &a_entry, start };
+            }
+        }
+        // ... reaping did not launch pending commands for the slot that was reserved ...
+        freed = ( true == freed && false == children_.pending_.empty() );
+    }
+    if ( true == freed ) {
+        Reap();
+    }
+    // ... done ...
+    return ( pid >= 0 );
+}
+
+/**
+ * @brief Check if concurrency limits allow a new process for an entry.
+ *
+ * @param a_entry Entry where an event was triggered.
+ */
+bool casper::inotify::API::CanLaunch (const API::Entry& a_entry) const
+{
+    if ( 0 != limits_.max_concurrent_ && children_.running_.size() + children_.launching_ >= limits_.max_concurrent_ ) {
+        return false;
+    }
+    return ( 0 == a_entry.max_concurrent_ || a_entry.stats_.running_ < a_entry.max_concurrent_ );
+}
+
+/**
+ * @brief Reap all terminated children, record their status and launch pending commands.
+ */
+void casper::inotify::API::Reap ()
+{
+    std::vector<API::Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int   status;
+        pid_t pid;
+        while ( ( pid = waitpid(-1, &status, WNOHANG) ) > 0 ) {
+            const auto it = children_.running_.find(pid);
+            if ( children_.running_.end() != it ) {
+                const API::Child child = it->second;
+                children_.running_.erase(it);
+                Exited(*child.entry_, pid, status, child.start_);
+            } else if ( 0 == children_.untracked_.erase(pid) && 0 != children_.launching_ ) {
+                // ... launched but not yet recorded, Execute will ...
+                children_.reaped_[pid] = status;
+            }
+        }
+        // ... reserve pending, in order, skipping those whose entry is still at it's limit ...
+        for ( auto it = children_.pending_.begin() ; children_.pending_.end() != it ; ) {
+            if ( 0 != limits_.max_concurrent_ && children_.running_.size() + children_.launching_ >= limits_.max_concurrent_ ) {
+                break;
+            }
+            if ( false == CanLaunch(*it->entry_) ) {
+                ++it;
+                continue;
+            }
+            it->entry_->stats_.pending_--;
+            it->entry_->stats_.running_++;
+            children_.launching_++;
+            ready.push_back(std::move(*it));
+            it = children_.pending_.erase(it);
+        }
+    }
+    // ... launch them without the lock ...
+    for ( const auto& job : ready ) {
+        (void)Execute(*job.entry_, job.cmd_, job.env_);
+    }
+}
+
+/**
+ * @brief Record how a supervised process ended; must be called with \link mutex_ \link held.
+ *
+ * @param a_entry  Entry it was launched for.
+ * @param a_pid    Process id.
+ * @param a_status waitpid(2) status.
+ * @param a_start  When it was launched.
+ */
+void casper::inotify::API::Exited (const API::Entry& a_entry, const pid_t a_pid, const int a_status, const std::chrono::steady_clock::time_point& a_start)
+{
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - a_start).count();
+    const auto elapsed    = elapsed_us / 1000;
+    metrics_.durations_.Record(static_cast<uint64_t>(elapsed_us));
+    // ... record ...
+    a_entry.stats_.running_--;
+    a_entry.stats_.last_status_      = a_status;
+    a_entry.stats_.last_duration_ms_ = static_cast<uint64_t>(elapsed);
+    // ... log ...
+    if ( WIFEXITED(a_status) && 0 == WEXITSTATUS(a_status) ) {
+        Log(API::LogLevel::_Event, "⌁ %d, %s, exited with status 0 after %lld ms", (int)a_pid, a_entry.uri_.c_str(), (long long)elapsed);
+    } else {
+        a_entry.stats_.failed_++;
+        if ( WIFSIGNALED(a_status) ) {
+            Log(API::LogLevel::_Warning, "⌁ %d, %s, killed by signal %d after %lld ms", (int)a_pid, a_entry.uri_.c_str(), WTERMSIG(a_status), (long long)elapsed);
+        } else {
+            Log(API::LogLevel::_Warning, "⌁ %d, %s, exited with status %d after %lld ms", (int)a_pid, a_entry.uri_.c_str(), WEXITSTATUS(a_status), (long long)elapsed);
+        }
+    }
+}
+
+/**
+ * @brief Launch a shell command using vfork(2).
+ *
+ * Parent's memory is shared, not copied, until the child calls execve(2), so cost does not grow with
+ * this process RSS. The child only performs raw system calls: glibc's set*id wrappers must not be used
+ * here since they synchronize credentials with all threads of the ( shared ) process.
+ *
+ * @param a_credentials Pre-resolved credentials to run the command with.
+ * @param a_cmd         Command to pass to \link API_DEFAULT_SHELL \link.
+ * @param a_envp        Environment, nullptr terminated.
+ * @param o_what        Set to the failed step, on error.
+ * @param o_no          Set to errno, on error.
+ *
+ * @return Child process id, -1 on error.
+ */
+pid_t casper::inotify::API::Launch (const API::Credentials& a_credentials, const std::string& a_cmd, char* const* a_envp,
+                                    const char*& o_what, int& o_no)
+{
+    char* const argv[4] = {
+        const_cast<char*>(API_DEFAULT_SHELL), const_cast<char*>("-c"), const_cast<char*>(a_cmd.c_str()), nullptr
+    };
+    // ... written by child, memory is shared with vfork ...
+    volatile int         error_no   = 0;
+    const char* volatile error_what = nullptr;
+    // ...
+    const pid_t pid = vfork();
+    if ( 0 > pid )  { // ... unable to fork ...
+        o_what = "vfork failure";
+        o_no   = errno;
+        return -1;
+    } else if ( 0 == pid ) {  // ... child ...
+        // ... close ALL open files, but skip 0 - stdin, 1 - stdout, 2 - stderr ...
+#ifdef SYS_close_range
+        (void)syscall(SYS_close_range, 3U, ~0U, 0U);
+#endif
+        // ... otherwise ( or on ENOSYS ) rely on O_CLOEXEC, set on all fds this process opens ...
+        // ... create session and set process group ID ...
+        setsid();
+        // ... signals blocked by parent are inherited, unblock them ...
+        sigprocmask(SIG_UNBLOCK, &reactor_.signals_, nullptr);
+        // ... so is CPU affinity, when launched by a pinned shard ...
+        (void)syscall(SYS_sched_setaffinity, 0, sizeof(reactor_.affinity_), &reactor_.affinity_);
+        // ... drop privileges ...
+        if ( 0 != syscall(SYS_setgid, a_credentials.gid_) ) {
+            error_what = "set effective group ID";
+        } else if ( 0 != syscall(SYS_setgroups, a_credentials.groups_.size(), a_credentials.groups_.data()) ) {
+            error_what = "initialize the group access list";
+        } else if ( 0 != syscall(SYS_setuid, a_credentials.uid_) ) {
+            error_what = "set the effective user ID";
+        } else {
+            (void)execve(API_DEFAULT_SHELL, argv, a_envp);
+            error_what = "execve";
+        }
+        error_no = errno;
+        _exit(127);
+    }
+    // ... parent, child already exec'ed or exited ...
+    if ( nullptr != error_what ) {
+        o_what = error_what;
+        o_no   = error_no;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Resolve, once, a user's credentials.
+ *
+ * @param a_user User name.
+ *
+ * @return Resolved credentials, on failure \link API::Credentials::error_ \link is set.
  */
-void casper::inotify::API::Log (const API::LogLevel a_level,
-                                const API::Event& a_event, const API::Entry& a_entry,
-                                const std::vector<std::string>& a_actions)
+const casper::inotify::API::Credentials* casper::inotify::API::Resolve (const std::string& a_user)
 {
-    // ... no log?
-    if ( nullptr == log_.fp_ || a_level > log_.level_ ) {
-        // ... nothing to do here ...
-        return;
+    const auto it = credentials_.find(a_user);
+    if ( credentials_.end() != it ) {
+        return &it->second;
     }
-    // ... basic ...
-    const std::string pattern = 0 != a_entry.pattern_.length() ? ", " + a_entry.pattern_ : "";
-    Log(a_level, "➢ %u, %s%s", a_entry.wd_, a_entry.uri_.c_str(), pattern.c_str());
-    Log(a_level, "➢ 0x%08X", a_event.mask_);
-    // ... extended ...
-    if ( a_level >= API::LogLevel::_Debug ) {
-        Log(API::LogLevel::_Debug, "➢ %c, 0x%08X, %s @ %s", a_event.object_type_c_, a_entry.mask_, a_event.object_name_c_str_, a_event.parent_object_name_);
-        for ( auto action : a_actions ) {
-            Log(API::LogLevel::_Debug, "    ➢ %s", action.c_str());
-        }
+    API::Credentials& credentials = credentials_[a_user];
+    credentials.uid_ = std::numeric_limits<uid_t>::max();
+    credentials.gid_ = std::numeric_limits<gid_t>::max();
+    // ...
+    errno = 0;
+    struct passwd* pwd = getpwnam(a_user.c_str());
+    if ( nullptr == pwd ) {
+        credentials.error_ = "get user info '" + a_user + "' - ( " + std::to_string(errno) + " ) " + strerror(errno);
+        return &credentials;
     }
-    // ... basic ...
-    Log(a_level, " ⇥ (%s) CMD %s", a_entry.user_.c_str(), a_entry.cmd_.c_str());
+    credentials.uid_   = pwd->pw_uid;
+    credentials.gid_   = pwd->pw_gid;
+    credentials.name_  = pwd->pw_name;
+    credentials.home_  = pwd->pw_dir;
+    credentials.shell_ = pwd->pw_shell;
+    // ... supplementary groups, as initgroups(3) would set them ...
+    int count = 32;
+    credentials.groups_.resize(static_cast<size_t>(count));
+    while ( -1 == getgrouplist(credentials.name_.c_str(), credentials.gid_, credentials.groups_.data(), &count) ) {
+        credentials.groups_.resize(static_cast<size_t>(count));
+    }
+    credentials.groups_.resize(static_cast<size_t>(count));
+    // ... done ...
+    return &credentials;
 }
 
 /**
- * @brief Write a log entry.
+ * @brief Start, or restart, a persistent command worker.
  *
- * @param a_level  One of \link API::LogLevel \link.
- * @param a_format fprintf like format.
- * @param ...
+ * @param a_pool Pool the worker belongs to.
+ * @param a_idx  Worker index.
  */
-void casper::inotify::API::Log (const API::LogLevel a_level, const char* const a_format, ...)
+void casper::inotify::API::Fork (API::Pool& a_pool, const size_t a_idx)
 {
-    // ... no log?
-    if ( nullptr == log_.fp_ || a_level > log_.level_ ) {
-        // ... nothing to do here ...
-        return;
+    API::Worker& worker = a_pool.workers_[a_idx];
+    // ... other threads might hold locks when we fork, so the child only makes async-signal-safe calls
+    //     until it execs this same binary as a worker; all it needs is prepared here ...
+    const API::Credentials& credentials = *a_pool.credentials_;
+    const std::string       failure     = LOGGER_FAIL_SYMBOL " unable to start worker for '" + credentials.name_ + "'\n";
+    const long              max_fd      = sysconf(_SC_OPEN_MAX);
+    char* const             argv[3]     = { const_cast<char*>(CASPER_INOTIFY_NAME), const_cast<char*>(API_WORKER_ARGUMENT), nullptr };
+    char* const             envp[1]     = { nullptr };
+    int fds[2];
+    if ( 0 != socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) ) {
+        throw inotify::Exception("An error occurred while creating worker socket: %d - %s", errno, strerror(errno));
     }
-    // .... log ....
-    std::va_list args;
-    try {
-        const char* what;
-        const char* color = LOGGER_RESET_ATTRS;
-        switch(a_level) {
-            case API::LogLevel::_Info:
-                what = "Info";
-                break;
-            case API::LogLevel::_Warning:
-                what = "Warning";
-                color = LOGGER_COLOR(YELLOW);
-                break;
-            case API::LogLevel::_Error:
-                what = "Error";
-                color = LOGGER_COLOR(RED);
-                break;
-            case API::LogLevel::_Event:
-                what = "Event";
-                break;
-            case API::LogLevel::_Debug:
-                what = "Debug";
-                color = LOGGER_COLOR(DARK_GRAY);
-                break;
-            default:
-                what = "???";
-                color = LOGGER_COLOR(RED);
-                break;
+    const pid_t pid = fork();
+    if ( pid < 0 ) {
+        close(fds[0]);
+        close(fds[1]);
+        throw inotify::Exception("An error occurred while forking worker: %d - %s", errno, strerror(errno));
+    } else if ( 0 == pid ) {
+        // ... child, keep only stdio and it's socket ( as fd 3, dup2 clears close-on-exec unless it's already there ) ...
+        if ( 3 != dup2(fds[1], 3) || ( 3 == fds[1] && 0 != fcntl(3, F_SETFD, 0) ) ) {
+            (void)write(STDERR_FILENO, failure.data(), failure.length());
+            _exit(127);
         }
-        fprintf(log_.fp_, "%s, %8d, %-10.10s, ", Now(log_.time_), pid_, what);
-        {
-            auto temp   = std::vector<char> {};
-            auto length = std::size_t { 512 };
-            while ( temp.size() <= length ) {
-                temp.resize(length + 1);
-                va_start(args, a_format);
-                const auto status = std::vsnprintf(temp.data(), temp.size(), a_format, args);
-                va_end(args);
-                if ( status < 0 ) {
-                    throw std::runtime_error {"string formatting error"};
-                }
-                length = static_cast<std::size_t>(status);
+        // ... without close_range(2), close them one by one; the worker must see EOF when we're gone ...
+        long rv = -1;
+#ifdef SYS_close_range
+        rv = syscall(SYS_close_range, 4U, ~0U, 0U);
+#endif
+        if ( 0 != rv ) {
+            for ( long fd = 4 ; fd < max_fd ; ++fd ) {
+                (void)close(static_cast<int>(fd));
             }
-            fprintf(log_.fp_, "%s%s" LOGGER_RESET_ATTRS, color, length > 0 ? std::string { temp.data(), length }.c_str() : "");
         }
-        fprintf(log_.fp_, "\n");
-        fflush(log_.fp_);
-    } catch (std::exception& a_exception) {
-        va_end(args);
-        throw a_exception;
+        // ... set up as a process launcher would ...
+        setsid();
+        sigprocmask(SIG_UNBLOCK, &reactor_.signals_, nullptr);
+        if ( 0 == credentials.error_.length()
+            && 0 == setgid(credentials.gid_)
+            && 0 == setgroups(credentials.groups_.size(), credentials.groups_.data())
+            && 0 == setuid(credentials.uid_) ) {
+            (void)execve("/proc/self/exe", argv, envp);
+        }
+        (void)write(STDERR_FILENO, failure.data(), failure.length());
+        _exit(127);
+    }
+    // ... parent ...
+    close(fds[1]);
+    worker.fd_     = fds[0];
+    worker.pid_    = pid;
+    worker.entry_  = nullptr;
+    worker.forked_ = std::chrono::steady_clock::now();
+    workers_[worker.fd_] = std::make_pair(&a_pool, a_idx);
+    children_.untracked_.insert(pid);
+    try {
+        Attach(worker.fd_);
+    } catch (...) {
+        // ... it exits when it sees EOF ...
+        workers_.erase(worker.fd_);
+        close(worker.fd_);
+        worker.fd_  = -1;
+        worker.pid_ = -1;
+        throw;
     }
+    // ... log ...
+    Log(API::LogLevel::_Info, "Worker #%zu for '%s' started, pid %d", a_idx, a_pool.credentials_->name_.c_str(), (int)pid);
 }
 
 /**
- * @brief Dump fields info.
+ * @brief Start a worker that is not running, on failure it's restart is scheduled; must be called with \link mutex_ \link held.
  *
- * @param a_level  One of \link API::LogLevel \link.
- * @param a_fields Fields info do dump.
+ * @param a_pool Pool the worker belongs to.
+ * @param a_idx  Worker index.
+ *
+ * @return True if the worker was started.
  */
-void casper::inotify::API::Log (const API::LogLevel a_level, const std::map<uint32_t, const FieldInfo>& a_fields)
+bool casper::inotify::API::Restart (API::Pool& a_pool, const size_t a_idx)
 {
-     // ... no log?
-    if ( nullptr == log_.fp_ || a_level > log_.level_ ) {
-        // ... nothing to do here ...
-        return;
-    }
-    // .... log ....
-    const auto spacer = [this]() {
-        for ( size_t idx = 0 ; idx < 140 ; ++idx ) {
-            fprintf(log_.fp_, "%c", '-');
-        }
-        fprintf(log_.fp_, "\n");
-    };        
-    spacer();
-    for ( const auto& it : a_fields ) {
-        fprintf(log_.fp_, "\t0x%08X - %-16.16s - %-13.13s - %s\n", it.first, it.second.name_, it.second.key_, it.second.description_);
+    try {
+        Fork(a_pool, a_idx);
+        return true;
+    } catch (const inotify::Exception& a_e) {
+        Log(API::LogLevel::_Error, LOGGER_FAIL_SYMBOL " %s", a_e.what());
+    } catch (const std::exception& a_e) {
+        Log(API::LogLevel::_Error, LOGGER_FAIL_SYMBOL " %s", a_e.what());
     }
-    spacer();
-    fflush(stdout);
+    a_pool.workers_[a_idx].failures_++;
+    Backoff(a_pool, a_idx);
+    return false;
 }
 
-// MARK: -
-
 /**
- * @brief Add a new entry.
- * 
- * @param a_type    One of \link API::Type \link.
- * @param a_object  JSON object that defines this new entry.
- * @param a_uri     URI for file or directory.
- * @param a_mask    Event mask.
- * @param a_handler Management / special handler.
+ * @brief Schedule a worker restart, API_POOL_RESTART_MIN_MS after it's first failure doubling up to API_POOL_RESTART_MAX_MS;
+ *        must be called with \link mutex_ \link held.
+ *
+ * @param a_pool Pool the worker belongs to.
+ * @param a_idx  Worker index.
  */
-void casper::inotify::API::Add (const API::Type a_type, const Json::Value& a_object,
-                                const std::string& a_uri, uint32_t a_mask,
-                                std::function<bool(const struct _Entry&, const Event&)> a_handler)
+void casper::inotify::API::Backoff (API::Pool& a_pool, const size_t a_idx)
 {
-    static const Json::Value dummy_string = Json::Value("");
-    // ... set ...
-    switch (a_type) {
-        case API::Type::_Directory:
-            if ( nullptr == a_handler ) {
-                entries_.uris_.directories_.insert(a_uri);
-            }            
-        break;
-        case API::Type::_File:
-            if ( nullptr == a_handler ) {
-                entries_.uris_.files_.insert(a_uri);
-            }           
-        break; 
-        default:
-            throw inotify::Exception("Unknown entry type: %u!", (unsigned)a_type);
-        break;
+    API::Worker& worker = a_pool.workers_[a_idx];
+    uint64_t     delay  = API_POOL_RESTART_MIN_MS;
+    for ( size_t n = 1 ; n < worker.failures_ && delay < API_POOL_RESTART_MAX_MS ; ++n ) {
+        delay *= 2;
     }
-    // ... collect ...
-    entries_.all_.push_back(new API::Entry{
-        /* type_    */ a_type,
-        /* uri_     */ a_uri,
-        /* mask_    */ a_mask,
-        /* wd_      */ -1,
-        /* user_    */ a_object.get("user", defaults_.user_).asString(),
-        /* cmd_     */ a_object.get("command", defaults_.command_).asString(),
-        /* msg_     */ a_object.get("message", defaults_.message_).asString(),
-        /* pattern_ */ a_object.get("pattern", dummy_string).asString(),
-        /* error_   */ "",
-        /* warning_ */ "",
-        /* handler_ */ a_handler
-    });
+    delay = std::min<uint64_t>(delay, API_POOL_RESTART_MAX_MS);
+    if ( std::chrono::steady_clock::time_point() == worker.restart_ ) {
+        restarts_++;
+    }
+    worker.restart_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+    // ... shard #0 timer checks it ...
+    Arm(*shards_[0]);
+    // ... log ...
+    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " Worker #%zu for '%s' will be restarted in %llu ms, %zu failure(s)",
+        a_idx, a_pool.credentials_->name_.c_str(), static_cast<unsigned long long>(delay), worker.failures_);
 }
 
-// MARK: -
-
 /**
- * @brief Call when an entry must be tracked. 
- * 
- * @param a_entry Entry to track.
- * @param a_good  True when it's a good entry.
- * @param a_log   True when a log entry should be created.
+ * @brief Called by shard #0 timer, on main loop, to restart workers whose delay expired.
  */
-
-void casper::inotify::API::Track (API::Entry* a_entry, const bool a_good, const bool a_log)
+void casper::inotify::API::Revive ()
 {
-    if ( true == a_good ) {
-        // ... as 'good' entry ...
-        entries_.good_[a_entry->wd_] = a_entry;
-        // ... log?
-        if ( true == a_log ) {
-            Log(LOGGER_PASS_SYMBOL, *a_entry);
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto now   = std::chrono::steady_clock::now();
+    bool       moved = false;
+    for ( auto& it : pools_ ) {
+        bool started = false;
+        for ( size_t idx = 0 ; idx < it.second.workers_.size() ; ++idx ) {
+            API::Worker& worker = it.second.workers_[idx];
+            if ( std::chrono::steady_clock::time_point() == worker.restart_ || worker.restart_ > now ) {
+                continue;
+            }
+            worker.restart_ = std::chrono::steady_clock::time_point();
+            restarts_--;
+            if ( false == quit_ && true == Restart(it.second, idx) ) {
+                started = true;
+            }
         }
-    } else {
-        // ... as 'bad' entry ...
-        entries_.bad_.push_back(a_entry);
-        // ... log?
-        if ( true == a_log ) {
-            Log(LOGGER_FAIL_SYMBOL, *a_entry);
+        // ... commands queued while all were busy ...
+        if ( true == started && true == Drain(it.second) ) {
+            moved = true;
         }
     }
+    // ... launch those that are now for processes ...
+    if ( true == moved ) {
+        lock.unlock();
+        Reap();
+    }
 }
 
-
 /**
- * @brief Call when an entry must be untracked. 
- * 
- * @param a_entry  Entry to untrack.
- * @param a_reason Reason for this call.
- * @param a_log    True when a log entry should be created.
+ * @brief Persistent command worker loop, never returns; runs in a process of it's own, exec'ed with
+ *        \link API_WORKER_ARGUMENT \link by \link API::Fork \link.
+ *
+ * Each message is the command followed by it's KEY=VALUE environment, '\0' separated;
+ * each reply is the waitpid(2) status of the launched shell.
+ *
+ * @param a_fd Socket connected to this daemon.
  */
-void casper::inotify::API::Untrack (API::Entry* a_entry, const char* const a_reason, const bool a_log)
+void casper::inotify::API::Serve (const int a_fd)
 {
-    // ... untrack ...
-    entries_.good_.erase(entries_.good_.find(a_entry->wd_));
-    entries_.bad_.push_back(a_entry);
-    a_entry->wd_      = -1;
-    a_entry->warning_ = ( nullptr != a_reason ? a_reason : "" );
-    // ... log?
-    if ( true == a_log ) {
-        Log(LOGGER_FAIL_SYMBOL, *a_entry);
+    std::vector<char>  buffer(API_POOL_MESSAGE_MAX_SIZE);
+    std::vector<char*> envp;
+    while ( true ) {
+        const ssize_t length = recv(a_fd, buffer.data(), buffer.size() - 1, 0);
+        if ( length <= 0 ) {
+            if ( length < 0 && EINTR == errno ) {
+                continue;
+            }
+            // ... daemon is gone ...
+            _exit(0);
+        }
+        buffer[static_cast<size_t>(length)] = '\0';
+        // ... split ...
+        char* const cmd = buffer.data();
+        envp.clear();
+        for ( char* it = cmd + strlen(cmd) + 1 ; it < buffer.data() + length ; it += strlen(it) + 1 ) {
+            envp.push_back(it);
+        }
+        envp.push_back(nullptr);
+        char* const argv[4] = { const_cast<char*>(API_DEFAULT_SHELL), const_cast<char*>("-c"), cmd, nullptr };
+        // ... launch and wait ...
+        int status = -1;
+        const pid_t pid = vfork();
+        if ( 0 == pid ) {
+            (void)execve(API_DEFAULT_SHELL, argv, envp.data());
+            _exit(127);
+        } else if ( pid > 0 ) {
+            while ( -1 == waitpid(pid, &status, 0) && EINTR == errno ) {
+                /* retry */
+            }
+        }
+        // ... report ...
+        if ( sizeof(status) != send(a_fd, &status, sizeof(status), MSG_NOSIGNAL) ) {
+            _exit(0);
+        }
     }
 }
 
 /**
- * @brief Call when an event was ignored. 
- * 
+ * @brief Hand over a rendered command to an idle worker, or queue it while all are busy.
+ *
+ * @param a_pool  Pool to use.
  * @param a_entry Entry where an event was triggered.
- * @param a_event Event that is being ignored.
+ * @param a_cmd   Rendered command.
+ * @param a_env   Environment strings, KEY=VALUE.
+ *
+ * @return False if no worker is running, it's counted as a spawn failure and it's up to the caller to launch it.
  */
-void casper::inotify::API::Ignore (const API::Entry& a_entry, const API::Event& a_event)
+bool casper::inotify::API::Submit (API::Pool& a_pool, const API::Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env)
 {
-    Log(API::LogLevel::_Event, "[%c%c] %s '%s' was 0x%08X.", 
-        a_event.parent_object_type_c_, a_event.object_type_c_, a_event.object_type_c_str_, a_event.object_name_c_str_, a_event.mask_);
-    Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " event ignored!");
+    bool running = false;
+    for ( auto& worker : a_pool.workers_ ) {
+        if ( -1 == worker.fd_ ) {
+            continue;
+        }
+        running = true;
+        if ( nullptr != worker.entry_ ) {
+            continue;
+        }
+        // ... serialize ...
+        std::string& message = render_.message_;
+        message.assign(a_cmd).append(1, '\0');
+        for ( const auto& var : a_env ) {
+            message.append(var).append(1, '\0');
+        }
+        if ( message.length() >= API_POOL_MESSAGE_MAX_SIZE ) {
+            a_entry.stats_.failed_++;
+            a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+            syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to submit %s", a_cmd.c_str());
+            syslog(LOG_ERR, "  ⌃ message too long ( %zu bytes )", message.length());
+            return true;
+        }
+        if ( static_cast<ssize_t>(message.length()) != send(worker.fd_, message.data(), message.length(), MSG_NOSIGNAL) ) {
+            a_entry.stats_.failed_++;
+            a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+            syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to submit %s", a_cmd.c_str());
+            syslog(LOG_ERR, "  ⌃ send - ( %d ) %s", errno, strerror(errno));
+            return true;
+        }
+        worker.entry_ = &a_entry;
+        worker.start_ = std::chrono::steady_clock::now();
+        a_entry.stats_.running_++;
+        a_entry.stats_.launched_++;
+        // ... log ...
+        syslog(LOG_NOTICE, LOGGER_PASS_SYMBOL " (%s) CMD %s", a_entry.user_.c_str(), a_cmd.c_str());
+        return true;
+    }
+    // ... none running, never queue for workers that might not come back ...
+    if ( false == running ) {
+        a_entry.counters_.spawn_failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // ... all busy ...
+    if ( a_pool.pending_.size() >= limits_.max_pending_ ) {
+        a_entry.stats_.dropped_++;
+        children_.dropped_++;
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " %s, CMD dropped, %zu pending command(s)!",
+            a_entry.uri_.c_str(), a_pool.pending_.size());
+        return true;
+    }
+    a_pool.pending_.push_back({ &a_entry, a_cmd, a_env });
+    a_entry.stats_.pending_++;
+    return true;
 }
 
 /**
- * @brief Launch a process for a specific entry / event. 
- * 
- * @param a_entry Entry where an event was triggered.
- * @param a_event Event to process.
+ * @brief Hand over queued commands to idle workers, or to processes queue if no worker is running;
+ *        must be called with \link mutex_ \link held.
+ *
+ * @param a_pool Pool to drain.
+ *
+ * @return True if commands were moved to processes queue, caller must then \link Reap \link after releasing \link mutex_ \link.
  */
-void casper::inotify::API::Spawn (const API::Entry& a_entry, const API::Event& a_event)
+bool casper::inotify::API::Drain (API::Pool& a_pool)
 {
-    const char* const sk_dbg_symbol = "➢";
-    // ...
-    std::map<const char* const, std::string> vars = {
-        { "CASPER_INOTIFY_EVENT"      , a_event.name_               },
-        { "CASPER_INOTIFY_OBJECT"     , a_event.object_type_c_str_  },
-        { "CASPER_INOTIFY_NAME"       , a_event.object_name_c_str_  },
-        { "CASPER_INOTIFY_PARENT_NAME", nullptr != a_event.parent_object_name_ ? a_event.parent_object_name_ : "" },
-        { "CASPER_INOTIFY_DATETIME"   , a_event.iso_8601_with_tz_   },
-        { "CASPER_INOTIFY_HOSTNAME"   , owner_.hostname_            },
-        { "CASPER_INOTIFY_MSG"        , a_entry.msg_                },
-        { "CASPER_INOTIFY_CMD"        , a_entry.cmd_                }
-    };
-    // TODO: check for dependencies w/lemmon ?
-    // ... debug ...
-    if ( log_.level_ >= API::LogLevel::_Debug ) {
-        syslog(LOG_DEBUG, "%s (%s) DBG", sk_dbg_symbol, a_entry.user_.c_str());
-        // ... dump env vars ...
-        for ( auto it : vars ) {
-            syslog(LOG_DEBUG, "    %s VAR %-*.*s: %s", sk_dbg_symbol, 23, 23, it.first, it.second.c_str());
+    bool moved = false;
+    while ( false == a_pool.pending_.empty() ) {
+        // ... all running workers busy?
+        bool running = false;
+        bool idle    = false;
+        for ( const auto& worker : a_pool.workers_ ) {
+            if ( -1 != worker.fd_ ) {
+                running = true;
+                idle    = ( true == idle || nullptr == worker.entry_ );
+            }
         }
-    }    
-    // ...
-    std::string cmd, msg;
-    const std::map<const std::string*, std::string*> strings = { { &a_entry.cmd_, &cmd}, { &a_entry.msg_, &msg} };
-    for ( auto it : strings ) {
-        (*it.second) = *it.first;
-        for ( auto it2 : vars ) {
-            (*it.second) = Replace((*it.second) , ( "${" + std::string(it2.first) + "}" ) , it2.second);
+        if ( true == running && false == idle ) {
+            break;
         }
-    }
-    // ... debug ...
-    if ( log_.level_ >= API::LogLevel::_Debug ) {
-        syslog(LOG_DEBUG, "%s (%s) DBG", sk_dbg_symbol, a_entry.user_.c_str());
-        // ... dump message?
-        if ( a_entry.msg_.length() > 0 ) {
-            syslog(LOG_DEBUG, "    %s MSG %s", sk_dbg_symbol, msg.c_str());
+        API::Job job = std::move(a_pool.pending_.front());
+        a_pool.pending_.pop_front();
+        job.entry_->stats_.pending_--;
+        if ( false == Submit(a_pool, *job.entry_, job.cmd_, job.env_) ) {
+            job.entry_->stats_.pending_++;
+            children_.pending_.push_back(std::move(job));
+            moved = true;
         }
-        // ... dump command ...
-        syslog(LOG_DEBUG, "    %s CMD %s", sk_dbg_symbol, cmd.c_str());
     }
-    // ...
-    const pid_t pid = fork();
-    if ( 0 > pid )  { // ... unable to fork ...
-        // ... log ...
-        syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to launch %s", cmd.c_str());
-        syslog(LOG_ERR, "  ⌃ fork failure!");
-        // ... done ...
+    return moved;
+}
+
+/**
+ * @brief Called when a worker socket is readable: command finished or worker is gone.
+ *
+ * @param a_fd Worker socket.
+ */
+void casper::inotify::API::OnWorker (const int a_fd)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto it = workers_.find(a_fd);
+    if ( workers_.end() == it ) {
         return;
-    } else if ( 0 == pid ) {  // ... child ...
-        // ... close ALL open files ...
-        const int max = getdtablesize();
-        // ... but skip 0 - stdin, 1 - stdout, 2 - stderr ....
-        for ( int n = 3; n < max; n++ ) {
-            close(n);
+    }
+    API::Pool&   pool   = *it->second.first;
+    const size_t idx    = it->second.second;
+    API::Worker& worker = pool.workers_[idx];
+    int          status = -1;
+    const ssize_t length = recv(a_fd, &status, sizeof(status), MSG_DONTWAIT);
+    if ( length < 0 && ( EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno ) ) {
+        return;
+    }
+    // ... a command finished ( or was lost ) ...
+    if ( nullptr != worker.entry_ ) {
+        const API::Entry& entry = *worker.entry_;
+        const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - worker.start_).count();
+        const auto elapsed    = elapsed_us / 1000;
+        metrics_.durations_.Record(static_cast<uint64_t>(elapsed_us));
+        entry.stats_.running_--;
+        entry.stats_.last_status_      = status;
+        entry.stats_.last_duration_ms_ = static_cast<uint64_t>(elapsed);
+        if ( sizeof(status) == length && WIFEXITED(status) && 0 == WEXITSTATUS(status) ) {
+            Log(API::LogLevel::_Event, "⌁ #%zu, %s, exited with status 0 after %lld ms", idx, entry.uri_.c_str(), (long long)elapsed);
+        } else {
+            entry.stats_.failed_++;
+            Log(API::LogLevel::_Warning, "⌁ #%zu, %s, exited with status %d after %lld ms", idx, entry.uri_.c_str(),
+                WIFEXITED(status) ? WEXITSTATUS(status) : -1, (long long)elapsed);
         }
-        // ... create session and set process group ID ...
-        setsid();
-        // ... reset ...
-        signal(SIGUSR1, SIG_DFL);
-        // ... error info ...        
-        typedef struct {
-            int         no_;
-            std::string str_;
-            const char* what_;
-        } Error;
-        Error error = { 0, "", nullptr };
-        
-        errno = 0;
-        struct passwd* pwd = getpwnam(a_entry.user_.c_str());
-        if ( nullptr == pwd ) {
-            error.no_   = errno;
-            error.str_  = strerror(errno);
-            error.what_ = "get user info";
-        }
-        if ( 0 == error.no_ && 0 != setgid(pwd->pw_gid) ) {
-            error.no_   = errno;
-            error.str_  = strerror(errno);
-            error.what_ = "set effective group ID";
-        }
-        if ( 0 == error.no_ && 0 != initgroups(a_entry.user_.c_str(), pwd->pw_gid) ) {
-            error.no_   = errno;
-            error.str_  = strerror(errno);
-            error.what_ = "initialize the group access list";
-        }
-        if ( 0 == error.no_ && 0 != setuid(pwd->pw_uid) ) {
-            error.no_   = errno;
-            error.str_  = strerror(errno);
-            error.what_ = "set the effective user ID";
-        }
-        if ( 0 == error.no_ && 0 != clearenv() ) {
-            error.no_   = -1;
-            error.str_  = "";
-            error.what_ = "clear environment";
-        }
-        // ... if not as root ...
-        if ( 0 == error.no_ && 0 != pwd->pw_uid ) {
-            // ... set specific user environment ...
-            if (
-                0 != setenv("PATH"              , API_DEFAULT_PATH , 1) ||
-                0 != setenv("LOGNAME"           , pwd->pw_name     , 1) ||
-                0 != setenv("USER"              , pwd->pw_name     , 1) ||
-                0 != setenv("USERNAME"          , pwd->pw_name     , 1) ||
-                0 != setenv("HOME"              , pwd->pw_dir      , 1) ||
-                0 != setenv("SHELL"             , pwd->pw_shell    , 1)
-                ) {
-                    error.no_   = -1;
-                    error.str_  = "";
-                    error.what_ = "set environment";
-                }
-            // ...
-            if ( 0 == error.no_ ) {
-                for ( const auto it : vars ) {
-                    if ( 0 != setenv(it.first, it.second.c_str(), 1) ) {
-                        error.no_   = -1;
-                        error.str_  = "";
-                        error.what_ = "set environment var";
-                        break;
-                    }
-                }
+        worker.entry_ = nullptr;
+    }
+    // ... worker is gone?
+    if ( sizeof(status) != length ) {
+        Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " Worker #%zu for '%s', pid %d, is gone!", idx, pool.credentials_->name_.c_str(), (int)worker.pid_);
+        Detach(worker.fd_);
+        close(worker.fd_);
+        workers_.erase(it);
+        worker.fd_  = -1;
+        worker.pid_ = -1;
+        // ... restart it, later if it could not even start or keeps crashing ...
+        if ( false == quit_ ) {
+            if ( std::chrono::steady_clock::now() - worker.forked_ < std::chrono::seconds(1) ) {
+                worker.failures_++;
+                Backoff(pool, idx);
+            } else {
+                worker.failures_ = 0;
+                (void)Restart(pool, idx);
             }
         }
-        // ... error set?
-        if ( 0 != error.no_ ) {
-            syslog(LOG_ERR, LOGGER_FAIL_SYMBOL " unable to launch %s", cmd.c_str());
-            syslog(LOG_ERR, "  ⌃ %s - ( %d ) %s", error.what_, error.no_, error.str_.c_str());
-            exit(-1);
+        // ... none left? commands are launched as processes until one is back ...
+        if ( pool.workers_.end() == std::find_if(pool.workers_.begin(), pool.workers_.end(), [] (const API::Worker& a_worker) { return -1 != a_worker.fd_; }) ) {
+            Log(API::LogLevel::_Warning, LOGGER_WARNING_SYMBOL " No workers running for '%s', commands are launched as processes!",
+                pool.credentials_->name_.c_str());
         }
-        // ...
-        (void)execlp(API_DEFAULT_SHELL, API_DEFAULT_SHELL, "-c", cmd.c_str(), nullptr);
-        
-        // ... if it reaches here, an error occurred with execlp ...
-        // ... log ...
-        syslog(LOG_ERR, "unable to launch '%s', execlp failed: %d - %s", cmd.c_str(), errno, strerror(errno));
-        exit(-1);
-        
-    } /* else { ... } - parent */
-    
-    // ... log ...
-    syslog(LOG_NOTICE, LOGGER_PASS_SYMBOL " (%s) CMD %s", a_entry.user_.c_str(), cmd.c_str());
+    }
+    // ... next pending, those that are now for processes are launched without the lock ...
+    if ( true == Drain(pool) ) {
+        lock.unlock();
+        Reap();
+    }
 }
 
 /**
@@ -1188,6 +4568,8 @@ void casper::inotify::API::Spawn (const API::Entry& a_entry, const API::Event& a
  * 
  * @param a_entry Entry where an event was triggered.
  * @param a_event Event that is being ignored.
+ *
+ * @return Always false, re-armed entries are spawned here, with their own configuration, not the helper entry.
  */
 bool casper::inotify::API::Handler (const API::Entry& a_entry, const API::Event& a_event)
 {
@@ -1210,86 +4592,98 @@ bool casper::inotify::API::Handler (const API::Entry& a_entry, const API::Event&
     }
     // ... log ...
     Log(API::LogLevel::_Info, "Handler, case #1 '%s'...", uri.c_str());    
-    Log(API::LogLevel::_Debug, a_event, a_entry, { a_event.name_ });
-    // ... search ...
-    API::Entry* entry = nullptr;
-    for ( size_t idx = 0 ; idx < entries_.bad_.size() ; ++idx ) {
-        if ( 0 != entries_.bad_[idx]->uri_.compare(uri) ) {
-            continue;
+    Log(API::LogLevel::_Debug, a_event, a_entry);
+    // ... search, all entries on this file are re-armed at once ...
+    std::vector<API::Entry*> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = entries_.bad_.find(uri);
+        if ( entries_.bad_.end() != it ) {
+            entries.swap(it->second);
+            entries_.bad_.erase(it);
         }
-        entry = entries_.bad_[idx];
-        entries_.bad_.erase(entries_.bad_.begin() + idx);
-        break;
-    }
-    // ... not found?
-    if ( nullptr == entry ) {
-        // ... nothing to do here ...
-        return false;
     }
     // ... register ...
-    if ( true == Register(entry) ) {
-        // ... as 'good' entry ...
-        Track(entry, true);
-        // ... success ...
-        return true;
-    } else {
-        // ... as 'bad' entry ...
-        Track(entry, false);
-        // ... failure ...
-        return false;
+    for ( auto entry : entries ) {
+        if ( true == Register(entry) ) {
+            // ... as 'good' entry ...
+            Track(entry, true);
+            if ( true == entry->reconcile_ ) {
+                List(*entry, entry->snapshot_);
+            }
+            // ... helper is shared by all files in this directory, launch with this file's configuration ...
+            if ( 0 != a_event.actions_ ) {
+                Spawn(*entry, a_event);
+            }
+        } else {
+            // ... as 'bad' entry ...
+            Track(entry, false);
+        }
     }
+    // ... helper itself has nothing to launch ...
+    return false;
 }
 
 // MARK: -
 
-/**
- * @brief Replace all occurences of a string.
- * 
- * @param a_value String to process.
- * @param a_from  Value to search for.
- * @param a_to    Value to replace with.
- */
-const std::string casper::inotify::API::Replace (std::string a_value, const std::string& a_from, const std::string& a_to)
-{
-    size_t start_pos = 0;
-    while ( std::string::npos != ( start_pos = a_value.find(a_from, start_pos) ) ) {
-        a_value.replace(start_pos, a_from.length(), a_to);
-        start_pos += a_to.length();
-    }
-    return a_value;
-}
-
 /**
  * @brief Collect current date and time in ISO8601WithTZ format.
  *
- * @param a_buffer Pre-allocated buffer to use.
+ * @param a_buffer    Pre-allocated buffer to use, at least API_TIMESTAMP_MAX_LENGTH bytes.
+ * @param a_timestamp Nanoseconds since epoch to format instead, 0 for current time.
+ *
+ * @note Date and time are only re-formatted when the second changes, the fraction of second
+ *       ( see \link _Timestamp::precision_ \link ) is appended on every call.
  */
-const char* const casper::inotify::API::Now (char* a_buffer) const
-{    
-    const auto now = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
-    
-    time_t tt     = (time_t)now;
-    tm     utc_tm;
-    
-    if ( &utc_tm != gmtime_r(&tt, &utc_tm) ) {
-        throw inotify::Exception("Unable to convert epoch to human readable time!");
+const char* const casper::inotify::API::Now (char* a_buffer, const uint64_t a_timestamp) const
+{
+    struct timespec ts;
+    if ( 0 != a_timestamp ) {
+        ts.tv_sec  = static_cast<time_t>(a_timestamp / 1000000000ull);
+        ts.tv_nsec = static_cast<long>(a_timestamp % 1000000000ull);
+    } else if ( 0 != clock_gettime(CLOCK_REALTIME, &ts) ) {
+        throw inotify::Exception("Unable to read current time: %d - %s!", errno, strerror(errno));
     }
-    
-    const auto seconds = static_cast<uint8_t >(utc_tm.tm_sec        ); /* seconds after the minute [0-60] */
-    const auto minutes = static_cast<uint8_t >(utc_tm.tm_min        ); /* minutes after the hour [0-59]   */
-    const auto hours   = static_cast<uint8_t >(utc_tm.tm_hour       ); /* hours since midnight [0-23]     */
-    const auto day     = static_cast<uint8_t >(utc_tm.tm_mday       ); /* day of the month [1-31]         */
-    const auto month   = static_cast<uint8_t >(utc_tm.tm_mon  +    1); /* months since January [1-12]     */
-    const auto year    = static_cast<uint16_t>(utc_tm.tm_year + 1900); /* years since 1970...2038         */
-    
-    const int w = snprintf(a_buffer, 26, "%04u-%02u-%02uT%02u:%02u:%02u+%02u:%02u",
-                           year,month, day, hours, minutes, seconds,
-                           0, 0
-    );
-    
-    if ( w <=0 || w > 25 ) {
-        throw inotify::Exception("Unable to convert epoch to ISO8601WithTZ!");
+    // ... date, time and offset only change once per second, cache them ( per thread ) ...
+    thread_local struct {
+        time_t second_;
+        bool   local_;
+        char   prefix_[20]; // YYYY-MM-DDTHH:MM:SS
+        char   offset_[7];  // +HH:MM
+    } cache = { static_cast<time_t>(-1), false, { 0 }, { 0 } };
+    if ( ts.tv_sec != cache.second_ || timestamp_.local_ != cache.local_ ) {
+        tm tm;
+        if ( &tm != ( timestamp_.local_ ? localtime_r(&ts.tv_sec, &tm) : gmtime_r(&ts.tv_sec, &tm) ) ) {
+            throw inotify::Exception("Unable to convert epoch to human readable time!");
+        }
+        const long offset  = ( timestamp_.local_ ? tm.tm_gmtoff : 0 );
+        const long minutes = ( offset < 0 ? -offset : offset ) / 60;
+        const int  p = snprintf(cache.prefix_, sizeof(cache.prefix_), "%04u-%02u-%02uT%02u:%02u:%02u",
+                                static_cast<unsigned>(tm.tm_year + 1900), static_cast<unsigned>(tm.tm_mon + 1), static_cast<unsigned>(tm.tm_mday),
+                                static_cast<unsigned>(tm.tm_hour), static_cast<unsigned>(tm.tm_min), static_cast<unsigned>(tm.tm_sec)
+        );
+        const int o = snprintf(cache.offset_, sizeof(cache.offset_), "%c%02u:%02u",
+                               ( offset < 0 ? '-' : '+' ), static_cast<unsigned>(minutes / 60), static_cast<unsigned>(minutes % 60)
+        );
+        if ( 19 != p || 6 != o ) {
+            throw inotify::Exception("Unable to convert epoch to ISO8601WithTZ!");
+        }
+        cache.second_ = ts.tv_sec;
+        cache.local_  = timestamp_.local_;
     }
-    
+    // ... YYYY-MM-DDTHH:MM:SS[.mmm|.uuuuuu]+HH:MM ...
+    char* it = a_buffer;
+    memcpy(it, cache.prefix_, 19);
+    it += 19;
+    if ( 0 != timestamp_.precision_ ) {
+        unsigned fraction = static_cast<unsigned>(ts.tv_nsec / ( 3 == timestamp_.precision_ ? 1000000 : 1000 ));
+        *it = '.';
+        for ( uint8_t idx = timestamp_.precision_ ; idx > 0 ; --idx ) {
+            it[idx] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        it += 1 + timestamp_.precision_;
+    }
+    memcpy(it, cache.offset_, 7);
     return a_buffer;
 }
\ No newline at end of file
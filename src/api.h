@@ -25,15 +25,34 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
 
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <sys/inotify.h>
 #include <limits.h>
+#include <signal.h>
+#include <sched.h> // cpu_set_t
 
 #include "json/json.h"
 
 #include "exception.h"
+#include "template.h"
+#include "glob.h"
+#include "index.h"
+#include "logger.h"
+#include "metrics.h"
+#include "stream.h"
+#include "ring.h"
+#include "journal.h"
+#include "plugins.h"
 
 namespace casper
 {
@@ -43,12 +62,20 @@ namespace casper
         
         class API final
         {
-            
+
+            friend class Bench;       // tools/bench.cc
+            friend class DecodeBench; // tools/decode_bench.cc
+
 #define IN_STRUCT_EVENT_SIZE            ( sizeof (struct inotify_event) )
 #define IN_MAX_EVENTS_PER_LOOP          1024
 #define IN_STRUCT_NAME_FIELD_MAX_LENGTH PATH_MAX
 #define IN_BUFFER_MAX_LENGTH            ( IN_MAX_EVENTS_PER_LOOP * ( IN_STRUCT_EVENT_SIZE + IN_STRUCT_NAME_FIELD_MAX_LENGTH )) 
 
+#define API_TIMESTAMP_MAX_LENGTH        33 // YYYY-MM-DDTHH:MM:SS.uuuuuu+HH:MM
+
+#define API_METRICS_EVENT_BITS          16 // IN_ACCESS ... IN_IGNORED
+#define API_WORKER_ARGUMENT             "--worker" // command line of a persistent command worker, socket is fd 3
+
 		public: // Enum(s)
 
     	 typedef enum {
@@ -66,9 +93,38 @@ namespace casper
                 _File      = 0,
                 _Directory = 1
             } Type;                   
+
+            typedef enum {
+                _INotifyBackend  = 0, //!< One watch per entry.
+                _FANotifyBackend = 1  //!< One mark covers a whole filesystem or mount.
+            } Backend;
+
+            typedef enum {
+                _CommandSink = 0, //!< Launch a command.
+                _SocketSink,      //!< Publish to \link API::stream_ \link subscribers.
+                _RingSink,        //!< Publish to \link API::ring_ \link readers.
+                _PluginSink       //!< Handled in process, by a \link API::plugins_ \link instance.
+            } Sink;
+
+            typedef enum {
+                _EventVar = 0,
+                _ObjectVar,
+                _NameVar,
+                _ParentNameVar,
+                _OldNameVar,
+                _DateTimeVar,
+                _HostNameVar,
+                _MsgVar,
+                _CmdVar,
+                _VariablesCount
+            } Variable;             //!< Slots for \link API::sk_variables_ \link.
             
         private: // Data Type(s)
             
+            //
+            // POD, decoding does not allocate: object and parent names point
+            // to the inotify read buffer or to the entry's URI.
+            //
             typedef struct _Event {
                 uint32_t    mask_;
                 char        object_type_c_;
@@ -77,42 +133,251 @@ namespace casper
                 char        parent_object_type_c_;
                 const char* parent_object_name_;
                 bool        inside_a_watched_directory_;
-                std::string name_;
-                std::string iso_8601_with_tz_;
+                const char* old_object_name_;        //!< Full path before a rename, nullptr otherwise.
+                uint16_t    actions_;                //!< Bitfield, bit N set when sk_actions_[N] matched.
+                char        name_[64];               //!< Actions names, ', ' separated or '???' if none.
+                char        iso_8601_with_tz_[API_TIMESTAMP_MAX_LENGTH];
             } Event;
             
+            typedef struct {
+                uid_t              uid_;
+                gid_t              gid_;
+                std::vector<gid_t> groups_; //!< Supplementary groups.
+                std::string        name_;
+                std::string        home_;
+                std::string        shell_;
+                std::string        error_;  //!< Set when user could not be resolved.
+            } Credentials;
+
+            typedef struct {
+                int64_t size_;
+                int64_t mtime_;     //!< Nanoseconds since epoch.
+                bool    directory_;
+            } Stat;
+
+            typedef std::unordered_map<std::string, Stat> Snapshot; //!< By object name, "" for the watched object itself.
+
+            struct _Pool;
+            struct _Shard;
+
             typedef struct _Entry {
                 const Type        type_;    //!< One of \link Type \link.
                 const std::string uri_;     //!<
                 uint32_t          mask_;    //!<
-                int               wd_;      //!< Watch descriptor.
+                int               wd_;      //!< Watch descriptor, -1 when not watched, API_FANOTIFY_WD when marked.
                 const std::string user_;    //!<
                 const std::string cmd_;     //!< Command to execute.
                 const std::string msg_;     //!< Message to export CASPER_INOTIFY_MESSAGE.
-                std::string       pattern_; //!<
+                std::string       pattern_; //!< Patterns, as configured, for logging.
                 std::string       error_;   //!<
                 std::string       warning_; //!<
-                std::function<bool(const struct _Entry&, const Event&)> handler_; //!<
+                //
+                // Management entries only: called before an event is dispatched, it's skipped when false is returned.
+                // \link API::Handler \link re-arms file entries on IN_CREATE and dispatches their event itself, each with
+                // it's own configuration, so it always returns false and nothing is launched for the helper entry.
+                //
+                std::function<bool(const struct _Entry&, const Event&)> handler_;
+                Template          cmd_tpl_; //!< Parsed \link _Entry::cmd_ \link.
+                Template          msg_tpl_; //!< Parsed \link _Entry::msg_ \link.
+                Glob              glob_;    //!< Parsed \link _Entry::pattern_ \link.
+                const Credentials* credentials_; //!< Resolved \link _Entry::user_ \link.
+                struct _Pool*     pool_;    //!< Persistent workers that execute commands, nullptr to fork per event.
+                size_t            debounce_ms_; //!< Coalescing window, 0 - disabled.
+                size_t            max_concurrent_; //!< Maximum number of running commands, 0 - unlimited.
+                bool              recursive_;  //!< True when subdirectories are watched too.
+                uint32_t          extra_mask_; //!< Events watched only to keep recursive watches in sync, not reported.
+                struct _Entry*    root_;       //!< Configured entry a subdirectory entry was derived from, nullptr if configured.
+                Backend           backend_;    //!< One of \link Backend \link.
+                unsigned int      mark_;       //!< FAN_MARK_FILESYSTEM or FAN_MARK_MOUNT, fanotify backend only.
+                bool              reconcile_;  //!< True when a snapshot is kept to recover from queue overflows.
+                Snapshot          snapshot_;   //!< Objects last known state.
+                struct _Shard*    shard_;      //!< inotify instance ( and thread ) this entry is watched by.
+                std::string       key_;        //!< Configuration it was created from, entries with the same key are kept on reload.
+                Sink              sink_;       //!< One of \link Sink \link.
+                uint64_t          id_;         //!< Hash of \link _Entry::key_ \link, identifies it in the journal.
+                std::shared_ptr<Plugins::Instance> plugin_; //!< Handler plugin, when sink is "plugin".
+                mutable struct {
+                    size_t   running_;          //!< Number of running commands.
+                    size_t   pending_;          //!< Number of queued commands.
+                    uint64_t launched_;         //!< Number of launched commands.
+                    uint64_t failed_;           //!< Number of commands that failed to launch or exited with an error.
+                    uint64_t dropped_;          //!< Number of commands dropped because queue was full.
+                    int      last_status_;      //!< Last waitpid(2) status.
+                    uint64_t last_duration_ms_; //!< Last command duration, in milliseconds.
+                } stats_;
+                mutable struct {
+                    std::atomic<uint64_t> events_[API_METRICS_EVENT_BITS]; //!< Events received, by mask bit, before patterns are applied.
+                    std::atomic<uint64_t> filtered_;       //!< Events discarded by patterns.
+                    std::atomic<uint64_t> spawn_failures_; //!< Commands that could not be launched or submitted.
+                } counters_;                               //!< Lock-free, for metrics; subdirectories entries count in their root.
+                _Entry (const Type a_type, const std::string& a_uri, const uint32_t a_mask,
+                        const std::string& a_user = "", const std::string& a_cmd = "", const std::string& a_msg = "",
+                        const std::function<bool(const struct _Entry&, const Event&)>& a_handler = nullptr);
             } Entry;
             
 			typedef struct {
-                std::set<std::string> directories_;
-                std::set<std::string> files_;
+                std::unordered_set<std::string> directories_;
+                std::unordered_set<std::string> files_;
             } WatchedSets;
 
             typedef struct {
                 std::vector<Entry*>   all_;
-                std::map<int, Entry*> good_;
-                std::vector<Entry*>   bad_;
+                std::unordered_map<std::string, std::vector<Entry*>> bad_;  //!< By URI, protected by \link API::mutex_ \link.
 				WatchedSets 		  uris_;
+                std::vector<Entry*>   retired_; //!< Removed by a reload, released once none of their commands is running or pending.
             } Entries;
+
+            typedef struct {
+                std::unordered_map<std::string, std::vector<Entry*>> unmatched_; //!< Current entries not found in new configuration yet, by key.
+                std::vector<Entry*>                                  added_;     //!< Entries created for new configuration.
+                size_t                                               kept_;      //!< Number of current entries found in new configuration.
+            } Reloading;
                         
             typedef struct {
                 std::string user_;
                 std::string message_;
                 std::string command_;
+                size_t      max_concurrent_;
+                std::string executor_;
+                size_t      workers_;
+                size_t      debounce_ms_;
+                size_t      scan_threads_;
+                bool        reconcile_;
+                std::string sink_;  //!< "command", "socket", "ring" or "plugin".
+                std::string key_;   //!< What entries inherit, part of their \link Entry::key_ \link.
             } Defaults;
 
+            typedef struct {
+                std::string uri_;   //!< Subdirectory URI.
+                int         wd_;    //!< Watch descriptor, -1 when it could not be watched.
+                int         errno_; //!< Why it could not be watched.
+            } Scanned;
+
+            typedef struct {
+                std::string parent_;    //!< Directory URI.
+                std::string name_;      //!< Object name.
+                bool        directory_;
+            } Found;
+
+            typedef struct {
+                const Entry* entry_;
+                std::string  name_;   //!< Object name, empty when event is for the watched object itself.
+            } DeferredKey;
+
+            struct DeferredKeyHash {
+                size_t operator() (const DeferredKey& a_key) const
+                {
+                    return std::hash<std::string>()(a_key.name_) ^ ( std::hash<const void*>()(a_key.entry_) << 1 );
+                }
+            };
+
+            struct DeferredKeyEqual {
+                bool operator() (const DeferredKey& a_lhs, const DeferredKey& a_rhs) const
+                {
+                    return a_lhs.entry_ == a_rhs.entry_ && a_lhs.name_ == a_rhs.name_;
+                }
+            };
+
+            typedef struct {
+                uint32_t mask_;      //!< OR of all coalesced events masks.
+                bool     inside_;    //!< True when event is for an object inside a watched directory.
+                uint64_t deadline_;  //!< Tick when event is due.
+                size_t   count_;     //!< Number of coalesced events.
+                std::string old_name_; //!< Full path before last coalesced rename, empty if none.
+            } Deferred;
+
+            typedef struct {
+                int         wd_;       //!< Watch descriptor of the directory it was moved from.
+                std::string name_;     //!< Object name in that directory.
+                uint32_t    mask_;     //!< IN_MOVED_FROM event mask.
+                uint64_t    deadline_; //!< Tick when it's no longer expected to be paired.
+            } Move;
+
+            struct _Timers {
+                int                                   fd_;    //!< timerfd, armed only while there are deferred events.
+                uint64_t                              tick_;  //!< Current tick, see API_TIMER_TICK_MS.
+                std::vector<std::vector<DeferredKey>> wheel_; //!< Hashed timing wheel, by deadline tick.
+            };
+
+            //
+            // Entries sharing a watch descriptor: same object, same inotify instance.
+            //
+            typedef struct {
+                std::vector<Entry*> entries_; //!< In configuration order.
+                Index               index_;   //!< Patterns of all entries, by position in entries_.
+                uint32_t            mask_;    //!< What kernel watch was last set to, union of all entries masks.
+                bool                ignored_; //!< True once kernel released it ( IN_IGNORED ), it's mask is left alone.
+            } Group;
+
+            //
+            // An inotify instance and everything needed to process it's events, only
+            // touched by the thread that drains it: shard #0 is drained by main loop,
+            // each of the others by it's own thread.
+            //
+            typedef struct _Shard {
+                size_t                        index_;
+                int                           fd_;       //!< inotify instance.
+                std::vector<char>             buffer_;   //!< inotify read buffer.
+                std::vector<Group*>           watches_;  //!< Indexed by watch descriptor, nullptr when not tracked.
+                std::vector<size_t>           matches_;  //!< Reusable \link Index::Match \link output.
+                std::map<std::string, Entry*> derived_;  //!< Subdirectories of recursive entries, by URI.
+                struct _Timers                timers_;
+                std::unordered_map<DeferredKey, Deferred, DeferredKeyHash, DeferredKeyEqual> deferred_;
+                std::unordered_map<uint32_t, Move> moves_; //!< IN_MOVED_FROM halves waiting for their IN_MOVED_TO, by cookie.
+                int                           epoll_fd_; //!< Own reactor, -1 for shard #0.
+                int                           wake_fd_;  //!< eventfd, interrupts epoll_wait on shutdown, -1 for shard #0.
+                int                           cpu_;      //!< CPU it's thread is pinned to, -1 if none.
+                std::thread*                  thread_;   //!< nullptr for shard #0.
+                struct {
+                    std::atomic<uint64_t> reads_;  //!< Number of read(2) calls that returned events.
+                    std::atomic<uint64_t> bytes_;  //!< Number of bytes read.
+                    std::atomic<uint64_t> events_; //!< Number of events read.
+                } counters_;
+                Histogram                     sizes_;    //!< read(2) sizes, in bytes.
+                Histogram                     latency_;  //!< From read(2) to dispatch, in nanoseconds.
+            } Shard;
+
+            typedef struct {
+                size_t max_concurrent_; //!< Maximum number of running commands, 0 - unlimited.
+                size_t max_pending_;    //!< Maximum number of commands waiting to be launched.
+            } Limits;
+
+            typedef struct {
+                const Entry*                          entry_;
+                std::chrono::steady_clock::time_point start_;
+            } Child;
+
+            typedef struct {
+                const Entry*             entry_;
+                std::string              cmd_;
+                std::vector<std::string> env_;
+            } Job;
+
+            typedef struct {
+                int                                   fd_;      //!< Socket, -1 when not running.
+                pid_t                                 pid_;
+                const Entry*                          entry_;   //!< Entry whose command is running, nullptr when idle.
+                std::chrono::steady_clock::time_point start_;   //!< When current command was submitted.
+                std::chrono::steady_clock::time_point forked_;  //!< When worker was started.
+                size_t                                failures_; //!< Consecutive failed starts, each one doubles the restart delay.
+                std::chrono::steady_clock::time_point restart_;  //!< When it's to be restarted, epoch when it's not waiting to be.
+            } Worker;
+
+            typedef struct _Pool {
+                const Credentials*  credentials_; //!< Workers run as this user.
+                std::vector<Worker> workers_;
+                std::deque<Job>     pending_;
+            } Pool;
+
+            typedef struct {
+                std::unordered_map<pid_t, Child> running_;
+                std::deque<Job>                  pending_;
+                uint64_t                         dropped_;
+                size_t                           launching_; //!< Reserved, being launched without the lock.
+                std::unordered_map<pid_t, int>   reaped_;    //!< Status of those that exited before their launcher recorded them.
+                std::unordered_set<pid_t>        untracked_; //!< Workers and those left running by unload, reaped but not accounted for.
+            } Children;
+
             struct _Owner {
                 uid_t       user_id_;
                 std::string user_name_;
@@ -124,16 +389,99 @@ namespace casper
 
 			struct _Log {
                 std::string uri_;
-            	FILE*       fp_;
 				LogLevel    level_;
             	int         entry_ml_;
-            	char        time_[27];
+                uint32_t    flush_interval_ms_; //!< Log file flush interval, as last loaded.
 			};
 
-			struct _INotify {
-				int  fd_;
-            	char buffer_[IN_BUFFER_MAX_LENGTH];
-			};
+            struct _Timestamp {
+                uint8_t precision_; //!< Number of fractional second digits, 0, 3 or 6.
+                bool    local_;     //!< True for local time and offset, false for UTC.
+            };
+
+            struct _Render {
+                std::string cmd_; //!< Reusable buffer for rendered command.
+                std::string msg_; //!< Reusable buffer for rendered message.
+                std::vector<std::string> env_;  //!< Reusable environment strings.
+                std::vector<char*>       envp_; //!< Pointers to \link _Render::env_ \link, nullptr terminated.
+                std::string              message_; //!< Reusable buffer for worker messages.
+            };
+
+            struct _FANotify {
+                int                                          fd_;      //!< fanotify group, -1 until an entry is marked.
+                std::vector<Entry*>                          entries_; //!< Marked entries.
+                std::map<uint64_t, int>                      mounts_;  //!< File descriptors, to resolve file handles, by fsid.
+                std::unordered_map<std::string, std::string> paths_;   //!< Directories paths, by file handle.
+                std::string                                  name_;    //!< Reusable buffer for relative names.
+                std::vector<char>                            buffer_;
+            };
+
+            struct _Stats {
+                std::atomic<uint64_t> overflows_;   //!< Number of queue overflows.
+                std::atomic<uint64_t> reconciled_;  //!< Number of events synthesized by reconciliation.
+            };
+
+            typedef struct {
+                std::string                           text_;     //!< Rendered when client connected.
+                size_t                                sent_;
+                std::chrono::steady_clock::time_point deadline_; //!< Client is dropped if it did not take it all by then.
+            } Scrape;
+
+            struct _Metrics {
+                std::string file_;        //!< Prometheus text file, rewritten every \link _Metrics::interval_ms_ \link, empty if none.
+                std::string socket_;      //!< Unix socket that serves the same text to each connection, empty if none.
+                size_t      interval_ms_;
+                bool        entries_;     //!< True when per entry metrics are exported.
+                int         timer_fd_;    //!< timerfd, -1 when there's no file to write.
+                int         socket_fd_;   //!< Listening socket, -1 when there's no socket.
+                std::string bound_;       //!< Path listening socket is bound to, removed when it's closed.
+                Histogram   durations_;   //!< Commands durations, in microseconds.
+                std::string text_;        //!< Reusable buffer.
+                std::map<int, Scrape> scrapes_; //!< Clients still being sent their text, by socket.
+            };
+
+            struct _Sink {
+                std::string    socket_;   //!< Stream socket path, empty if none.
+                Stream::Format format_;
+                size_t         capacity_; //!< Maximum number of frames queued per subscriber.
+                Stream::Policy policy_;   //!< Applied when a subscriber's queue is full.
+                struct {
+                    std::string socket_;    //!< Ring socket path, empty if none.
+                    size_t      slots_;
+                    size_t      slot_size_;
+                } ring_;
+            };
+
+            struct _Journaling {
+                std::string directory_;     //!< Where segments are kept, empty if events are not journaled.
+                size_t      segment_size_;
+                size_t      segments_;      //!< Number of segments to keep.
+                size_t      interval_ms_;   //!< Sync interval.
+            };
+
+            struct _Replay {
+                bool     enabled_;   //!< True when journaled events are to be dispatched again on startup.
+                uint64_t sequence_;  //!< First record to dispatch, 0 - by timestamp.
+                uint64_t timestamp_; //!< Nanoseconds since epoch, records older than this are skipped.
+            };
+
+            struct _Handlers {
+                size_t threads_;  //!< Plugins handler threads.
+                size_t capacity_; //!< Maximum number of events queued per thread.
+            };
+
+            struct _Clock {
+                std::chrono::steady_clock::time_point read_;    //!< When events being dispatched were read.
+                Histogram*                            latency_; //!< Where read to dispatch latency is recorded, nullptr when not reading.
+            };
+
+            struct _Reactor {
+                int      fd_;        //!< epoll file descriptor.
+                int      wake_fd_;   //!< eventfd used to interrupt epoll_wait ( shutdown ).
+                int      signal_fd_; //!< signalfd, delivers \link _Reactor::signals_ \link on main loop.
+                sigset_t signals_;   //!< Signals blocked by the process and handled by this instance.
+                cpu_set_t affinity_; //!< Main thread CPU affinity, restored in children launched by pinned shards.
+            };
             
         private: // Static Const Data
             
@@ -143,18 +491,51 @@ namespace casper
                 const char* const description_;
             } FieldInfo;
             
+            typedef struct {
+                const uint32_t    mask_;
+                const char* const name_;
+            } ActionInfo;
+            
             static const std::map<uint32_t, const FieldInfo> sk_field_id_to_name_map_;
             static const std::map<std::string, uint32_t>     sk_field_key_to_id_map_;
+            static const ActionInfo                          sk_actions_[];
+            static const char* const                         sk_variables_[];
             
         private: // Data
             
             pid_t       	pid_;
-			struct _INotify inotify_;
+            std::vector<Shard*> shards_;
+            struct _FANotify fanotify_;
+            struct _Reactor reactor_;
 			struct _Log		log_;
+            struct _Timestamp timestamp_;
+            Logger          logger_;
             struct _Owner   owner_;
             Defaults    	defaults_;
             Entries     	entries_;
-            bool            quit_;
+            static thread_local struct _Render render_; //!< Per thread, see \link _Shard \link.
+            static thread_local struct _Clock  clock_;  //!< Per thread, see \link _Shard \link.
+            std::map<std::string, Credentials> credentials_;
+            Limits          limits_;
+            Children        children_;
+            std::map<std::string, Pool>                  pools_;   //!< By user name.
+            std::map<int, std::pair<Pool*, size_t>>      workers_; //!< By socket.
+            size_t                                       restarts_; //!< Workers waiting to be restarted, shard #0 timer ticks while there are any.
+            std::mutex      mutex_;   //!< Protects children, pools, workers and entries stats, shared by all shards.
+            struct _Stats   stats_;
+            struct _Metrics metrics_;
+            struct _Sink    sink_;
+            Stream          stream_;  //!< Events of entries whose sink is "socket".
+            Ring            ring_;    //!< Events of entries whose sink is "ring".
+            struct _Journaling journaling_;
+            Journal         journal_; //!< Dispatched events, of all sinks.
+            struct _Replay  replay_;
+            struct _Handlers handlers_;
+            Plugins         plugins_; //!< Handlers of entries whose sink is "plugin".
+            std::atomic<bool> quit_;
+            std::atomic<bool> halt_;  //!< Stops shards threads, but not main loop.
+            std::string     config_;  //!< Configuration file URI, re-read on SIGHUP.
+            Reloading*      reloading_; //!< Set while configuration is being reloaded, nullptr otherwise.
 
         public: // Constructor(s) / Destructor
             
@@ -165,26 +546,64 @@ namespace casper
             
         public: // Method(s) // Function(s)
             
-			void Init     (const LogLevel a_level, const std::string& a_uri);
+			void Init     (const LogLevel a_level, const std::string& a_uri, const sigset_t& a_signals);
             void Load     (const std::string& a_uri);
             int  Watch    ();
             void Unload   ();
             void OnSignal (const int a_sig_no);
+            void Rewind   (const uint64_t a_sequence, const uint64_t a_timestamp);
+            void Stop     ();
+
+            static void Serve (const int a_fd) __attribute__((noreturn));
             
         private: // Method(s) // Function(s)
+
+            void Attach (const int a_fd);
+            void Detach (const int a_fd);
             
             bool Register   (Entry* a_entry);
             bool Unregister (Entry* a_entry);
+            bool Mark       (Entry* a_entry);
+            void OnFANotify ();
+            const std::string* Path (const uint64_t a_fsid, const void* a_handle);
             bool Wait ();
+            void Run  (Shard& a_shard);
+            void Join ();
+            void Suspend ();
+            void Resume  ();
+            void Reload  ();
+            void Read (Shard& a_shard);
+            void Deliver (Shard& a_shard, Group& a_watch, const uint32_t a_mask, const char* const a_name);
+            void Count   (const Entry& a_entry, const uint32_t a_mask, const bool a_filtered);
+            void Hold    (Shard& a_shard, const struct inotify_event& a_event, const char* const a_name);
+            bool Pair    (Shard& a_shard, const struct inotify_event& a_event, Group& a_watch, const char* const a_name);
+            void Expire  (Shard& a_shard);
+            void Dispatch (Entry& a_entry, const uint32_t a_mask, const char* const a_name, const bool a_filter = true,
+                           const char* const a_old_name = nullptr);
+            void Decode (const uint32_t a_mask, const char* const a_name, const Entry& a_entry, Event& o_event) const;
+            void Defer   (const Entry& a_entry, const Event& a_event);
+            void Arm     (Shard& a_shard);
+            void OnTimer (Shard& a_shard);
+
+            void Expose  ();
+            void Publish ();
+            void Accept  ();
+            void Send    (const int a_fd);
+            void Timeout (const bool a_all = false);
+            void Collect (std::string& o_text);
+            void Listen  ();
+            void Replay  ();
+            
+            static uint32_t Unpair (const uint32_t a_mask);
             
         private: // Method(s) // Function(s)
 
             void Open (const std::string& a_uri, const bool a_recycled);
             void Log  (const LogLevel a_level, const char* const a_format, ...) __attribute__((format(printf, 3, 4)));
+            void Print (const char* const a_format, ...) __attribute__((format(printf, 2, 3)));
 			void Log  (const Entries& a_entries);
             void Log  (const char* const a_symbol, const Entry& a_entry);
-            void Log  (const LogLevel a_level, const Event& a_event, const Entry& a_entry,
-					   const std::vector<std::string>& a_actions);
+            void Log  (const LogLevel a_level, const Event& a_event, const Entry& a_entry);
             void Log  (const API::LogLevel a_level, const std::map<uint32_t, const FieldInfo>& a_fields);
 
 		private: // Method(s) // Function(s)
@@ -195,15 +614,48 @@ namespace casper
 			
 			void Track   (Entry* a_entry, const bool a_good, const bool a_log = false);
 			void Untrack (Entry* a_entry, const char* const a_reason = nullptr, const bool a_log = false);
+			Group* Lookup  (const Shard& a_shard, const int a_wd) const;
+			void   Release (Entry* a_entry);
+			void   Rewatch (Shard& a_shard, Group& a_watch, const bool a_force = false);
+
+            void   Descend   (Entry* a_entry, const bool a_synthesize);
+            void   Scan      (const int a_fd, const std::string& a_uri, const uint32_t a_mask, const size_t a_threads,
+                              std::vector<Scanned>& o_scanned, std::vector<Found>* o_found) const;
+            void   Propagate (Entry* a_entry, const uint32_t a_mask, const char* const a_name);
+            bool   Covers    (const Shard& a_shard, const int a_wd, const Entry* a_root) const;
+            Entry* Derive    (Entry* a_root, const std::string& a_uri, const int a_wd);
+            void   Prune     (Shard& a_shard, const std::string& a_uri);
+            void   Rebase    (Shard& a_shard, const std::string& a_from, const std::string& a_to);
+            void   Forget    (Entry* a_entry);
+            void   Drop      (Entry* a_entry);
+
+            void   List      (const Entry& a_entry, Snapshot& o_snapshot) const;
+            void   Remember  (Entry* a_entry, const uint32_t a_mask, const char* const a_name);
+            void   Reconcile (Shard& a_shard);
+            void   Reconcile (Entry* a_entry);
 
 			void Ignore  (const Entry& a_entry, const Event& a_event);
-            void Spawn   (const Entry& a_entry, const Event& a_event);
+            void Spawn   (const Entry& a_entry, const Event& a_event, const bool a_journal = true);
+            bool Execute   (const Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env);
+            void Exited    (const Entry& a_entry, const pid_t a_pid, const int a_status, const std::chrono::steady_clock::time_point& a_start);
+            bool CanLaunch (const Entry& a_entry) const;
+            void Reap      ();
+            bool Admit     (const Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env);
+            void Fork      (Pool& a_pool, const size_t a_idx);
+            bool Restart   (Pool& a_pool, const size_t a_idx);
+            void Backoff   (Pool& a_pool, const size_t a_idx);
+            void Revive    ();
+            bool Submit    (Pool& a_pool, const Entry& a_entry, const std::string& a_cmd, const std::vector<std::string>& a_env);
+            bool Drain     (Pool& a_pool);
+            void OnWorker  (const int a_fd);
+            pid_t Launch (const Credentials& a_credentials, const std::string& a_cmd, char* const* a_envp,
+                          const char*& o_what, int& o_no);
+            const Credentials* Resolve (const std::string& a_user);
             bool Handler (const Entry& a_entry, const Event& a_event);
 
 		private: // Method(s) // Function(s)
 
-            const char* const Now     (char* a_buffer) const;
-            const std::string Replace (std::string a_value, const std::string& a_from, const std::string& a_to);
+            const char* const Now     (char* a_buffer, const uint64_t a_timestamp = 0) const;
             
         }; // end of class 'API'
         
@@ -0,0 +1,370 @@
+/**
+ * @file glob.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "glob.h"
+
+#include <string.h> // strlen, memcmp, strrchr
+#include <ctype.h>  // isalpha, isdigit, etc
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Glob::Glob ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Glob::~Glob ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Parse a set of patterns and pick the fastest way to match each one.
+ *
+ * @param a_patterns Patterns, those starting with '!' exclude names.
+ */
+void casper::inotify::Glob::Compile (const std::vector<std::string>& a_patterns)
+{
+    sources_ = a_patterns;
+    sets_.clear();
+    include_ = Group();
+    exclude_ = Group();
+    // ...
+    std::vector<Token>   tokens;
+    std::vector<Pattern> extensions[2];
+    for ( const auto& source : sources_ ) {
+        const bool  negative = ( source.length() > 0 && '!' == source[0] );
+        Group&      group    = ( true == negative ? exclude_ : include_ );
+        if ( false == Parse(true == negative ? source.substr(1) : source, tokens) ) {
+            // ... never matches, as with fnmatch(3) ...
+            group.patterns_.push_back({ Kind::_Invalid, "", "", {} });
+            continue;
+        }
+        // ... literal, or literals around a single '*'?
+        size_t stars = 0;
+        size_t star  = 0;
+        bool   other = false;
+        for ( size_t idx = 0 ; idx < tokens.size() ; ++idx ) {
+            if ( TokenType::_Star == tokens[idx].type_ ) {
+                stars++;
+                star = idx;
+            } else if ( TokenType::_Char != tokens[idx].type_ ) {
+                other = true;
+            }
+        }
+        Pattern pattern;
+        if ( false == other && stars <= 1 ) {
+            for ( size_t idx = 0 ; idx < ( 1 == stars ? star : tokens.size() ) ; ++idx ) {
+                pattern.prefix_.append(1, static_cast<char>(tokens[idx].char_));
+            }
+            for ( size_t idx = star + 1 ; 1 == stars && idx < tokens.size() ; ++idx ) {
+                pattern.suffix_.append(1, static_cast<char>(tokens[idx].char_));
+            }
+            pattern.kind_ = ( 0 == stars ? Kind::_Literal : Kind::_Affix );
+            // ... '*.ext' ?
+            if ( Kind::_Affix == pattern.kind_ && 0 == pattern.prefix_.length() && pattern.suffix_.length() > 1
+                && '.' == pattern.suffix_[0] && std::string::npos == pattern.suffix_.find('.', 1) ) {
+                extensions[true == negative ? 1 : 0].push_back(std::move(pattern));
+                continue;
+            }
+        } else {
+            // ... literals at both ends are compared first, only what's between is matched token by token ...
+            size_t first = 0;
+            size_t last  = tokens.size();
+            while ( first < last && TokenType::_Char == tokens[first].type_ ) {
+                pattern.prefix_.append(1, static_cast<char>(tokens[first++].char_));
+            }
+            while ( last > first && TokenType::_Char == tokens[last - 1].type_ ) {
+                pattern.suffix_.insert(pattern.suffix_.begin(), static_cast<char>(tokens[--last].char_));
+            }
+            pattern.kind_ = Kind::_Generic;
+            pattern.tokens_.assign(tokens.begin() + first, tokens.begin() + last);
+        }
+        group.patterns_.push_back(std::move(pattern));
+    }
+    // ... a single extension is faster to compare as a suffix than to look up ...
+    for ( size_t idx = 0 ; idx < 2 ; ++idx ) {
+        Group& group = ( 0 == idx ? include_ : exclude_ );
+        for ( auto& pattern : extensions[idx] ) {
+            if ( 1 == extensions[idx].size() ) {
+                group.patterns_.push_back(std::move(pattern));
+            } else {
+                group.extensions_.insert(pattern.suffix_.substr(1));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Check if a name is matched by this set of patterns.
+ *
+ * @param a_name Name to test.
+ *
+ * @return True when it matches, or there are no patterns.
+ */
+bool casper::inotify::Glob::Match (const char* const a_name) const
+{
+    if ( 0 == sources_.size() ) {
+        return true;
+    }
+    const size_t length = strlen(a_name);
+    if ( ( 0 != include_.patterns_.size() || 0 != include_.extensions_.size() ) && false == Match(include_, a_name, length) ) {
+        return false;
+    }
+    return ( false == Match(exclude_, a_name, length) );
+}
+
+/**
+ * @brief Collect literals that every matching name must contain, at least one of them.
+ *
+ * @param o_anchors One literal per including pattern.
+ *
+ * @return False when there's no such set: no including patterns, or one of them has no literal.
+ */
+bool casper::inotify::Glob::Anchors (std::vector<std::string>& o_anchors) const
+{
+    o_anchors.clear();
+    if ( 0 == include_.patterns_.size() && 0 == include_.extensions_.size() ) {
+        return false;
+    }
+    for ( const auto& extension : include_.extensions_ ) {
+        o_anchors.push_back('.' + extension);
+    }
+    for ( const auto& pattern : include_.patterns_ ) {
+        // ... longest literal ...
+        const std::string* longest = ( pattern.prefix_.length() >= pattern.suffix_.length() ? &pattern.prefix_ : &pattern.suffix_ );
+        std::string        run;
+        std::string        best;
+        for ( const auto& token : pattern.tokens_ ) {
+            if ( TokenType::_Char == token.type_ ) {
+                run.append(1, static_cast<char>(token.char_));
+                continue;
+            }
+            if ( run.length() > best.length() ) {
+                best.swap(run);
+            }
+            run.clear();
+        }
+        if ( best.length() > longest->length() ) {
+            longest = &best;
+        }
+        if ( Kind::_Invalid == pattern.kind_ ) {
+            // ... never matches, nothing to look for ...
+            continue;
+        } else if ( 0 == longest->length() ) {
+            return false;
+        }
+        o_anchors.push_back(*longest);
+    }
+    return true;
+}
+
+// MARK: -
+
+/**
+ * @brief Parse a pattern into single character tokens.
+ *
+ * @param a_source Pattern to parse.
+ * @param o_tokens Tokens.
+ *
+ * @return False if the pattern is invalid ( ends with an escape character ).
+ */
+bool casper::inotify::Glob::Parse (const std::string& a_source, std::vector<Token>& o_tokens)
+{
+    static const struct {
+        const char* const name_;
+        int (*test_)(int);
+    } sk_classes[] = {
+        { "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank }, { "cntrl", iscntrl },
+        { "digit", isdigit }, { "graph", isgraph }, { "lower", islower }, { "print", isprint },
+        { "punct", ispunct }, { "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+        { nullptr, nullptr }
+    };
+    o_tokens.clear();
+    const size_t length = a_source.length();
+    for ( size_t idx = 0 ; idx < length ; ++idx ) {
+        const uint8_t c = static_cast<uint8_t>(a_source[idx]);
+        if ( '*' == c ) {
+            // ... consecutive stars are the same as one ...
+            if ( 0 == o_tokens.size() || TokenType::_Star != o_tokens.back().type_ ) {
+                o_tokens.push_back({ TokenType::_Star, 0, 0 });
+            }
+        } else if ( '?' == c ) {
+            o_tokens.push_back({ TokenType::_Any, 0, 0 });
+        } else if ( '\\' == c ) {
+            if ( idx + 1 == length ) {
+                return false;
+            }
+            o_tokens.push_back({ TokenType::_Char, static_cast<uint8_t>(a_source[++idx]), 0 });
+        } else if ( '[' == c ) {
+            // ... bracket expression, a '[' without a closing ']' is a literal ...
+            std::bitset<256> set;
+            size_t           it     = idx + 1;
+            const bool       negate = ( it < length && ( '!' == a_source[it] || '^' == a_source[it] ) );
+            if ( true == negate ) {
+                ++it;
+            }
+            bool closed = false;
+            for ( bool first = true ; it < length ; first = false ) {
+                uint8_t lo = static_cast<uint8_t>(a_source[it]);
+                if ( ']' == lo && false == first ) {
+                    closed = true;
+                    break;
+                }
+                if ( '[' == lo && it + 1 < length && ':' == a_source[it + 1] ) {
+                    const size_t end = a_source.find(":]", it + 2);
+                    if ( std::string::npos != end ) {
+                        const std::string name = a_source.substr(it + 2, end - it - 2);
+                        for ( size_t n = 0 ; nullptr != sk_classes[n].name_ ; ++n ) {
+                            if ( 0 == name.compare(sk_classes[n].name_) ) {
+                                for ( int ch = 0 ; ch < 256 ; ++ch ) {
+                                    if ( 0 != sk_classes[n].test_(ch) ) {
+                                        set.set(static_cast<size_t>(ch));
+                                    }
+                                }
+                                break;
+                            }
+                        }
+                        it = end + 2;
+                        continue;
+                    }
+                }
+                if ( '\\' == lo && it + 1 < length ) {
+                    lo = static_cast<uint8_t>(a_source[++it]);
+                }
+                ++it;
+                uint8_t hi = lo;
+                if ( it + 1 < length && '-' == a_source[it] && ']' != a_source[it + 1] ) {
+                    it++;
+                    if ( '\\' == a_source[it] && it + 1 < length ) {
+                        it++;
+                    }
+                    hi = static_cast<uint8_t>(a_source[it++]);
+                }
+                for ( size_t ch = lo ; ch <= hi ; ++ch ) {
+                    set.set(ch);
+                }
+            }
+            if ( false == closed ) {
+                o_tokens.push_back({ TokenType::_Char, c, 0 });
+                continue;
+            }
+            if ( true == negate ) {
+                set.flip();
+            }
+            sets_.push_back(set);
+            o_tokens.push_back({ TokenType::_Set, 0, static_cast<uint16_t>(sets_.size() - 1) });
+            idx = it;
+        } else {
+            o_tokens.push_back({ TokenType::_Char, c, 0 });
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check if a name is matched by any pattern of a group.
+ *
+ * @param a_group  Group to test.
+ * @param a_name   Name to test.
+ * @param a_length Name length.
+ */
+bool casper::inotify::Glob::Match (const Group& a_group, const char* const a_name, const size_t a_length) const
+{
+    if ( 0 != a_group.extensions_.size() ) {
+        const char* const dot = strrchr(a_name, '.');
+        if ( nullptr != dot && '\0' != dot[1] && a_group.extensions_.end() != a_group.extensions_.find(dot + 1) ) {
+            return true;
+        }
+    }
+    for ( const auto& pattern : a_group.patterns_ ) {
+        switch (pattern.kind_) {
+            case Kind::_Literal:
+                if ( a_length == pattern.prefix_.length() && 0 == memcmp(a_name, pattern.prefix_.data(), a_length) ) {
+                    return true;
+                }
+                break;
+            case Kind::_Affix:
+            case Kind::_Generic:
+                if ( a_length >= pattern.prefix_.length() + pattern.suffix_.length()
+                    && 0 == memcmp(a_name, pattern.prefix_.data(), pattern.prefix_.length())
+                    && 0 == memcmp(a_name + a_length - pattern.suffix_.length(), pattern.suffix_.data(), pattern.suffix_.length())
+                    && ( Kind::_Affix == pattern.kind_
+                        || true == Match(pattern.tokens_, a_name + pattern.prefix_.length(), a_length - pattern.prefix_.length() - pattern.suffix_.length()) ) ) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Match a name against a tokenized pattern.
+ *
+ * All tokens but '*' consume exactly one character, so when a mismatch happens only the
+ * last '*' needs to be retried ( one more character ), no recursion is needed.
+ *
+ * @param a_tokens Pattern tokens.
+ * @param a_name   Name to test.
+ * @param a_length Name length.
+ */
+bool casper::inotify::Glob::Match (const std::vector<Token>& a_tokens, const char* const a_name, const size_t a_length) const
+{
+    const size_t count = a_tokens.size();
+    size_t       t     = 0;
+    size_t       n     = 0;
+    size_t       star  = std::string::npos;
+    size_t       mark  = 0;
+    while ( n < a_length ) {
+        if ( t < count ) {
+            const Token&  token = a_tokens[t];
+            const uint8_t c     = static_cast<uint8_t>(a_name[n]);
+            if ( TokenType::_Star == token.type_ ) {
+                star = t++;
+                mark = n;
+                continue;
+            }
+            if ( ( TokenType::_Char == token.type_ && c == token.char_ ) || TokenType::_Any == token.type_
+                || ( TokenType::_Set == token.type_ && true == sets_[token.set_].test(c) ) ) {
+                ++t;
+                ++n;
+                continue;
+            }
+        }
+        if ( std::string::npos == star ) {
+            return false;
+        }
+        // ... let last '*' consume one more character ...
+        t = star + 1;
+        n = ++mark;
+    }
+    while ( t < count && TokenType::_Star == a_tokens[t].type_ ) {
+        ++t;
+    }
+    return ( t == count );
+}
@@ -0,0 +1,130 @@
+/**
+ * @file glob.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_GLOB_H_
+#define CASPER_INOTIFY_GLOB_H_
+
+#include <string>
+#include <vector>
+#include <bitset>
+#include <unordered_set>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief A set of shell wildcard patterns, parsed once and matched without re-parsing.
+         *
+         * Patterns follow fnmatch(3) rules, with no flags; a pattern starting with '!' excludes names
+         * instead. A name matches when it matches at least one including pattern ( or there are none )
+         * and no excluding pattern.
+         */
+        class Glob final
+        {
+
+        private: // Data Type(s)
+
+            enum Kind : uint8_t {
+                _Literal = 0, //!< No wildcards, compared as a string.
+                _Affix,       //!< A single '*', compared by prefix and suffix.
+                _Generic,     //!< Anything else, matched token by token.
+                _Invalid      //!< Never matches.
+            };
+
+            enum TokenType : uint8_t {
+                _Char = 0,
+                _Any,         //!< ?
+                _Star,        //!< *
+                _Set          //!< [...]
+            };
+
+            typedef struct {
+                TokenType type_;
+                uint8_t   char_;
+                uint16_t  set_;   //!< Index in \link Glob::sets_ \link.
+            } Token;
+
+            typedef struct {
+                Kind               kind_;
+                std::string        prefix_;  //!< Literal, or literal before first wildcard.
+                std::string        suffix_;  //!< Literal after last wildcard.
+                std::vector<Token> tokens_;  //!< _Generic only, what's between prefix and suffix.
+            } Pattern;
+
+            typedef struct {
+                std::unordered_set<std::string> extensions_; //!< From '*.ext' patterns, without the '.'.
+                std::vector<Pattern>            patterns_;
+            } Group;
+
+        private: // Data
+
+            std::vector<std::string>      sources_;
+            std::vector<std::bitset<256>> sets_;    //!< Bracket expressions, by byte value.
+            Group                         include_;
+            Group                         exclude_;
+
+        public: // Constructor(s) / Destructor
+
+            Glob();
+            virtual ~Glob();
+
+        public: // Method(s) // Function(s)
+
+            void Compile (const std::vector<std::string>& a_patterns);
+            bool Match   (const char* const a_name) const;
+            bool Anchors (std::vector<std::string>& o_anchors) const;
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True when there are no patterns, everything matches.
+             */
+            inline bool empty () const
+            {
+                return 0 == sources_.size();
+            }
+
+            /**
+             * @return Original patterns.
+             */
+            inline const std::vector<std::string>& sources () const
+            {
+                return sources_;
+            }
+
+        private: // Method(s) // Function(s)
+
+            bool Parse (const std::string& a_source, std::vector<Token>& o_tokens);
+            bool Match (const Group& a_group, const char* const a_name, const size_t a_length) const;
+            bool Match (const std::vector<Token>& a_tokens, const char* const a_name, const size_t a_length) const;
+
+        }; // end of class 'Glob'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_GLOB_H_
@@ -0,0 +1,190 @@
+/**
+ * @file index.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "index.h"
+
+#include <string.h> // memset
+
+#include <deque>
+#include <algorithm> // std::sort
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Index::Index ()
+{
+    Clear();
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Index::~Index ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Forget all globs.
+ */
+void casper::inotify::Index::Clear ()
+{
+    globs_.clear();
+    always_.clear();
+    dirty_   = true;
+    memset(class_, 0, sizeof(class_));
+    classes_ = 1;
+    next_.clear();
+    dict_.clear();
+    outputs_.clear();
+    seen_.clear();
+    pass_    = 0;
+}
+
+/**
+ * @brief Add a glob, it's id is the number of globs added before it.
+ *
+ * @param a_glob Glob to add, must outlive this index ( or until \link Index::Clear \link ).
+ */
+void casper::inotify::Index::Add (const Glob& a_glob)
+{
+    globs_.push_back(&a_glob);
+    dirty_ = true;
+}
+
+/**
+ * @brief Find all globs that match a name.
+ *
+ * @param a_name    Name to test.
+ * @param o_matches Ids of matching globs, in ascending order.
+ */
+void casper::inotify::Index::Match (const char* const a_name, std::vector<size_t>& o_matches)
+{
+    if ( true == dirty_ ) {
+        Build();
+    }
+    o_matches.clear();
+    // ... wrapped around?
+    if ( 0 == ++pass_ ) {
+        std::fill(seen_.begin(), seen_.end(), 0);
+        pass_ = 1;
+    }
+    // ... candidates: globs whose literals are found ...
+    int32_t state = 0;
+    for ( const uint8_t* it = reinterpret_cast<const uint8_t*>(a_name) ; '\0' != *it ; ++it ) {
+        state = next_[static_cast<size_t>(state) * classes_ + class_[*it]];
+        for ( int32_t output = ( 0 != outputs_[state].size() ? state : dict_[state] ) ; output > 0 ; output = dict_[output] ) {
+            for ( const uint32_t id : outputs_[output] ) {
+                if ( pass_ != seen_[id] ) {
+                    seen_[id] = pass_;
+                    o_matches.push_back(id);
+                }
+            }
+        }
+    }
+    // ... and those without literals ...
+    o_matches.insert(o_matches.end(), always_.begin(), always_.end());
+    // ... confirm ...
+    size_t count = 0;
+    for ( const size_t id : o_matches ) {
+        if ( true == globs_[id]->Match(a_name) ) {
+            o_matches[count++] = id;
+        }
+    }
+    o_matches.resize(count);
+    std::sort(o_matches.begin(), o_matches.end());
+}
+
+// MARK: -
+
+/**
+ * @brief Build automaton, over an alphabet reduced to the bytes that literals use.
+ */
+void casper::inotify::Index::Build ()
+{
+    always_.clear();
+    memset(class_, 0, sizeof(class_));
+    classes_ = 1;
+    // ... collect literals ...
+    std::vector<std::pair<std::string, uint32_t>> literals;
+    std::vector<std::string>                      anchors;
+    for ( uint32_t id = 0 ; id < static_cast<uint32_t>(globs_.size()) ; ++id ) {
+        if ( false == globs_[id]->Anchors(anchors) ) {
+            always_.push_back(id);
+            continue;
+        }
+        for ( auto& anchor : anchors ) {
+            for ( const char c : anchor ) {
+                if ( 0 == class_[static_cast<uint8_t>(c)] ) {
+                    class_[static_cast<uint8_t>(c)] = static_cast<uint8_t>(classes_++);
+                }
+            }
+            literals.push_back(std::make_pair(std::move(anchor), id));
+        }
+    }
+    // ... trie ...
+    next_.assign(classes_, -1);
+    outputs_.assign(1, std::vector<uint32_t>());
+    for ( const auto& literal : literals ) {
+        size_t state = 0;
+        for ( const char c : literal.first ) {
+            int32_t& next = next_[state * classes_ + class_[static_cast<uint8_t>(c)]];
+            if ( -1 == next ) {
+                next = static_cast<int32_t>(outputs_.size());
+                outputs_.push_back(std::vector<uint32_t>());
+                next_.resize(next_.size() + classes_, -1);
+            }
+            state = static_cast<size_t>(next_[state * classes_ + class_[static_cast<uint8_t>(c)]]);
+        }
+        outputs_[state].push_back(literal.second);
+    }
+    // ... failure links, breadth first, turned into a complete transition table ...
+    std::vector<int32_t> fail(outputs_.size(), 0);
+    std::deque<int32_t>  queue;
+    dict_.assign(outputs_.size(), -1);
+    for ( size_t c = 0 ; c < classes_ ; ++c ) {
+        int32_t& next = next_[c];
+        if ( -1 == next ) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+    while ( false == queue.empty() ) {
+        const int32_t state = queue.front();
+        queue.pop_front();
+        for ( size_t c = 0 ; c < classes_ ; ++c ) {
+            int32_t& next = next_[static_cast<size_t>(state) * classes_ + c];
+            const int32_t fallback = next_[static_cast<size_t>(fail[state]) * classes_ + c];
+            if ( -1 == next ) {
+                next = fallback;
+                continue;
+            }
+            fail[next]  = fallback;
+            dict_[next] = ( 0 != outputs_[fallback].size() ? fallback : dict_[fallback] );
+            queue.push_back(next);
+        }
+    }
+    // ...
+    seen_.assign(globs_.size(), 0);
+    pass_  = 0;
+    dirty_ = false;
+}
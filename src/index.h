@@ -0,0 +1,92 @@
+/**
+ * @file index.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_INDEX_H_
+#define CASPER_INOTIFY_INDEX_H_
+
+#include "glob.h"
+
+#include <string>
+#include <vector>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint8_t, uint32_t, int32_t
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Find all \link Glob \link that match a name, in a single pass over it.
+         *
+         * Literals that matching names must contain ( see \link Glob::Anchors \link ) are searched
+         * for with an Aho-Corasick automaton, only globs whose literals were found, or that have none,
+         * are then matched.
+         */
+        class Index final
+        {
+
+        private: // Data
+
+            std::vector<const Glob*> globs_;
+            std::vector<uint32_t>    always_;   //!< Globs without literals, always matched.
+            bool                     dirty_;    //!< True when automaton must be rebuilt.
+            uint8_t                  class_[256]; //!< Byte to alphabet class, 0 for bytes not in any literal.
+            size_t                   classes_;
+            std::vector<int32_t>     next_;     //!< Transitions, by state and class.
+            std::vector<int32_t>     dict_;     //!< Next state, through failure links, with outputs; -1 if none.
+            std::vector<std::vector<uint32_t>> outputs_; //!< Globs whose literal ends at each state.
+            std::vector<uint32_t>    seen_;     //!< Last pass each glob was found in.
+            uint32_t                 pass_;
+
+        public: // Constructor(s) / Destructor
+
+            Index();
+            virtual ~Index();
+
+        public: // Method(s) // Function(s)
+
+            void Clear ();
+            void Add   (const Glob& a_glob);
+            void Match (const char* const a_name, std::vector<size_t>& o_matches);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return Number of globs.
+             */
+            inline size_t size () const
+            {
+                return globs_.size();
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Build ();
+
+        }; // end of class 'Index'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_INDEX_H_
@@ -0,0 +1,530 @@
+/**
+ * @file journal.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "journal.h"
+
+#include <algorithm> // std::sort
+
+#include "exception.h"
+
+#include <string.h> // strerror, strlen, memset, memcpy
+#include <errno.h>
+#include <stdio.h>  // snprintf
+#include <stdlib.h> // strtoull
+#include <time.h>   // clock_gettime
+#include <unistd.h> // close, unlink
+#include <fcntl.h>  // open, posix_fallocate
+#include <dirent.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h> // IN_ISDIR
+
+#define JOURNAL_FILE_SUFFIX ".journal"
+#define JOURNAL_RETRY_MS    1000 // how long to wait before trying to start a segment again, after a failure
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Journal::Journal ()
+{
+    segment_size_ = JOURNAL_DEFAULT_SEGMENT_SIZE;
+    segments_     = JOURNAL_DEFAULT_SEGMENTS;
+    interval_ms_  = JOURNAL_DEFAULT_SYNC_INTERVAL_MS;
+    current_      = { -1, nullptr, 0, 0, 0 };
+    sequence_     = 1;
+    retry_        = std::chrono::steady_clock::time_point();
+    stop_         = true;
+    thread_       = nullptr;
+    records_      = 0;
+    bytes_        = 0;
+    failures_     = 0;
+    rotations_    = 0;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Journal::~Journal ()
+{
+    Close();
+}
+
+/**
+ * @brief Start appending, after the last record found in a directory.
+ *
+ * @param a_directory    Where segments are kept, created if it does not exist.
+ * @param a_segment_size Segment size, in bytes.
+ * @param a_segments     Number of segments to keep, the oldest are removed.
+ * @param a_interval_ms  How often appended records are flushed to disk.
+ */
+void casper::inotify::Journal::Open (const std::string& a_directory, const size_t a_segment_size, const size_t a_segments, const size_t a_interval_ms)
+{
+    Close();
+    if ( 0 != mkdir(a_directory.c_str(), S_IRWXU | S_IRGRP | S_IXGRP) && EEXIST != errno ) {
+        throw inotify::Exception("An error occurred while creating journal directory '%s': %d - %s", a_directory.c_str(), errno, strerror(errno));
+    }
+    std::vector<std::string> files;
+    List(a_directory, files);
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_    = a_directory;
+    segment_size_ = a_segment_size;
+    segments_     = a_segments;
+    interval_ms_  = a_interval_ms;
+    sequence_     = 1;
+    retry_        = std::chrono::steady_clock::time_point();
+    stop_         = false;
+    files_.assign(files.begin(), files.end());
+    // ... continue last segment, or start one; in place of the last one if it's unreadable ...
+    if ( 0 == files_.size() || false == Recover(files_.back()) ) {
+        if ( 0 != files_.size() ) {
+            const std::string& last = files_.back();
+            sequence_ = std::max<uint64_t>(1, strtoull(last.c_str() + last.rfind('/') + 1, nullptr, 16));
+        }
+        if ( false == Rotate() ) {
+            const int no = errno;
+            files_.clear();
+            throw inotify::Exception("An error occurred while starting a journal segment in '%s': %d - %s", a_directory.c_str(), no, strerror(no));
+        }
+    }
+    thread_ = new std::thread(&casper::inotify::Journal::Loop, this);
+}
+
+/**
+ * @brief Flush all records to disk and stop appending.
+ */
+void casper::inotify::Journal::Close ()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if ( nullptr != thread_ ) {
+        thread_->join();
+        delete thread_;
+        thread_ = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for ( auto& segment : retired_ ) {
+        Sync(segment, segment.offset_);
+        Unmap(segment);
+    }
+    retired_.clear();
+    if ( nullptr != current_.data_ ) {
+        Sync(current_, current_.offset_);
+        Unmap(current_);
+    }
+    files_.clear();
+    directory_ = "";
+}
+
+/**
+ * @brief Append an event.
+ *
+ * @param a_event    Event to append.
+ * @param a_entry_id Hash of the configuration of the entry it was dispatched by, see \link Journal::Hash \link.
+ *
+ * @return False when it could not be appended.
+ */
+bool casper::inotify::Journal::Append (const Stream::Event& a_event, const uint64_t a_entry_id)
+{
+    const char* const parent   = ( nullptr != a_event.parent_ ? a_event.parent_ : "" );
+    const char* const old_name = ( nullptr != a_event.old_name_ ? a_event.old_name_ : "" );
+    struct timespec now;
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp_       = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    record.entry_id_        = a_entry_id;
+    record.mask_            = a_event.mask_;
+    record.flags_           = ( true == a_event.inside_ ? STREAM_FLAG_INSIDE : 0 ) | ( 0 != ( a_event.mask_ & IN_ISDIR ) ? STREAM_FLAG_DIRECTORY : 0 );
+    record.entry_length_    = static_cast<uint16_t>(strnlen(a_event.entry_, UINT16_MAX));
+    record.parent_length_   = static_cast<uint16_t>(strnlen(parent, UINT16_MAX));
+    record.name_length_     = static_cast<uint16_t>(strnlen(a_event.name_, UINT16_MAX));
+    record.old_name_length_ = static_cast<uint16_t>(strnlen(old_name, UINT16_MAX));
+    const uint32_t length   = static_cast<uint32_t>(sizeof(record) + record.entry_length_ + record.parent_length_ + record.name_length_ + record.old_name_length_);
+    const size_t   padded   = ( static_cast<size_t>(length) + 7 ) & ~static_cast<size_t>(7);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( true == stop_ ) {
+        return false;
+    }
+    // ... full? start another segment, but not too often if it's failing ...
+    if ( nullptr == current_.data_ || current_.offset_ + padded > current_.size_ ) {
+        if ( std::chrono::steady_clock::now() < retry_ || padded > segment_size_ - sizeof(JournalSegment) || false == Rotate() ) {
+            if ( nullptr == current_.data_ ) {
+                retry_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(JOURNAL_RETRY_MS);
+            }
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    record.sequence_ = sequence_;
+    uint8_t* const start = current_.data_ + current_.offset_;
+    uint8_t*       it    = start;
+    memcpy(it, &record, sizeof(record));
+    it += sizeof(record);
+    memcpy(it, a_event.entry_, record.entry_length_);
+    it += record.entry_length_;
+    memcpy(it, parent, record.parent_length_);
+    it += record.parent_length_;
+    memcpy(it, a_event.name_, record.name_length_);
+    it += record.name_length_;
+    memcpy(it, old_name, record.old_name_length_);
+    // ... checksum, then length: a record is not there until it's length is ...
+    const uint32_t crc = CRC(start + offsetof(JournalRecord, sequence_), length - offsetof(JournalRecord, sequence_));
+    memcpy(start + offsetof(JournalRecord, crc_), &crc, sizeof(crc));
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(start + offsetof(JournalRecord, length_), &length, sizeof(length));
+    current_.offset_ += padded;
+    sequence_++;
+    records_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(padded, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Read records from a directory's segments.
+ *
+ * @param a_directory Where segments are kept.
+ * @param a_sequence  First sequence to read.
+ * @param a_timestamp Records older than this, in nanoseconds since epoch, are skipped.
+ * @param a_callback  Called for each record, in order.
+ *
+ * @return Number of records read.
+ */
+uint64_t casper::inotify::Journal::Read (const std::string& a_directory, const uint64_t a_sequence, const uint64_t a_timestamp,
+                                         const casper::inotify::Journal::Callback& a_callback)
+{
+    std::vector<std::string> files;
+    List(a_directory, files);
+    uint64_t count = 0;
+    for ( size_t idx = 0 ; idx < files.size() ; ++idx ) {
+        // ... named after their first sequence, skip segments that end before the one we want ...
+        if ( idx + 1 < files.size() ) {
+            const std::string& next  = files[idx + 1];
+            const uint64_t     first = strtoull(next.c_str() + next.rfind('/') + 1, nullptr, 16);
+            if ( first <= a_sequence ) {
+                continue;
+            }
+        }
+        Segment segment;
+        if ( false == Map(files[idx], /* a_writable */ false, segment) ) {
+            continue;
+        }
+        (void)Scan(segment, sizeof(JournalSegment), [&] (const Journal::View& a_view) {
+            if ( a_view.header_->sequence_ >= a_sequence && a_view.header_->timestamp_ >= a_timestamp ) {
+                a_callback(a_view);
+                count++;
+            }
+        });
+        Unmap(segment);
+    }
+    return count;
+}
+
+/**
+ * @return 64 bit FNV-1a hash of a value.
+ *
+ * @param a_value Value to hash.
+ */
+uint64_t casper::inotify::Journal::Hash (const std::string& a_value)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for ( const char c : a_value ) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * @return CRC-32C ( Castagnoli ) of a buffer.
+ *
+ * @param a_data   Buffer.
+ * @param a_length Buffer length.
+ */
+uint32_t casper::inotify::Journal::CRC (const void* a_data, const size_t a_length)
+{
+    static const struct Table {
+        uint32_t values_[256];
+        Table () {
+            for ( uint32_t idx = 0 ; idx < 256 ; ++idx ) {
+                uint32_t value = idx;
+                for ( int bit = 0 ; bit < 8 ; ++bit ) {
+                    value = ( value >> 1 ) ^ ( 0x82f63b78u & ( 0u - ( value & 1u ) ) );
+                }
+                values_[idx] = value;
+            }
+        }
+    } table;
+    const uint8_t* it  = static_cast<const uint8_t*>(a_data);
+    uint32_t       crc = 0xffffffffu;
+    for ( size_t idx = 0 ; idx < a_length ; ++idx ) {
+        crc = table.values_[( crc ^ it[idx] ) & 0xff] ^ ( crc >> 8 );
+    }
+    return crc ^ 0xffffffffu;
+}
+
+// MARK: -
+
+/**
+ * @brief Flusher thread: sync appended records, release full segments and remove the oldest ones.
+ */
+void casper::inotify::Journal::Loop ()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( false == stop_ ) {
+        cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_));
+        // ... collect work, do it unlocked ...
+        std::vector<Journal::Segment> retired;
+        retired.swap(retired_);
+        Journal::Segment current = current_;
+        std::vector<std::string> expired;
+        while ( files_.size() > segments_ ) {
+            expired.push_back(files_.front());
+            files_.pop_front();
+        }
+        lock.unlock();
+        // ... full segments are only unmapped here, current one can't go away while it's being synced ...
+        for ( auto& segment : retired ) {
+            Sync(segment, segment.offset_);
+            Unmap(segment);
+        }
+        if ( nullptr != current.data_ && current.offset_ > current.synced_ ) {
+            Sync(current, current.offset_);
+        }
+        for ( const auto& file : expired ) {
+            (void)unlink(file.c_str());
+        }
+        lock.lock();
+        if ( current_.data_ == current.data_ && nullptr != current.data_ ) {
+            current_.synced_ = std::max(current_.synced_, current.synced_);
+        }
+    }
+}
+
+/**
+ * @brief Start a segment, handing current one to flusher; must be called while locked.
+ *
+ * @return False on failure, errno is set.
+ */
+bool casper::inotify::Journal::Rotate ()
+{
+    if ( nullptr != current_.data_ ) {
+        retired_.push_back(current_);
+        current_ = { -1, nullptr, 0, 0, 0 };
+        cv_.notify_one();
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx" JOURNAL_FILE_SUFFIX, static_cast<unsigned long long>(sequence_));
+    const std::string file = directory_ + '/' + name;
+    const int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP);
+    if ( fd < 0 ) {
+        return false;
+    }
+    // ... blocks are allocated now, a full disk must not be found by writing to the mapping ( SIGBUS ) ...
+    const int rv = posix_fallocate(fd, 0, static_cast<off_t>(segment_size_));
+    void*     data = MAP_FAILED;
+    if ( 0 != rv || MAP_FAILED == ( data = mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) ) ) {
+        const int no = ( 0 != rv ? rv : errno );
+        close(fd);
+        (void)unlink(file.c_str());
+        errno = no;
+        return false;
+    }
+    JournalSegment header;
+    memset(&header, 0, sizeof(header));
+    struct timespec now;
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    header.magic_   = JOURNAL_MAGIC;
+    header.version_ = JOURNAL_VERSION;
+    header.size_    = segment_size_;
+    header.first_   = sequence_;
+    header.created_ = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    memcpy(data, &header, sizeof(header));
+    current_ = { fd, static_cast<uint8_t*>(data), segment_size_, 0, sizeof(header) };
+    if ( 0 == files_.size() || files_.back() != file ) {
+        files_.push_back(file);
+    }
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Continue appending to a segment, after it's last good record; must be called while locked.
+ *
+ * @param a_file Segment file.
+ *
+ * @return False if it can't be used.
+ */
+bool casper::inotify::Journal::Recover (const std::string& a_file)
+{
+    Journal::Segment segment;
+    if ( false == Map(a_file, /* a_writable */ true, segment) ) {
+        return false;
+    }
+    const JournalSegment* header = reinterpret_cast<const JournalSegment*>(segment.data_);
+    uint64_t              last   = 0;
+    const size_t          end    = Scan(segment, sizeof(JournalSegment), [&last] (const Journal::View& a_view) {
+        last = a_view.header_->sequence_;
+    });
+    sequence_ = ( 0 != last ? last + 1 : header->first_ );
+    // ... a torn record? clear what follows the last good one, appends must not run into it's leftovers ...
+    uint32_t length = 0;
+    if ( end + sizeof(length) <= segment.size_ ) {
+        memcpy(&length, segment.data_ + end, sizeof(length));
+    }
+    if ( 0 != length ) {
+        memset(segment.data_ + end, 0, segment.size_ - end);
+    }
+    segment.offset_ = end;
+    segment.synced_ = end;
+    current_        = segment;
+    return true;
+}
+
+/**
+ * @brief Flush a segment's records to disk.
+ *
+ * @param a_segment Segment.
+ * @param a_offset  Flush up to this offset.
+ */
+void casper::inotify::Journal::Sync (casper::inotify::Journal::Segment& a_segment, const size_t a_offset)
+{
+    static const size_t sk_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if ( a_offset <= a_segment.synced_ ) {
+        return;
+    }
+    const size_t from = a_segment.synced_ & ~( sk_page_size - 1 );
+    if ( 0 == msync(a_segment.data_ + from, a_offset - from, MS_SYNC) ) {
+        a_segment.synced_ = a_offset;
+    }
+}
+
+/**
+ * @brief Release a segment's mapping and file descriptor.
+ *
+ * @param a_segment Segment.
+ */
+void casper::inotify::Journal::Unmap (casper::inotify::Journal::Segment& a_segment)
+{
+    if ( nullptr != a_segment.data_ ) {
+        munmap(a_segment.data_, a_segment.size_);
+    }
+    if ( -1 != a_segment.fd_ ) {
+        close(a_segment.fd_);
+    }
+    a_segment = { -1, nullptr, 0, 0, 0 };
+}
+
+/**
+ * @brief Map a segment file, checking it's header.
+ *
+ * @param a_file     Segment file.
+ * @param a_writable True to map it for appending.
+ * @param o_segment  Mapped segment.
+ *
+ * @return False if it could not be mapped or is not a segment.
+ */
+bool casper::inotify::Journal::Map (const std::string& a_file, const bool a_writable, casper::inotify::Journal::Segment& o_segment)
+{
+    o_segment = { -1, nullptr, 0, 0, 0 };
+    const int fd = open(a_file.c_str(), ( true == a_writable ? O_RDWR : O_RDONLY ) | O_CLOEXEC);
+    struct stat st;
+    if ( fd < 0 ) {
+        return false;
+    }
+    if ( 0 != fstat(fd, &st) || static_cast<size_t>(st.st_size) < sizeof(JournalSegment) ) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | ( true == a_writable ? PROT_WRITE : 0 ), MAP_SHARED, fd, 0);
+    if ( MAP_FAILED == data ) {
+        close(fd);
+        return false;
+    }
+    o_segment = { fd, static_cast<uint8_t*>(data), static_cast<size_t>(st.st_size), 0, 0 };
+    const JournalSegment* header = static_cast<const JournalSegment*>(data);
+    if ( JOURNAL_MAGIC != header->magic_ || JOURNAL_VERSION != header->version_ || header->size_ != o_segment.size_ ) {
+        Unmap(o_segment);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Visit a segment's good records.
+ *
+ * @param a_segment  Mapped segment.
+ * @param a_from     Offset of first record.
+ * @param a_callback Called for each record.
+ *
+ * @return Offset after the last good record.
+ */
+size_t casper::inotify::Journal::Scan (const casper::inotify::Journal::Segment& a_segment, const size_t a_from, const casper::inotify::Journal::Callback& a_callback)
+{
+    size_t offset = a_from;
+    while ( offset + sizeof(JournalRecord) <= a_segment.size_ ) {
+        const JournalRecord* record = reinterpret_cast<const JournalRecord*>(a_segment.data_ + offset);
+        const size_t         length = record->length_;
+        if ( length < sizeof(JournalRecord) || offset + length > a_segment.size_
+            || length != sizeof(JournalRecord) + record->entry_length_ + record->parent_length_ + record->name_length_ + record->old_name_length_
+            || record->crc_ != CRC(a_segment.data_ + offset + offsetof(JournalRecord, sequence_), length - offsetof(JournalRecord, sequence_)) ) {
+            break;
+        }
+        Journal::View view;
+        view.header_   = record;
+        view.entry_    = reinterpret_cast<const char*>(record + 1);
+        view.parent_   = view.entry_ + record->entry_length_;
+        view.name_     = view.parent_ + record->parent_length_;
+        view.old_name_ = view.name_ + record->name_length_;
+        a_callback(view);
+        offset += ( length + 7 ) & ~static_cast<size_t>(7);
+    }
+    return offset;
+}
+
+/**
+ * @brief List a directory's segment files, oldest first.
+ *
+ * @param a_directory Where segments are kept.
+ * @param o_files     Segment files paths.
+ */
+void casper::inotify::Journal::List (const std::string& a_directory, std::vector<std::string>& o_files)
+{
+    o_files.clear();
+    DIR* dir = opendir(a_directory.c_str());
+    if ( nullptr == dir ) {
+        return;
+    }
+    const size_t suffix = strlen(JOURNAL_FILE_SUFFIX);
+    struct dirent* entry;
+    while ( nullptr != ( entry = readdir(dir) ) ) {
+        const size_t length = strlen(entry->d_name);
+        if ( 16 + suffix == length && 0 == strcmp(entry->d_name + 16, JOURNAL_FILE_SUFFIX) ) {
+            o_files.push_back(a_directory + '/' + entry->d_name);
+        }
+    }
+    closedir(dir);
+    // ... fixed width hexadecimal names sort as their sequences do ...
+    std::sort(o_files.begin(), o_files.end());
+}
@@ -0,0 +1,222 @@
+/**
+ * @file journal.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_JOURNAL_H_
+#define CASPER_INOTIFY_JOURNAL_H_
+
+#include "stream.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint16_t, uint32_t, uint64_t
+
+#define JOURNAL_MAGIC                    0x4c4e524a // "JRNL"
+#define JOURNAL_VERSION                  1
+#define JOURNAL_DEFAULT_SEGMENT_SIZE     ( 64 * 1024 * 1024 )
+#define JOURNAL_DEFAULT_SEGMENTS         8
+#define JOURNAL_DEFAULT_SYNC_INTERVAL_MS 1000
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Segment file header, records follow it.
+         */
+        typedef struct {
+            uint32_t magic_;      //!< JOURNAL_MAGIC.
+            uint32_t version_;    //!< JOURNAL_VERSION.
+            uint64_t size_;       //!< Segment file size.
+            uint64_t first_;      //!< Sequence of first record.
+            uint64_t created_;    //!< Nanoseconds since epoch.
+            uint8_t  reserved_[32];
+        } JournalSegment;
+
+        /**
+         * @brief Record header, in host byte order; it's followed by the entry URI, parent, name and old name,
+         *        in this order and not NUL terminated, and padded to 8 bytes.
+         *
+         * A segment's records end at the first record whose length is 0 or doesn't check.
+         */
+        typedef struct {
+            uint32_t length_;          //!< Header and strings, padding excluded; written last.
+            uint32_t crc_;             //!< CRC-32C of everything that follows it, strings included.
+            uint64_t sequence_;        //!< Grows by one per record, across segments and restarts.
+            uint64_t timestamp_;       //!< Nanoseconds since epoch.
+            uint64_t entry_id_;        //!< Hash of the configuration of the entry that dispatched it.
+            uint32_t mask_;            //!< inotify(7) event mask.
+            uint16_t flags_;           //!< STREAM_FLAG_*.
+            uint16_t reserved_;
+            uint16_t entry_length_;    //!< Configured entry URI.
+            uint16_t parent_length_;   //!< Directory object is in, 0 when event is for the watched object itself.
+            uint16_t name_length_;     //!< Object name, or path for the watched object itself.
+            uint16_t old_name_length_; //!< Full path before a rename, 0 if none.
+        } JournalRecord;
+
+        /**
+         * @brief Append-only log of dispatched events, in memory mapped segment files, so they can be dispatched
+         *        again after a failure or a restart.
+         *
+         * Appending is a copy into the current segment's mapping; segments are preallocated, flushed to disk by
+         * a background thread every sync interval, and the oldest ones are removed once there are too many.
+         */
+        class Journal final
+        {
+
+        public: // Data Type(s)
+
+            typedef struct {
+                const JournalRecord* header_;
+                const char*          entry_;    //!< Not NUL terminated.
+                const char*          parent_;
+                const char*          name_;
+                const char*          old_name_;
+            } View;
+
+            typedef std::function<void(const View&)> Callback;
+
+        private: // Data Type(s)
+
+            typedef struct {
+                int      fd_;
+                uint8_t* data_;    //!< Mapped segment.
+                size_t   size_;
+                size_t   synced_;  //!< Offset up to which it's known to be on disk.
+                size_t   offset_;  //!< Where next record goes.
+            } Segment;
+
+        private: // Data
+
+            std::mutex                         mutex_;        //!< Protects everything but counters, appenders are shards threads.
+            std::string                        directory_;
+            size_t                             segment_size_;
+            size_t                             segments_;     //!< Number of segments to keep.
+            size_t                             interval_ms_;  //!< Sync interval.
+            Segment                            current_;      //!< data_ is nullptr when closed or after a failed rotation.
+            std::vector<Segment>               retired_;      //!< Full segments, to be synced and unmapped by flusher.
+            std::deque<std::string>            files_;        //!< Segments on disk, oldest first.
+            uint64_t                           sequence_;     //!< Next record's.
+            std::chrono::steady_clock::time_point retry_;     //!< When to try to start a segment again, after a failure.
+            std::condition_variable            cv_;
+            bool                               stop_;
+            std::thread*                       thread_;
+            std::atomic<uint64_t>              records_;
+            std::atomic<uint64_t>              bytes_;
+            std::atomic<uint64_t>              failures_;
+            std::atomic<uint64_t>              rotations_;
+
+        public: // Constructor(s) / Destructor
+
+            Journal (const Journal&) = delete;
+            Journal (const Journal&&) = delete;
+            Journal();
+            virtual ~Journal();
+
+        public: // Method(s) // Function(s)
+
+            void Open   (const std::string& a_directory, const size_t a_segment_size, const size_t a_segments, const size_t a_interval_ms);
+            void Close  ();
+            bool Append (const Stream::Event& a_event, const uint64_t a_entry_id);
+
+            static uint64_t Read (const std::string& a_directory, const uint64_t a_sequence, const uint64_t a_timestamp, const Callback& a_callback);
+            static uint64_t Hash (const std::string& a_value);
+            static uint32_t CRC  (const void* a_data, const size_t a_length);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True when appending.
+             */
+            inline bool IsOpen () const
+            {
+                return nullptr != thread_;
+            }
+
+            /**
+             * @return True when appending with these settings.
+             */
+            inline bool Matches (const std::string& a_directory, const size_t a_segment_size, const size_t a_segments, const size_t a_interval_ms) const
+            {
+                return IsOpen() && directory_ == a_directory && segment_size_ == a_segment_size && segments_ == a_segments && interval_ms_ == a_interval_ms;
+            }
+
+            /**
+             * @return Number of records appended.
+             */
+            inline uint64_t records () const
+            {
+                return records_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of bytes appended, padding included.
+             */
+            inline uint64_t bytes () const
+            {
+                return bytes_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of events that could not be appended.
+             */
+            inline uint64_t failures () const
+            {
+                return failures_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of segments started.
+             */
+            inline uint64_t rotations () const
+            {
+                return rotations_.load(std::memory_order_relaxed);
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Loop    ();
+            bool Rotate  ();
+            bool Recover (const std::string& a_file);
+
+            static void   Sync    (Segment& a_segment, const size_t a_offset);
+            static void   Unmap   (Segment& a_segment);
+
+            static bool   Map     (const std::string& a_file, const bool a_writable, Segment& o_segment);
+            static size_t Scan    (const Segment& a_segment, const size_t a_from, const Callback& a_callback);
+            static void   List    (const std::string& a_directory, std::vector<std::string>& o_files);
+
+        }; // end of class 'Journal'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_JOURNAL_H_
@@ -0,0 +1,334 @@
+/**
+ * @file logger.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logger.h"
+
+#include <string.h> // memcpy
+#include <stdlib.h> // malloc, free
+#include <stdio.h>  // snprintf
+#include <errno.h>
+#include <limits.h> // IOV_MAX
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/uio.h>     // writev
+#include <sys/eventfd.h>
+
+#include <stdexcept>
+
+/**
+ * @brief Default constructor.
+ *
+ * @param a_capacity Maximum number of lines waiting to be written, rounded up to a power of 2.
+ */
+casper::inotify::Logger::Logger (const size_t a_capacity)
+{
+    size_t capacity = 2;
+    while ( capacity < a_capacity ) {
+        capacity <<= 1;
+    }
+    slots_.reset(new Slot[capacity]);
+    for ( size_t idx = 0 ; idx < capacity ; ++idx ) {
+        slots_[idx].sequence_.store(idx, std::memory_order_relaxed);
+        slots_[idx].length_ = 0;
+        slots_[idx].heap_   = nullptr;
+    }
+    mask_        = capacity - 1;
+    enqueue_pos_ = 0;
+    dequeue_pos_ = 0;
+    dropped_     = 0;
+    sleeping_    = false;
+    stop_        = false;
+    flushing_    = 0;
+    interval_ms_ = 0;
+    wake_fd_     = -1;
+    fd_          = -1;
+    written_pos_ = 0;
+    thread_      = nullptr;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Logger::~Logger ()
+{
+    Close();
+}
+
+/**
+ * @brief Set ( or replace ) output, pending lines are written to previous output first.
+ *
+ * @param a_fd File descriptor to write to, ownership is transferred to this instance.
+ */
+void casper::inotify::Logger::Open (const int a_fd)
+{
+    if ( nullptr == thread_ ) {
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( -1 == wake_fd_ ) {
+            throw std::runtime_error("unable to create logger eventfd");
+        }
+        fd_     = a_fd;
+        stop_   = false;
+        thread_ = new std::thread(&Logger::Loop, this);
+        return;
+    }
+    // ... write what's pending to previous output ...
+    Flush();
+    // ... swap ...
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if ( -1 != fd_ ) {
+        close(fd_);
+    }
+    fd_ = a_fd;
+}
+
+/**
+ * @brief Write all pending lines, stop writer thread and close output.
+ */
+void casper::inotify::Logger::Close ()
+{
+    if ( nullptr == thread_ ) {
+        return;
+    }
+    stop_ = true;
+    Wake();
+    thread_->join();
+    delete thread_;
+    thread_ = nullptr;
+    // ...
+    close(wake_fd_);
+    wake_fd_ = -1;
+    if ( -1 != fd_ ) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+/**
+ * @brief Enqueue a line, lock-free.
+ *
+ * @param a_data   Line data, including new line.
+ * @param a_length Line data length.
+ *
+ * @return False if the ring was full and the line was dropped.
+ */
+bool casper::inotify::Logger::Write (const char* const a_data, const size_t a_length)
+{
+    Slot*  slot;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while ( true ) {
+        slot = &slots_[pos & mask_];
+        const size_t   sequence = slot->sequence_.load(std::memory_order_acquire);
+        const intptr_t diff     = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if ( 0 == diff ) {
+            if ( true == enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) ) {
+                break;
+            }
+        } else if ( diff < 0 ) {
+            // ... full ...
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    // ... copy ...
+    if ( a_length <= sizeof(slot->data_) ) {
+        memcpy(slot->data_, a_data, a_length);
+        slot->heap_ = nullptr;
+    } else {
+        slot->heap_ = static_cast<char*>(malloc(a_length));
+        if ( nullptr != slot->heap_ ) {
+            memcpy(slot->heap_, a_data, a_length);
+        }
+    }
+    slot->length_ = ( a_length <= sizeof(slot->data_) || nullptr != slot->heap_ ) ? a_length : 0;
+    // ... publish ...
+    slot->sequence_.store(pos + 1, std::memory_order_seq_cst);
+    // ... writer waiting for lines?
+    if ( true == sleeping_.load(std::memory_order_seq_cst) && true == sleeping_.exchange(false) ) {
+        Wake();
+    }
+    return true;
+}
+
+/**
+ * @brief Block until all lines enqueued before this call are written.
+ */
+void casper::inotify::Logger::Flush ()
+{
+    if ( nullptr == thread_ ) {
+        return;
+    }
+    const size_t target = enqueue_pos_.load(std::memory_order_acquire);
+    flushing_++;
+    Wake();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, target] {
+            return written_pos_ >= target || true == stop_;
+        });
+    }
+    flushing_--;
+}
+
+/**
+ * @brief Set for how long lines are accumulated before being written.
+ *
+ * @param a_ms Interval in milliseconds, 0 to write as soon as possible.
+ */
+void casper::inotify::Logger::SetFlushInterval (const uint32_t a_ms)
+{
+    interval_ms_ = a_ms;
+}
+
+// MARK: -
+
+/**
+ * @brief Writer thread loop.
+ */
+void casper::inotify::Logger::Loop ()
+{
+    struct pollfd pfd;
+    pfd.fd     = wake_fd_;
+    pfd.events = POLLIN;
+    while ( true ) {
+        // ... write everything that's ready ...
+        while ( true == Drain() ) {
+            /* next batch */
+        }
+        if ( true == stop_ ) {
+            break;
+        }
+        // ... announce we're about to sleep, then re-check so that no wake up is lost ...
+        sleeping_.store(true, std::memory_order_seq_cst);
+        const Slot& next = slots_[dequeue_pos_ & mask_];
+        if ( next.sequence_.load(std::memory_order_seq_cst) == dequeue_pos_ + 1 || 0 != flushing_ ) {
+            sleeping_.store(false);
+        } else {
+            // ... nothing to do, block ( no timeout ) ...
+            while ( -1 == poll(&pfd, 1, -1) && EINTR == errno ) {
+                /* retry */
+            }
+            sleeping_.store(false);
+        }
+        uint64_t value;
+        (void)read(wake_fd_, &value, sizeof(value));
+        // ... accumulate a batch, unless someone is waiting ...
+        const uint32_t interval = interval_ms_;
+        if ( 0 != interval && 0 == flushing_ && false == stop_ ) {
+            if ( poll(&pfd, 1, static_cast<int>(interval)) > 0 ) {
+                (void)read(wake_fd_, &value, sizeof(value));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Write a batch of ready lines.
+ *
+ * @return True if lines were written and there might be more.
+ */
+bool casper::inotify::Logger::Drain ()
+{
+#ifdef IOV_MAX
+    static const size_t sk_max_iov = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+    static const size_t sk_max_iov = 1024;
+#endif
+    struct iovec iov[sk_max_iov + 1];
+    size_t       count = 0;
+    size_t       pos   = dequeue_pos_;
+    char         dropped[64];
+    // ... report dropped lines ...
+    const uint64_t n_dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if ( 0 != n_dropped ) {
+        const int length = snprintf(dropped, sizeof(dropped), "--- %llu log line(s) dropped ---\n", static_cast<unsigned long long>(n_dropped));
+        iov[count].iov_base = dropped;
+        iov[count].iov_len  = static_cast<size_t>(length);
+        ++count;
+    }
+    // ... collect ...
+    while ( count < sk_max_iov ) {
+        Slot& slot = slots_[pos & mask_];
+        if ( slot.sequence_.load(std::memory_order_acquire) != pos + 1 ) {
+            break;
+        }
+        iov[count].iov_base = ( nullptr != slot.heap_ ? slot.heap_ : slot.data_ );
+        iov[count].iov_len  = slot.length_;
+        ++count;
+        ++pos;
+    }
+    if ( 0 == count ) {
+        return false;
+    }
+    // ... write, handling partial writes ...
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        struct iovec* it   = iov;
+        size_t        left = count;
+        while ( -1 != fd_ && left > 0 ) {
+            const ssize_t written = writev(fd_, it, static_cast<int>(left));
+            if ( written < 0 ) {
+                if ( EINTR == errno ) {
+                    continue;
+                }
+                break;
+            }
+            size_t remaining = static_cast<size_t>(written);
+            while ( left > 0 && remaining >= it->iov_len ) {
+                remaining -= it->iov_len;
+                ++it;
+                --left;
+            }
+            if ( left > 0 ) {
+                it->iov_base = static_cast<char*>(it->iov_base) + remaining;
+                it->iov_len -= remaining;
+            }
+        }
+    }
+    // ... release slots ...
+    for ( ; dequeue_pos_ < pos ; ++dequeue_pos_ ) {
+        Slot& slot = slots_[dequeue_pos_ & mask_];
+        if ( nullptr != slot.heap_ ) {
+            free(slot.heap_);
+            slot.heap_ = nullptr;
+        }
+        slot.sequence_.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    }
+    // ... notify flush waiters ...
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        written_pos_ = dequeue_pos_;
+    }
+    cv_.notify_all();
+    // ...
+    return true;
+}
+
+/**
+ * @brief Wake up writer thread.
+ */
+void casper::inotify::Logger::Wake ()
+{
+    const uint64_t one = 1;
+    (void)write(wake_fd_, &one, sizeof(one));
+}
@@ -0,0 +1,122 @@
+/**
+ * @file logger.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_LOGGER_H_
+#define CASPER_INOTIFY_LOGGER_H_
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+#define LOGGER_SLOT_DATA_SIZE     512
+#define LOGGER_DEFAULT_CAPACITY   4096
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Asynchronous line logger.
+         *
+         * Any number of threads enqueue lines into a bounded, lock-free, ring buffer;
+         * a background thread drains it and writes batches of lines with writev(2).
+         */
+        class Logger final
+        {
+
+        private: // Data Type(s)
+
+            typedef struct {
+                std::atomic<size_t> sequence_;
+                size_t              length_;
+                char*               heap_;                        //!< Used when line does not fit in data_.
+                char                data_[LOGGER_SLOT_DATA_SIZE];
+            } Slot;
+
+        private: // Data
+
+            std::unique_ptr<Slot[]>  slots_;
+            size_t                   mask_;
+            // ... producers and writer positions are kept a cache line apart, from each other and from their neighbours;
+            //     padded rather than aligned, a Logger is embedded in heap allocated objects and C++11 'new' ignores
+            //     extended alignment ...
+            char                     pad_0_[64];
+            std::atomic<size_t>      enqueue_pos_;
+            char                     pad_1_[64];
+            size_t                   dequeue_pos_;             //!< Writer thread only.
+            char                     pad_2_[64];
+            std::atomic<uint64_t>    dropped_;                 //!< Lines dropped because ring was full.
+            std::atomic<bool>        sleeping_;                //!< True while writer waits for lines.
+            std::atomic<bool>        stop_;
+            std::atomic<int>         flushing_;                //!< Number of threads waiting in Flush.
+            std::atomic<uint32_t>    interval_ms_;             //!< How long to accumulate lines before writing.
+            int                      wake_fd_;                 //!< eventfd, wakes writer thread.
+            int                      fd_;                      //!< Output, protected by io_mutex_.
+            std::mutex               io_mutex_;
+            std::mutex               mutex_;
+            std::condition_variable  cv_;
+            size_t                   written_pos_;             //!< Protected by mutex_.
+            std::thread*             thread_;
+
+        public: // Constructor(s) / Destructor
+
+            Logger (const Logger&) = delete;
+            Logger (const Logger&&) = delete;
+            Logger (const size_t a_capacity = LOGGER_DEFAULT_CAPACITY);
+            virtual ~Logger();
+
+        public: // Method(s) // Function(s)
+
+            void Open             (const int a_fd);
+            void Close            ();
+            bool Write            (const char* const a_data, const size_t a_length);
+            void Flush            ();
+            void SetFlushInterval (const uint32_t a_ms);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True when there's an output.
+             */
+            inline bool IsOpen () const
+            {
+                return nullptr != thread_;
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Loop  ();
+            bool Drain ();
+            void Wake  ();
+
+        }; // end of class 'Logger'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_LOGGER_H_
@@ -23,22 +23,17 @@
 #include "version.h"
 
 #include <syslog.h>
-#include <signal.h> // sigemptyset, sigaction, etc...
+#include <signal.h> // sigemptyset, sigprocmask, etc...
 #include <string.h> // strsignal, etc...
 #include <assert.h>
 
 #include <stdio.h>
+#include <stdlib.h> // strtoull
 #include <unistd.h>
 #include <sys/stat.h>
 
 static casper::inotify::API* g_api_ = nullptr;
 
-void on_signal (int a_sig_no)
-{
-    assert(nullptr != g_api_);    
-    g_api_->OnSignal(a_sig_no);
-}
-
 #define VAR_RUN_DIR "/var/run/" CASPER_INOTIFY_NAME
 #define VAR_LOG_DIR "/var/log/" CASPER_INOTIFY_NAME
 #define ETC_DIR "/etc/" CASPER_INOTIFY_NAME
@@ -47,6 +42,39 @@ int main( int argc, char **argv )
 {
     int rv = -1;
 
+    // ... persistent command worker, exec'ed by a running daemon ...
+    if ( 2 == argc && 0 == strcmp(argv[1], API_WORKER_ARGUMENT) ) {
+        casper::inotify::API::Serve(3);
+    }
+
+    // ... --replay <sequence> or --replay @<seconds since epoch>, dispatch journaled events again ...
+    bool     replay    = false;
+    uint64_t sequence  = 0;
+    uint64_t timestamp = 0;
+    for ( int idx = 1 ; idx < argc ; ++idx ) {
+        if ( 0 == strcmp(argv[idx], "--replay") && idx + 1 < argc ) {
+            const char* value = argv[++idx];
+            char*       end   = nullptr;
+            const bool  at    = ( '@' == value[0] );
+            const unsigned long long number = strtoull(true == at ? value + 1 : value, &end, 10);
+            if ( nullptr == end || '\0' != *end || end == ( true == at ? value + 1 : value ) ) {
+                fprintf(stderr, "Invalid replay start '%s', expecting a sequence or @<seconds since epoch>!\n", value);
+                fflush(stderr);
+                return rv;
+            }
+            replay = true;
+            if ( true == at ) {
+                timestamp = static_cast<uint64_t>(number) * 1000000000ull;
+            } else {
+                sequence  = static_cast<uint64_t>(number);
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--replay <sequence>|@<seconds since epoch>]\n", argv[0]);
+            fflush(stderr);
+            return rv;
+        }
+    }
+
     // ... ensure required directories ...
     {
         const mode_t mode = ( S_IRWXU | S_IRGRP | S_IXGRP | S_IXOTH );
@@ -63,20 +91,17 @@ int main( int argc, char **argv )
         }
     }
 
-    // ... install signal handler for logrotate ...
+    // ... block signals, they will be delivered through a signalfd on main loop ...
+    sigset_t signals;
     {
-        struct sigaction act;
-        memset(&act, 0, sizeof(act));
-        sigemptyset(&act.sa_mask);
-        act.sa_handler = on_signal;
-        act.sa_flags   = SA_RESTART;
-        const std::vector<int> signals = { SIGUSR1, SIGQUIT, SIGTERM };
-        for ( auto signal : signals ) {
-            if ( -1 == sigaction(signal, &act, 0) ) {
-                fprintf(stderr, "Unable to install signal handler: %d - %s\n", errno, strerror(errno));
-                fflush(stderr);
-                return rv;
-            }
+        sigemptyset(&signals);
+        for ( auto signal : { SIGUSR1, SIGQUIT, SIGTERM, SIGCHLD, SIGHUP } ) {
+            sigaddset(&signals, signal);
+        }
+        if ( -1 == sigprocmask(SIG_BLOCK, &signals, nullptr) ) {
+            fprintf(stderr, "Unable to block signals: %d - %s\n", errno, strerror(errno));
+            fflush(stderr);
+            return rv;
         }
     }
     // ... write pid file ...
@@ -104,8 +129,11 @@ int main( int argc, char **argv )
     // ... run ...
     g_api_ = new casper::inotify::API();
     try {
-        g_api_->Init(casper::inotify::API::LogLevel::_Event, VAR_LOG_DIR "/" "events.log");
+        g_api_->Init(casper::inotify::API::LogLevel::_Event, VAR_LOG_DIR "/" "events.log", signals);
         g_api_->Load(ETC_DIR "/" "conf.json");
+        if ( true == replay ) {
+            g_api_->Rewind(sequence, timestamp);
+        }
         rv = g_api_->Watch();
         g_api_->Unload();
     } catch (const casper::inotify::Exception& a_n_e) {
@@ -119,7 +147,7 @@ int main( int argc, char **argv )
     }
     delete g_api_;
     // ... pid file ...
-    if ( -1 != unlink(pid_file_uri) ) {
+    if ( -1 == unlink(pid_file_uri) ) {
         if ( EINTR != errno ) {
             rv = -1;
             fprintf(stderr, "Unable to remove pid file '%s': %d - %s\n", pid_file_uri, errno, strerror(errno));
@@ -0,0 +1,206 @@
+/**
+ * @file metrics.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+
+#include <stdio.h> // snprintf
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Histogram::Histogram ()
+{
+    for ( auto& count : counts_ ) {
+        count = 0;
+    }
+    count_ = 0;
+    sum_   = 0;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Histogram::~Histogram ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Add this histogram's counts to a set of totals, so that several histograms can be exported as one.
+ *
+ * @param o_totals Totals to add to, it's buckets are allocated on first use.
+ *
+ * @note Counts are read while they might be changing, totals are consistent only per bucket.
+ */
+void casper::inotify::Histogram::Collect (casper::inotify::Histogram::Totals& o_totals) const
+{
+    if ( 0 == o_totals.counts_.size() ) {
+        o_totals.counts_.assign(sk_buckets_, 0);
+        o_totals.count_ = 0;
+        o_totals.sum_   = 0;
+    }
+    for ( size_t idx = 0 ; idx < sk_buckets_ ; ++idx ) {
+        o_totals.counts_[idx] += counts_[idx].load(std::memory_order_relaxed);
+    }
+    o_totals.count_ += count_.load(std::memory_order_relaxed);
+    o_totals.sum_   += sum_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Count values less than or equal to a limit.
+ *
+ * @param a_totals See \link Histogram::Collect \link.
+ * @param a_max    Limit, values in the bucket it falls into are counted only if the whole bucket is below it.
+ */
+uint64_t casper::inotify::Histogram::Count (const casper::inotify::Histogram::Totals& a_totals, const uint64_t a_max)
+{
+    uint64_t count = 0;
+    for ( size_t idx = 0 ; idx < a_totals.counts_.size() && Highest(idx) <= a_max ; ++idx ) {
+        count += a_totals.counts_[idx];
+    }
+    return count;
+}
+
+/**
+ * @return Highest value counted in a bucket.
+ *
+ * @param a_bucket Bucket index.
+ */
+uint64_t casper::inotify::Histogram::Highest (const size_t a_bucket)
+{
+    if ( a_bucket < sk_sub_count_ ) {
+        return static_cast<uint64_t>(a_bucket);
+    }
+    const size_t   group  = a_bucket / sk_sub_count_;
+    const uint64_t lowest = static_cast<uint64_t>(sk_sub_count_ + a_bucket % sk_sub_count_) << ( group - 1 );
+    return lowest + ( uint64_t(1) << ( group - 1 ) ) - 1;
+}
+
+// MARK: -
+
+/**
+ * @brief Default constructor.
+ *
+ * @param o_text Buffer to append to.
+ */
+casper::inotify::Exposition::Exposition (std::string& o_text)
+    : text_(o_text)
+{
+    /* empty */
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Exposition::~Exposition ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Start a metric family, must be followed by all of it's samples.
+ *
+ * @param a_name Metric name.
+ * @param a_type counter, gauge or histogram.
+ * @param a_help Description.
+ */
+void casper::inotify::Exposition::Family (const char* const a_name, const char* const a_type, const char* const a_help)
+{
+    text_.append("# HELP ").append(a_name).append(1, ' ').append(a_help).append(1, '\n');
+    text_.append("# TYPE ").append(a_name).append(1, ' ').append(a_type).append(1, '\n');
+}
+
+/**
+ * @brief Write a counter or gauge sample.
+ *
+ * @param a_name   Metric name.
+ * @param a_labels Labels, see \link Exposition::Label \link, or empty.
+ * @param a_value  Value.
+ */
+void casper::inotify::Exposition::Sample (const char* const a_name, const std::string& a_labels, const uint64_t a_value)
+{
+    text_.append(a_name);
+    if ( 0 != a_labels.length() ) {
+        text_.append(1, '{').append(a_labels).append(1, '}');
+    }
+    text_.append(1, ' ').append(std::to_string(a_value)).append(1, '\n');
+}
+
+/**
+ * @brief Write a histogram's samples.
+ *
+ * @param a_name   Metric name.
+ * @param a_labels Labels, see \link Exposition::Label \link, or empty.
+ * @param a_totals See \link Histogram::Collect \link.
+ * @param a_bounds Buckets upper bounds, ascending, in recorded units.
+ * @param a_scale  Recorded units to exported units factor.
+ */
+void casper::inotify::Exposition::Distribution (const char* const a_name, const std::string& a_labels, const casper::inotify::Histogram::Totals& a_totals,
+                                                const std::vector<uint64_t>& a_bounds, const double a_scale)
+{
+    const std::string separator = ( 0 != a_labels.length() ? "," : "" );
+    char              number[32];
+    for ( const auto bound : a_bounds ) {
+        snprintf(number, sizeof(number), "%g", static_cast<double>(bound) * a_scale);
+        text_.append(a_name).append("_bucket{").append(a_labels).append(separator).append("le=\"").append(number).append("\"} ")
+             .append(std::to_string(Histogram::Count(a_totals, bound))).append(1, '\n');
+    }
+    text_.append(a_name).append("_bucket{").append(a_labels).append(separator).append("le=\"+Inf\"} ")
+         .append(std::to_string(a_totals.count_)).append(1, '\n');
+    snprintf(number, sizeof(number), "%.9g", static_cast<double>(a_totals.sum_) * a_scale);
+    text_.append(a_name).append("_sum");
+    if ( 0 != a_labels.length() ) {
+        text_.append(1, '{').append(a_labels).append(1, '}');
+    }
+    text_.append(1, ' ').append(number).append(1, '\n');
+    text_.append(a_name).append("_count");
+    if ( 0 != a_labels.length() ) {
+        text_.append(1, '{').append(a_labels).append(1, '}');
+    }
+    text_.append(1, ' ').append(std::to_string(a_totals.count_)).append(1, '\n');
+}
+
+/**
+ * @brief Append a label to a list of labels, escaping it's value.
+ *
+ * @param a_name   Label name.
+ * @param a_value  Label value.
+ * @param o_labels List to append to.
+ */
+void casper::inotify::Exposition::Label (const char* const a_name, const std::string& a_value, std::string& o_labels)
+{
+    if ( 0 != o_labels.length() ) {
+        o_labels.append(1, ',');
+    }
+    o_labels.append(a_name).append("=\"");
+    for ( const char c : a_value ) {
+        if ( '\\' == c ) {
+            o_labels.append("\\\\");
+        } else if ( '"' == c ) {
+            o_labels.append("\\\"");
+        } else if ( '\n' == c ) {
+            o_labels.append("\\n");
+        } else {
+            o_labels.append(1, c);
+        }
+    }
+    o_labels.append(1, '"');
+}
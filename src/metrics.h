@@ -0,0 +1,143 @@
+/**
+ * @file metrics.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_METRICS_H_
+#define CASPER_INOTIFY_METRICS_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Lock-free histogram with log-linear buckets ( HDR style ).
+         *
+         * Values below 2^\link Histogram::sk_sub_bits_ \link have their own bucket, above that each power
+         * of two is split in 2^\link Histogram::sk_sub_bits_ \link buckets, so a bucket's width is never
+         * more than ~3% of the values it holds. Recording is wait-free and never allocates.
+         */
+        class Histogram final
+        {
+
+        public: // Const Data
+
+            static const size_t   sk_sub_bits_   = 5;
+            static const size_t   sk_sub_count_  = ( size_t(1) << sk_sub_bits_ );
+            static const size_t   sk_max_bits_   = 36; //!< Larger values are clamped.
+            static const size_t   sk_buckets_    = ( sk_max_bits_ - sk_sub_bits_ + 1 ) * sk_sub_count_;
+
+        public: // Data Type(s)
+
+            typedef struct {
+                std::vector<uint64_t> counts_; //!< By bucket.
+                uint64_t              count_;
+                uint64_t              sum_;
+            } Totals;
+
+        private: // Data
+
+            std::atomic<uint64_t> counts_[sk_buckets_];
+            std::atomic<uint64_t> count_;
+            std::atomic<uint64_t> sum_;
+
+        public: // Constructor(s) / Destructor
+
+            Histogram();
+            virtual ~Histogram();
+
+        public: // Method(s) // Function(s)
+
+            void Collect (Totals& o_totals) const;
+
+            static uint64_t Count   (const Totals& a_totals, const uint64_t a_max);
+            static uint64_t Highest (const size_t a_bucket);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @brief Record a value.
+             *
+             * @param a_value Value to record.
+             */
+            inline void Record (const uint64_t a_value)
+            {
+                counts_[Bucket(a_value)].fetch_add(1, std::memory_order_relaxed);
+                count_.fetch_add(1, std::memory_order_relaxed);
+                sum_.fetch_add(a_value, std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Bucket a value is counted in.
+             *
+             * @param a_value Value to map.
+             */
+            static inline size_t Bucket (uint64_t a_value)
+            {
+                if ( a_value < sk_sub_count_ ) {
+                    return static_cast<size_t>(a_value);
+                }
+                if ( a_value >= ( uint64_t(1) << sk_max_bits_ ) ) {
+                    a_value = ( uint64_t(1) << sk_max_bits_ ) - 1;
+                }
+                const size_t exponent = static_cast<size_t>(63 - __builtin_clzll(a_value));
+                return ( exponent - sk_sub_bits_ + 1 ) * sk_sub_count_ + static_cast<size_t>( ( a_value >> ( exponent - sk_sub_bits_ ) ) & ( sk_sub_count_ - 1 ) );
+            }
+
+        }; // end of class 'Histogram'
+
+        /**
+         * @brief Prometheus text exposition format ( version 0.0.4 ) writer.
+         */
+        class Exposition final
+        {
+
+        private: // Data
+
+            std::string& text_;
+
+        public: // Constructor(s) / Destructor
+
+            Exposition (std::string& o_text);
+            virtual ~Exposition();
+
+        public: // Method(s) // Function(s)
+
+            void Family       (const char* const a_name, const char* const a_type, const char* const a_help);
+            void Sample       (const char* const a_name, const std::string& a_labels, const uint64_t a_value);
+            void Distribution (const char* const a_name, const std::string& a_labels, const Histogram::Totals& a_totals,
+                               const std::vector<uint64_t>& a_bounds, const double a_scale);
+
+            static void Label        (const char* const a_name, const std::string& a_value, std::string& o_labels);
+
+        }; // end of class 'Exposition'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_METRICS_H_
@@ -0,0 +1,89 @@
+/**
+ * @file plugin.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_PLUGIN_H_
+#define CASPER_INOTIFY_PLUGIN_H_
+
+/*
+ * Handler plugins ABI, C compatible so plugins can be written in any language.
+ *
+ * A plugin is a shared object that exports CASPER_INOTIFY_PLUGIN_SYMBOL:
+ *
+ *     static int  my_init     (const char* config, void** state) { ... ; return 0; }
+ *     static int  my_on_event (void* state, const casper_inotify_event_t* event) { ... ; return 0; }
+ *     static void my_shutdown (void* state) { ... }
+ *
+ *     static const casper_inotify_plugin_t my_plugin = {
+ *         CASPER_INOTIFY_PLUGIN_ABI, "my-plugin", my_init, my_on_event, my_shutdown
+ *     };
+ *
+ *     const casper_inotify_plugin_t* casper_inotify_plugin (void) { return &my_plugin; }
+ *
+ * Built with:
+ *
+ *     cc -shared -fPIC -o my-plugin.so my-plugin.c
+ *
+ * init is called once per entry that names the plugin, with that entry's "config" as JSON text; on_event
+ * is called, from a handler thread, for each event of that entry, in order and never concurrently for the
+ * same state; shutdown is called once the entry is gone and all of it's events were handled.
+ */
+
+#include <stdint.h> /* uint32_t */
+
+#define CASPER_INOTIFY_PLUGIN_ABI    1
+#define CASPER_INOTIFY_PLUGIN_SYMBOL "casper_inotify_plugin"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An event, valid only during the on_event call.
+ */
+typedef struct {
+    uint32_t    mask;     /*!< inotify(7) event mask. */
+    int         inside;   /*!< Non zero when event is for an object inside a watched directory. */
+    const char* event;    /*!< Actions names, ", " separated, as CASPER_INOTIFY_EVENT. */
+    const char* object;   /*!< "file" or "directory". */
+    const char* entry;    /*!< Configured entry URI. */
+    const char* parent;   /*!< Directory object is in, NULL when event is for the watched object itself. */
+    const char* name;     /*!< Object name, or path for the watched object itself. */
+    const char* old_name; /*!< Full path before a rename, NULL if none. */
+    const char* datetime; /*!< ISO 8601, as logged. */
+} casper_inotify_event_t;
+
+/**
+ * @brief What a plugin exports, through CASPER_INOTIFY_PLUGIN_SYMBOL.
+ */
+typedef struct {
+    uint32_t    abi;                                                       /*!< CASPER_INOTIFY_PLUGIN_ABI. */
+    const char* name;
+    int         (*init)     (const char* config, void** state);             /*!< 0 on success. */
+    int         (*on_event) (void* state, const casper_inotify_event_t* event); /*!< 0 on success, counted as a failure otherwise. */
+    void        (*shutdown) (void* state);
+} casper_inotify_plugin_t;
+
+typedef const casper_inotify_plugin_t* (*casper_inotify_plugin_entry_t) (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CASPER_INOTIFY_PLUGIN_H_ */
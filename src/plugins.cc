@@ -0,0 +1,235 @@
+/**
+ * @file plugins.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "plugins.h"
+
+#include <chrono>
+
+#include "exception.h"
+
+#include <dlfcn.h> // dlopen, dlsym, dlclose, dlerror
+
+/**
+ * @brief Load a plugin and initialize it.
+ *
+ * @param a_uri    Shared object.
+ * @param a_config Entry's plugin configuration, JSON text.
+ * @param a_lane   Lane it's events are handled on.
+ */
+casper::inotify::Plugins::Instance::Instance (const std::string& a_uri, const std::string& a_config, const size_t a_lane)
+    : uri_(a_uri), handle_(nullptr), plugin_(nullptr), state_(nullptr), lane_(a_lane)
+{
+    handle_ = dlopen(a_uri.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if ( nullptr == handle_ ) {
+        throw inotify::Exception("Unable to load plugin %s: %s!", a_uri.c_str(), dlerror());
+    }
+    const auto entry = reinterpret_cast<casper_inotify_plugin_entry_t>(dlsym(handle_, CASPER_INOTIFY_PLUGIN_SYMBOL));
+    plugin_ = ( nullptr != entry ? entry() : nullptr );
+    if ( nullptr == plugin_ || CASPER_INOTIFY_PLUGIN_ABI != plugin_->abi || nullptr == plugin_->on_event ) {
+        dlclose(handle_);
+        throw inotify::Exception("Plugin %s does not export a version %u " CASPER_INOTIFY_PLUGIN_SYMBOL "!", a_uri.c_str(), CASPER_INOTIFY_PLUGIN_ABI);
+    }
+    if ( nullptr != plugin_->init ) {
+        const int rv = plugin_->init(a_config.c_str(), &state_);
+        if ( 0 != rv ) {
+            dlclose(handle_);
+            throw inotify::Exception("Plugin %s failed to initialize: %d!", a_uri.c_str(), rv);
+        }
+    }
+}
+
+/**
+ * @brief Destructor, shuts plugin down and unloads it.
+ */
+casper::inotify::Plugins::Instance::~Instance ()
+{
+    if ( nullptr != plugin_->shutdown ) {
+        plugin_->shutdown(state_);
+    }
+    dlclose(handle_);
+}
+
+// MARK: -
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Plugins::Plugins ()
+{
+    capacity_ = PLUGINS_DEFAULT_CAPACITY;
+    next_     = 0;
+    queued_   = 0;
+    handled_  = 0;
+    failed_   = 0;
+    dropped_  = 0;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Plugins::~Plugins ()
+{
+    Stop();
+}
+
+/**
+ * @brief Start handler threads.
+ *
+ * @param a_threads  Number of threads, one per lane.
+ * @param a_capacity Maximum number of events queued per lane.
+ */
+void casper::inotify::Plugins::Start (const size_t a_threads, const size_t a_capacity)
+{
+    Stop();
+    capacity_ = a_capacity;
+    for ( size_t idx = 0 ; idx < a_threads ; ++idx ) {
+        Lane* lane = new Lane();
+        lane->stop_   = false;
+        lane->thread_ = nullptr;
+        lanes_.push_back(lane);
+        lane->thread_ = new std::thread(&casper::inotify::Plugins::Loop, this, std::ref(*lane));
+    }
+}
+
+/**
+ * @brief Handle queued events and stop handler threads.
+ */
+void casper::inotify::Plugins::Stop ()
+{
+    for ( auto lane : lanes_ ) {
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex_);
+            lane->stop_ = true;
+        }
+        lane->cv_.notify_one();
+    }
+    for ( auto lane : lanes_ ) {
+        if ( nullptr != lane->thread_ ) {
+            lane->thread_->join();
+            delete lane->thread_;
+        }
+        delete lane;
+    }
+    lanes_.clear();
+}
+
+/**
+ * @brief Load and initialize a plugin for an entry.
+ *
+ * @param a_uri    Shared object.
+ * @param a_config Entry's plugin configuration, JSON text.
+ *
+ * @return Instance events are submitted to.
+ */
+std::shared_ptr<casper::inotify::Plugins::Instance> casper::inotify::Plugins::Load (const std::string& a_uri, const std::string& a_config)
+{
+    return std::make_shared<Plugins::Instance>(a_uri, a_config, next_++);
+}
+
+/**
+ * @brief Queue an event to be handled by a plugin.
+ *
+ * @param a_instance Plugin instance.
+ * @param a_event    Event, it's strings are copied.
+ *
+ * @return False when it was dropped.
+ */
+bool casper::inotify::Plugins::Submit (const std::shared_ptr<casper::inotify::Plugins::Instance>& a_instance, const casper_inotify_event_t& a_event)
+{
+    if ( 0 == lanes_.size() || nullptr == a_instance ) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Lane& lane = *lanes_[a_instance->lane_ % lanes_.size()];
+    bool  wake = false;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex_);
+        if ( lane.queue_.size() >= capacity_ ) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        wake = lane.queue_.empty();
+        lane.queue_.emplace_back();
+        Job& job = lane.queue_.back();
+        job.instance_ = a_instance;
+        job.mask_     = a_event.mask;
+        job.inside_   = a_event.inside;
+        const char* const strings[7] = {
+            a_event.event, a_event.object, a_event.entry, a_event.parent, a_event.name, a_event.old_name, a_event.datetime
+        };
+        for ( size_t idx = 0 ; idx < 7 ; ++idx ) {
+            if ( nullptr == strings[idx] ) {
+                job.offsets_[idx] = UINT32_MAX;
+                continue;
+            }
+            job.offsets_[idx] = static_cast<uint32_t>(job.strings_.length());
+            job.strings_.append(strings[idx]).append(1, '\0');
+        }
+    }
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    // ... thread only waits when it's queue is empty ...
+    if ( true == wake ) {
+        lane.cv_.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Handler thread, invokes plugins for a lane's events until it's stopped and it's queue is empty.
+ *
+ * @param a_lane Lane to handle.
+ */
+void casper::inotify::Plugins::Loop (casper::inotify::Plugins::Lane& a_lane)
+{
+    std::deque<Job> batch;
+    std::unique_lock<std::mutex> lock(a_lane.mutex_);
+    while ( true ) {
+        a_lane.cv_.wait(lock, [&a_lane] { return true == a_lane.stop_ || false == a_lane.queue_.empty(); });
+        if ( true == a_lane.queue_.empty() ) {
+            break;
+        }
+        // ... take all queued events at once, submitters are not blocked while they are handled ...
+        batch.swap(a_lane.queue_);
+        lock.unlock();
+        for ( auto& job : batch ) {
+            const char* strings[7];
+            for ( size_t idx = 0 ; idx < 7 ; ++idx ) {
+                strings[idx] = ( UINT32_MAX != job.offsets_[idx] ? job.strings_.c_str() + job.offsets_[idx] : nullptr );
+            }
+            const casper_inotify_event_t event = {
+                job.mask_, job.inside_, strings[0], strings[1], strings[2], strings[3], strings[4], strings[5], strings[6]
+            };
+            const Instance& instance = *job.instance_;
+            const auto      start    = std::chrono::steady_clock::now();
+            const int       rv       = instance.plugin_->on_event(instance.state_, &event);
+            durations_.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+            if ( 0 == rv ) {
+                handled_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // ... last reference to an instance might be here, it's shut down without holding the lock ...
+        batch.clear();
+        lock.lock();
+    }
+}
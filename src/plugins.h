@@ -0,0 +1,206 @@
+/**
+ * @file plugins.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_PLUGINS_H_
+#define CASPER_INOTIFY_PLUGINS_H_
+
+#include "plugin.h"
+#include "metrics.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint32_t, uint64_t
+
+#define PLUGINS_DEFAULT_THREADS  2
+#define PLUGINS_DEFAULT_CAPACITY 65536
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Handler plugins, see \link plugin.h \link, and the threads they are invoked on.
+         *
+         * Each instance is bound to one lane, a queue and a thread, so events of an entry are handled in order
+         * and never concurrently; dispatching is a copy into that queue, a full queue drops the event.
+         */
+        class Plugins final
+        {
+
+        public: // Data Type(s)
+
+            /**
+             * @brief A plugin initialized for an entry, shut down and unloaded once the entry and all it's
+             *        queued events are gone.
+             */
+            class Instance final
+            {
+
+                friend class Plugins;
+
+            private: // Data
+
+                std::string                    uri_;     //!< Shared object.
+                void*                          handle_;  //!< dlopen(3) handle.
+                const casper_inotify_plugin_t* plugin_;
+                void*                          state_;   //!< What init returned.
+                size_t                         lane_;
+
+            public: // Constructor(s) / Destructor
+
+                Instance (const Instance&) = delete;
+                Instance (const Instance&&) = delete;
+                Instance (const std::string& a_uri, const std::string& a_config, const size_t a_lane);
+                virtual ~Instance();
+
+            public: // Inline Method(s) // Function(s)
+
+                /**
+                 * @return Name plugin gave itself.
+                 */
+                inline const char* name () const
+                {
+                    return nullptr != plugin_->name ? plugin_->name : uri_.c_str();
+                }
+
+            }; // end of class 'Instance'
+
+        private: // Data Type(s)
+
+            typedef struct {
+                std::shared_ptr<Instance> instance_;
+                uint32_t                  mask_;
+                int                       inside_;
+                std::string               strings_;    //!< casper_inotify_event_t strings, NUL terminated.
+                uint32_t                  offsets_[7]; //!< Of each string, UINT32_MAX for NULL.
+            } Job;
+
+            typedef struct {
+                std::mutex              mutex_;
+                std::condition_variable cv_;
+                std::deque<Job>         queue_;
+                bool                    stop_;
+                std::thread*            thread_;
+            } Lane;
+
+        private: // Data
+
+            std::vector<Lane*>    lanes_;
+            size_t                capacity_;  //!< Maximum number of events queued per lane.
+            size_t                next_;      //!< Lane of next instance.
+            std::atomic<size_t>   queued_;
+            std::atomic<uint64_t> handled_;
+            std::atomic<uint64_t> failed_;
+            std::atomic<uint64_t> dropped_;
+            Histogram             durations_; //!< on_event duration, in nanoseconds.
+
+        public: // Constructor(s) / Destructor
+
+            Plugins (const Plugins&) = delete;
+            Plugins (const Plugins&&) = delete;
+            Plugins();
+            virtual ~Plugins();
+
+        public: // Method(s) // Function(s)
+
+            void                      Start  (const size_t a_threads, const size_t a_capacity);
+            void                      Stop   ();
+            std::shared_ptr<Instance> Load   (const std::string& a_uri, const std::string& a_config);
+            bool                      Submit (const std::shared_ptr<Instance>& a_instance, const casper_inotify_event_t& a_event);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True while handler threads are running.
+             */
+            inline bool IsRunning () const
+            {
+                return 0 != lanes_.size();
+            }
+
+            /**
+             * @return True when running with these settings.
+             */
+            inline bool Matches (const size_t a_threads, const size_t a_capacity) const
+            {
+                return lanes_.size() == a_threads && capacity_ == a_capacity;
+            }
+
+            /**
+             * @return Number of events waiting to be handled.
+             */
+            inline size_t queued () const
+            {
+                return queued_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of events handled successfully.
+             */
+            inline uint64_t handled () const
+            {
+                return handled_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of events a plugin failed to handle.
+             */
+            inline uint64_t failed () const
+            {
+                return failed_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of events dropped because a queue was full.
+             */
+            inline uint64_t dropped () const
+            {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return How long plugins took to handle events, in nanoseconds.
+             */
+            inline const Histogram& durations () const
+            {
+                return durations_;
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Loop (Lane& a_lane);
+
+        }; // end of class 'Plugins'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_PLUGINS_H_
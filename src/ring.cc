@@ -0,0 +1,353 @@
+/**
+ * @file ring.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ring.h"
+
+#include <vector>
+#include <new>       // placement new
+#include <algorithm> // std::min
+
+#include "exception.h"
+
+#include <string.h> // strerror, memset, memcpy
+#include <errno.h>
+#include <unistd.h> // close, unlink, write, ftruncate
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Ring::Ring ()
+{
+    fd_         = -1;
+    epoll_fd_   = -1;
+    slots_      = 0;
+    slot_size_  = 0;
+    memfd_      = -1;
+    size_       = 0;
+    header_     = nullptr;
+    base_       = nullptr;
+    count_      = 0;
+    published_  = 0;
+    truncated_  = 0;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Ring::~Ring ()
+{
+    Close();
+}
+
+/**
+ * @brief Create shared memory and start listening for readers.
+ *
+ * @param a_uri       Unix socket path, replaced if it exists.
+ * @param a_slots     Number of slots, a power of two.
+ * @param a_slot_size Slot size, in bytes, a multiple of 64.
+ * @param a_epoll_fd  epoll instance listening and readers sockets are registered with.
+ */
+void casper::inotify::Ring::Open (const std::string& a_uri, const size_t a_slots, const size_t a_slot_size, const int a_epoll_fd)
+{
+    Close();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if ( a_uri.length() >= sizeof(address.sun_path) ) {
+        throw inotify::Exception("Ring socket path '%s' is too long!", a_uri.c_str());
+    }
+    strncpy(address.sun_path, a_uri.c_str(), sizeof(address.sun_path) - 1);
+    // ... shared memory ...
+    const size_t size  = RING_HEADER_SIZE + a_slots * a_slot_size;
+    const int    memfd = memfd_create("casper-inotify-ring", MFD_CLOEXEC);
+    if ( memfd < 0 ) {
+        throw inotify::Exception("An error occurred while creating ring memory: %d - %s", errno, strerror(errno));
+    }
+    void* memory = MAP_FAILED;
+    if ( 0 != ftruncate(memfd, static_cast<off_t>(size))
+        || MAP_FAILED == ( memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, memfd, 0) ) ) {
+        const int no = errno;
+        close(memfd);
+        throw inotify::Exception("An error occurred while mapping %zu bytes of ring memory: %d - %s", size, no, strerror(no));
+    }
+    // ... memfd memory is zeroed, all slots are empty ...
+    RingHeader* header = new (memory) RingHeader;
+    header->magic_     = RING_MAGIC;
+    header->version_   = RING_VERSION;
+    header->slots_     = static_cast<uint32_t>(a_slots);
+    header->slot_size_ = static_cast<uint32_t>(a_slot_size);
+    header->head_.store(0, std::memory_order_relaxed);
+    header->sleepers_.store(0, std::memory_order_relaxed);
+    // ... socket ...
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ( fd < 0 ) {
+        const int no = errno;
+        munmap(memory, size);
+        close(memfd);
+        throw inotify::Exception("An error occurred while creating ring socket: %d - %s", no, strerror(no));
+    }
+    // ... left behind by a previous instance?
+    (void)unlink(a_uri.c_str());
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    if ( 0 != bind(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) || 0 != listen(fd, 64)
+        || 0 != epoll_ctl(a_epoll_fd, EPOLL_CTL_ADD, fd, &ev) ) {
+        const int no = errno;
+        close(fd);
+        munmap(memory, size);
+        close(memfd);
+        throw inotify::Exception("An error occurred while listening on ring socket '%s': %d - %s", a_uri.c_str(), no, strerror(no));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    fd_        = fd;
+    epoll_fd_  = a_epoll_fd;
+    uri_       = a_uri;
+    slots_     = a_slots;
+    slot_size_ = a_slot_size;
+    memfd_     = memfd;
+    size_      = size;
+    header_    = header;
+    base_      = static_cast<uint8_t*>(memory) + RING_HEADER_SIZE;
+    free_.clear();
+    for ( uint32_t index = RING_MAX_READERS ; index > 0 ; --index ) {
+        free_.push_back(index - 1);
+    }
+}
+
+/**
+ * @brief Disconnect all readers, stop listening and release shared memory.
+ *
+ * @note Readers keep their own mapping, they'll notice they were disconnected.
+ */
+void casper::inotify::Ring::Close ()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for ( auto& it : readers_ ) {
+        close(it.first);
+        close(it.second.doorbell_);
+    }
+    readers_.clear();
+    free_.clear();
+    count_ = 0;
+    if ( -1 != fd_ ) {
+        close(fd_);
+        (void)unlink(uri_.c_str());
+        fd_ = -1;
+    }
+    if ( nullptr != header_ ) {
+        munmap(header_, size_);
+        header_ = nullptr;
+        base_   = nullptr;
+    }
+    if ( -1 != memfd_ ) {
+        close(memfd_);
+        memfd_ = -1;
+    }
+    epoll_fd_ = -1;
+    uri_      = "";
+}
+
+/**
+ * @return True when a file descriptor is the listening socket or a reader's.
+ *
+ * @param a_fd File descriptor reported by epoll.
+ */
+bool casper::inotify::Ring::Owns (const int a_fd)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ( -1 != fd_ && ( a_fd == fd_ || readers_.end() != readers_.find(a_fd) ) );
+}
+
+/**
+ * @brief Accept readers or forget them when they hang up.
+ *
+ * @param a_fd     Listening or reader socket.
+ * @param a_events epoll events.
+ */
+void casper::inotify::Ring::OnEvent (const int a_fd, const uint32_t a_events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( a_fd == fd_ ) {
+        Accept();
+        return;
+    }
+    if ( readers_.end() == readers_.find(a_fd) ) {
+        return;
+    }
+    if ( 0 != ( a_events & ( EPOLLERR | EPOLLHUP | EPOLLRDHUP ) ) ) {
+        Remove(a_fd);
+        return;
+    }
+    // ... readers are not expected to send anything ...
+    char buffer[64];
+    ssize_t rv;
+    while ( ( rv = recv(a_fd, buffer, sizeof(buffer), MSG_DONTWAIT) ) > 0 ) {
+        /* discarded */
+    }
+    if ( 0 == rv || ( rv < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno ) ) {
+        Remove(a_fd);
+    }
+}
+
+/**
+ * @brief Write an event to the next slot, overwriting the oldest frame, and wake up sleeping readers.
+ *
+ * @param a_event Event to publish.
+ */
+void casper::inotify::Ring::Publish (const Stream::Event& a_event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( nullptr == header_ || true == readers_.empty() ) {
+        return;
+    }
+    const uint64_t sequence = header_->head_.load(std::memory_order_relaxed) + 1;
+    RingSlot*      slot     = reinterpret_cast<RingSlot*>(base_ + ( sequence & ( slots_ - 1 ) ) * slot_size_);
+    StreamFrame    header;
+    Stream::Describe(a_event, sequence, header);
+    // ... too long? cut strings, last ones first ...
+    const size_t capacity = slot_size_ - sizeof(RingSlot);
+    if ( header.length_ > capacity ) {
+        size_t    excess     = header.length_ - capacity;
+        uint16_t* lengths[4] = { &header.old_name_length_, &header.name_length_, &header.parent_length_, &header.entry_length_ };
+        for ( size_t idx = 0 ; idx < 4 && excess > 0 ; ++idx ) {
+            const size_t cut = std::min(excess, static_cast<size_t>(*lengths[idx]));
+            *lengths[idx] -= static_cast<uint16_t>(cut);
+            excess        -= cut;
+        }
+        header.length_  = static_cast<uint32_t>(capacity);
+        header.flags_  |= STREAM_FLAG_TRUNCATED;
+        truncated_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // ... seqlock: invalidate, write, publish ...
+    slot->sequence_.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    uint8_t* payload = reinterpret_cast<uint8_t*>(slot + 1);
+    memcpy(payload, &header, sizeof(header));
+    payload += sizeof(header);
+    memcpy(payload, a_event.entry_, header.entry_length_);
+    payload += header.entry_length_;
+    if ( 0 != header.parent_length_ ) {
+        memcpy(payload, a_event.parent_, header.parent_length_);
+        payload += header.parent_length_;
+    }
+    memcpy(payload, a_event.name_, header.name_length_);
+    payload += header.name_length_;
+    if ( 0 != header.old_name_length_ ) {
+        memcpy(payload, a_event.old_name_, header.old_name_length_);
+    }
+    slot->length_ = header.length_;
+    slot->sequence_.store(sequence, std::memory_order_release);
+    // ... pairs with readers incrementing sleepers_ before checking head_ one last time ...
+    header_->head_.store(sequence, std::memory_order_seq_cst);
+    published_.fetch_add(1, std::memory_order_relaxed);
+    if ( 0 == header_->sleepers_.load(std::memory_order_seq_cst) ) {
+        return;
+    }
+    const uint64_t one = 1;
+    for ( const auto& it : readers_ ) {
+        if ( 0 != header_->waiting_[it.second.index_].exchange(0, std::memory_order_seq_cst) ) {
+            (void)write(it.second.doorbell_, &one, sizeof(one));
+        }
+    }
+}
+
+// MARK: -
+
+/**
+ * @brief Accept all pending readers, handing each the shared memory and a doorbell; must be called while locked.
+ */
+void casper::inotify::Ring::Accept ()
+{
+    int fd;
+    while ( ( fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) ) >= 0 ) {
+        // ... too many readers?
+        if ( true == free_.empty() ) {
+            close(fd);
+            continue;
+        }
+        const int doorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if ( doorbell < 0 ) {
+            close(fd);
+            continue;
+        }
+        const uint32_t index = free_.back();
+        header_->waiting_[index].store(0, std::memory_order_relaxed);
+        RingHello hello;
+        memset(&hello, 0, sizeof(hello));
+        hello.magic_     = RING_MAGIC;
+        hello.version_   = RING_VERSION;
+        hello.slots_     = static_cast<uint32_t>(slots_);
+        hello.slot_size_ = static_cast<uint32_t>(slot_size_);
+        hello.index_     = index;
+        hello.size_      = static_cast<uint64_t>(size_);
+        const int fds[2] = { memfd_, doorbell };
+        char control[CMSG_SPACE(sizeof(fds))];
+        memset(control, 0, sizeof(control));
+        struct iovec  iov = { &hello, sizeof(hello) };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if ( static_cast<ssize_t>(sizeof(hello)) != sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) || 0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) ) {
+            close(doorbell);
+            close(fd);
+            continue;
+        }
+        free_.pop_back();
+        readers_[fd] = { doorbell, index };
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Forget a reader, must be called while locked.
+ *
+ * @param a_fd Reader socket.
+ */
+void casper::inotify::Ring::Remove (const int a_fd)
+{
+    const auto it = readers_.find(a_fd);
+    // ... closing it also removes it from epoll ...
+    close(it->second.doorbell_);
+    close(a_fd);
+    free_.push_back(it->second.index_);
+    readers_.erase(it);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file ring.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_RING_H_
+#define CASPER_INOTIFY_RING_H_
+
+#include "stream.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint32_t, uint64_t
+
+#define RING_MAGIC              0x474e4952 // "RING"
+#define RING_VERSION            1
+#define RING_HEADER_SIZE        4096       //!< Slots start at this offset.
+#define RING_DEFAULT_SLOTS      4096
+#define RING_DEFAULT_SLOT_SIZE  512
+#define RING_MAX_READERS        256
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Shared memory header, at offset 0; the only part readers write to.
+         */
+        typedef struct {
+            uint32_t                          magic_;     //!< RING_MAGIC.
+            uint32_t                          version_;   //!< RING_VERSION.
+            uint32_t                          slots_;     //!< Power of two.
+            uint32_t                          slot_size_; //!< Bytes, \link RingSlot \link included.
+            alignas(64) std::atomic<uint64_t> head_;      //!< Last published sequence, 0 when none; sequence N lives in slot N % slots.
+            alignas(64) std::atomic<uint32_t> sleepers_;  //!< Readers about to block on their doorbell, producer rings only when not 0.
+            std::atomic<uint32_t>             waiting_[RING_MAX_READERS]; //!< By reader index, 1 until it's doorbell is rung.
+        } RingHeader;
+
+        /**
+         * @brief Slot header, followed by a \link StreamFrame \link and it's strings.
+         *
+         * Written as a seqlock: \link RingSlot::sequence_ \link is 0 while the frame is being written, so a
+         * reader that sees the same sequence before and after reading a frame knows it was not overwritten.
+         */
+        typedef struct {
+            std::atomic<uint64_t> sequence_; //!< Of frame it holds, 0 while being written.
+            uint32_t              length_;   //!< Frame length.
+            uint32_t              reserved_;
+        } RingSlot;
+
+        /**
+         * @brief Sent to each reader as it connects, along with the shared memory and it's doorbell file descriptors.
+         */
+        typedef struct {
+            uint32_t magic_;     //!< RING_MAGIC.
+            uint32_t version_;   //!< RING_VERSION.
+            uint32_t slots_;
+            uint32_t slot_size_;
+            uint32_t index_;     //!< Reader's \link RingHeader::waiting_ \link.
+            uint32_t reserved_;
+            uint64_t size_;      //!< Shared memory size.
+        } RingHello;
+
+        static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared memory atomics must be lock free!");
+        static_assert(sizeof(RingHeader) <= RING_HEADER_SIZE, "ring header does not fit!");
+
+        /**
+         * @brief Publish events to a memfd backed single producer, multiple consumer ring, for local readers that
+         *        can't afford a system call or a copy per event.
+         *
+         * Readers connect to a SOCK_SEQPACKET unix socket and receive, with a \link RingHello \link, the shared
+         * memory and an eventfd doorbell of their own; they then follow \link RingHeader::head_ \link at their own
+         * pace. The producer never waits: a reader that falls more than a ring behind loses the oldest frames, and
+         * notices it by the gap in sequences. A reader's doorbell is only rung once per sleep.
+         * The connection is kept only to learn when a reader is gone, and is serviced by whoever polls the
+         * epoll instance given to \link Ring::Open \link.
+         */
+        class Ring final
+        {
+
+        private: // Data Type(s)
+
+            typedef struct {
+                int      doorbell_; //!< eventfd.
+                uint32_t index_;    //!< In \link RingHeader::waiting_ \link.
+            } Reader;
+
+        private: // Data
+
+            std::mutex                         mutex_;     //!< Protects everything but counters, publishers are shards threads.
+            int                                fd_;        //!< Listening socket, -1 when closed.
+            int                                epoll_fd_;
+            std::string                        uri_;
+            size_t                             slots_;
+            size_t                             slot_size_;
+            int                                memfd_;
+            size_t                             size_;      //!< Shared memory size.
+            RingHeader*                        header_;    //!< Shared memory, mapped.
+            uint8_t*                           base_;      //!< First slot.
+            std::unordered_map<int, Reader>    readers_;   //!< By socket.
+            std::vector<uint32_t>              free_;      //!< Unused reader indexes.
+            std::atomic<size_t>                count_;
+            std::atomic<uint64_t>              published_;
+            std::atomic<uint64_t>              truncated_;
+
+        public: // Constructor(s) / Destructor
+
+            Ring (const Ring&) = delete;
+            Ring (const Ring&&) = delete;
+            Ring();
+            virtual ~Ring();
+
+        public: // Method(s) // Function(s)
+
+            void Open    (const std::string& a_uri, const size_t a_slots, const size_t a_slot_size, const int a_epoll_fd);
+            void Close   ();
+            bool Owns    (const int a_fd);
+            void OnEvent (const int a_fd, const uint32_t a_events);
+            void Publish (const Stream::Event& a_event);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True when listening.
+             */
+            inline bool IsOpen () const
+            {
+                return -1 != fd_;
+            }
+
+            /**
+             * @return True when listening with these settings.
+             */
+            inline bool Matches (const std::string& a_uri, const size_t a_slots, const size_t a_slot_size) const
+            {
+                return IsOpen() && uri_ == a_uri && slots_ == a_slots && slot_size_ == a_slot_size;
+            }
+
+            /**
+             * @return Number of connected readers.
+             */
+            inline size_t count () const
+            {
+                return count_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of frames published.
+             */
+            inline uint64_t published () const
+            {
+                return published_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of frames whose strings were cut to fit a slot.
+             */
+            inline uint64_t truncated () const
+            {
+                return truncated_.load(std::memory_order_relaxed);
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Accept  ();
+            void Remove  (const int a_fd);
+
+        }; // end of class 'Ring'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_RING_H_
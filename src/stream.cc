@@ -0,0 +1,388 @@
+/**
+ * @file stream.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream.h"
+
+#include <vector>
+
+#include "exception.h"
+
+#include <string.h> // strerror, strlen, memset
+#include <errno.h>
+#include <stdio.h>  // snprintf
+#include <time.h>   // clock_gettime
+#include <unistd.h> // close, unlink
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h> // IN_ISDIR
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Stream::Stream ()
+{
+    fd_           = -1;
+    epoll_fd_     = -1;
+    format_       = Stream::Format::_Binary;
+    capacity_     = STREAM_DEFAULT_CAPACITY;
+    policy_       = Stream::Policy::_Drop;
+    sequence_     = 0;
+    count_        = 0;
+    published_    = 0;
+    dropped_      = 0;
+    disconnected_ = 0;
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Stream::~Stream ()
+{
+    Close();
+}
+
+/**
+ * @brief Start listening.
+ *
+ * @param a_uri      Unix socket path, replaced if it exists.
+ * @param a_format   One of \link Stream::Format \link.
+ * @param a_capacity Maximum number of frames queued per subscriber.
+ * @param a_policy   One of \link Stream::Policy \link, applied when a subscriber's queue is full.
+ * @param a_epoll_fd epoll instance listening and subscribers sockets are registered with.
+ */
+void casper::inotify::Stream::Open (const std::string& a_uri, const Stream::Format a_format, const size_t a_capacity, const Stream::Policy a_policy,
+                                    const int a_epoll_fd)
+{
+    Close();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if ( a_uri.length() >= sizeof(address.sun_path) ) {
+        throw inotify::Exception("Stream socket path '%s' is too long!", a_uri.c_str());
+    }
+    strncpy(address.sun_path, a_uri.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ( fd < 0 ) {
+        throw inotify::Exception("An error occurred while creating stream socket: %d - %s", errno, strerror(errno));
+    }
+    // ... left behind by a previous instance?
+    (void)unlink(a_uri.c_str());
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    if ( 0 != bind(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) || 0 != listen(fd, 64)
+        || 0 != epoll_ctl(a_epoll_fd, EPOLL_CTL_ADD, fd, &ev) ) {
+        const int no = errno;
+        close(fd);
+        throw inotify::Exception("An error occurred while listening on stream socket '%s': %d - %s", a_uri.c_str(), no, strerror(no));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    fd_       = fd;
+    epoll_fd_ = a_epoll_fd;
+    uri_      = a_uri;
+    format_   = a_format;
+    capacity_ = a_capacity;
+    policy_   = a_policy;
+}
+
+/**
+ * @brief Disconnect all subscribers and stop listening.
+ */
+void casper::inotify::Stream::Close ()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for ( auto& it : subscribers_ ) {
+        close(it.first);
+    }
+    subscribers_.clear();
+    count_ = 0;
+    if ( -1 != fd_ ) {
+        close(fd_);
+        (void)unlink(uri_.c_str());
+        fd_ = -1;
+    }
+    epoll_fd_ = -1;
+    uri_      = "";
+}
+
+/**
+ * @return True when a file descriptor is the listening socket or a subscriber's.
+ *
+ * @param a_fd File descriptor reported by epoll.
+ */
+bool casper::inotify::Stream::Owns (const int a_fd)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ( -1 != fd_ && ( a_fd == fd_ || subscribers_.end() != subscribers_.find(a_fd) ) );
+}
+
+/**
+ * @brief Accept subscribers, flush their queues or forget them when they hang up.
+ *
+ * @param a_fd     Listening or subscriber socket.
+ * @param a_events epoll events.
+ */
+void casper::inotify::Stream::OnEvent (const int a_fd, const uint32_t a_events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( a_fd == fd_ ) {
+        Accept();
+        return;
+    }
+    const auto it = subscribers_.find(a_fd);
+    if ( subscribers_.end() == it ) {
+        return;
+    }
+    if ( 0 != ( a_events & ( EPOLLERR | EPOLLHUP | EPOLLRDHUP ) ) ) {
+        Remove(a_fd);
+        return;
+    }
+    // ... subscribers are not expected to send anything ...
+    if ( 0 != ( a_events & EPOLLIN ) ) {
+        char buffer[256];
+        ssize_t rv;
+        while ( ( rv = recv(a_fd, buffer, sizeof(buffer), MSG_DONTWAIT) ) > 0 ) {
+            /* discarded */
+        }
+        if ( 0 == rv || ( rv < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno ) ) {
+            Remove(a_fd);
+            return;
+        }
+    }
+    if ( 0 != ( a_events & EPOLLOUT ) && false == Flush(a_fd, it->second) ) {
+        Remove(a_fd);
+    }
+}
+
+/**
+ * @brief Send an event to all subscribers.
+ *
+ * @param a_event Event to send, encoded once.
+ */
+void casper::inotify::Stream::Publish (const Stream::Event& a_event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ( -1 == fd_ || true == subscribers_.empty() ) {
+        return;
+    }
+    ++sequence_;
+    Encode(a_event);
+    published_.fetch_add(1, std::memory_order_relaxed);
+    std::vector<int> gone;
+    for ( auto& it : subscribers_ ) {
+        Subscriber& subscriber = it.second;
+        // ... straight to the socket, unless older frames are waiting ...
+        if ( true == subscriber.queue_.empty() ) {
+            if ( send(it.first, frame_.data(), frame_.length(), MSG_DONTWAIT | MSG_NOSIGNAL) >= 0 ) {
+                continue;
+            }
+            if ( EAGAIN != errno && EWOULDBLOCK != errno ) {
+                gone.push_back(it.first);
+                continue;
+            }
+        }
+        // ... too slow?
+        if ( subscriber.queue_.size() >= capacity_ ) {
+            if ( Stream::Policy::_Disconnect == policy_ ) {
+                disconnected_.fetch_add(1, std::memory_order_relaxed);
+                gone.push_back(it.first);
+            } else {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        subscriber.queue_.push_back(frame_);
+        if ( false == subscriber.armed_ ) {
+            Watch(it.first, subscriber, /* a_writable */ true);
+        }
+    }
+    for ( const int fd : gone ) {
+        Remove(fd);
+    }
+}
+
+/**
+ * @brief Fill a binary frame header.
+ *
+ * @param a_event    Event to describe.
+ * @param a_sequence Frame sequence.
+ * @param o_header   Header to fill, strings lengths included.
+ */
+void casper::inotify::Stream::Describe (const Stream::Event& a_event, const uint64_t a_sequence, StreamFrame& o_header)
+{
+    const char* const parent   = ( nullptr != a_event.parent_ ? a_event.parent_ : "" );
+    const char* const old_name = ( nullptr != a_event.old_name_ ? a_event.old_name_ : "" );
+    struct timespec now;
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    memset(&o_header, 0, sizeof(o_header));
+    o_header.version_         = STREAM_FRAME_VERSION;
+    o_header.flags_           = ( true == a_event.inside_ ? STREAM_FLAG_INSIDE : 0 ) | ( 0 != ( a_event.mask_ & IN_ISDIR ) ? STREAM_FLAG_DIRECTORY : 0 );
+    o_header.mask_            = a_event.mask_;
+    o_header.sequence_        = a_sequence;
+    o_header.timestamp_       = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    o_header.entry_length_    = static_cast<uint16_t>(strnlen(a_event.entry_, UINT16_MAX));
+    o_header.parent_length_   = static_cast<uint16_t>(strnlen(parent, UINT16_MAX));
+    o_header.name_length_     = static_cast<uint16_t>(strnlen(a_event.name_, UINT16_MAX));
+    o_header.old_name_length_ = static_cast<uint16_t>(strnlen(old_name, UINT16_MAX));
+    o_header.length_          = static_cast<uint32_t>(sizeof(o_header) + o_header.entry_length_ + o_header.parent_length_ + o_header.name_length_ + o_header.old_name_length_);
+}
+
+// MARK: -
+
+/**
+ * @brief Accept all pending subscribers, must be called while locked.
+ */
+void casper::inotify::Stream::Accept ()
+{
+    int fd;
+    while ( ( fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) ) >= 0 ) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if ( 0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) ) {
+            close(fd);
+            continue;
+        }
+        subscribers_[fd] = { std::deque<std::string>(), false };
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Send queued frames, must be called while locked.
+ *
+ * @param a_fd         Subscriber socket.
+ * @param a_subscriber Subscriber.
+ *
+ * @return False when subscriber is gone.
+ */
+bool casper::inotify::Stream::Flush (const int a_fd, Stream::Subscriber& a_subscriber)
+{
+    while ( false == a_subscriber.queue_.empty() ) {
+        const std::string& frame = a_subscriber.queue_.front();
+        if ( send(a_fd, frame.data(), frame.length(), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 ) {
+            return ( EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno );
+        }
+        a_subscriber.queue_.pop_front();
+    }
+    // ... drained, stop waiting for EPOLLOUT if it was waited for ...
+    if ( true == a_subscriber.armed_ ) {
+        Watch(a_fd, a_subscriber, /* a_writable */ false);
+    }
+    return true;
+}
+
+/**
+ * @brief Start or stop waiting for a subscriber's socket to be writable, must be called while locked.
+ *
+ * @param a_fd         Subscriber socket.
+ * @param a_subscriber Subscriber.
+ * @param a_writable   True to wait for EPOLLOUT.
+ */
+void casper::inotify::Stream::Watch (const int a_fd, Stream::Subscriber& a_subscriber, const bool a_writable)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN | EPOLLRDHUP | ( true == a_writable ? static_cast<uint32_t>(EPOLLOUT) : 0 );
+    ev.data.fd = a_fd;
+    (void)epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, a_fd, &ev);
+    a_subscriber.armed_ = a_writable;
+}
+
+/**
+ * @brief Disconnect a subscriber, must be called while locked.
+ *
+ * @param a_fd Subscriber socket.
+ */
+void casper::inotify::Stream::Remove (const int a_fd)
+{
+    // ... closing it also removes it from epoll ...
+    close(a_fd);
+    subscribers_.erase(a_fd);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Encode an event into \link Stream::frame_ \link, must be called while locked.
+ *
+ * @param a_event Event to encode.
+ */
+void casper::inotify::Stream::Encode (const Stream::Event& a_event)
+{
+    const char* const parent   = ( nullptr != a_event.parent_ ? a_event.parent_ : "" );
+    const char* const old_name = ( nullptr != a_event.old_name_ ? a_event.old_name_ : "" );
+    frame_.clear();
+    if ( Stream::Format::_Binary == format_ ) {
+        StreamFrame header;
+        Describe(a_event, sequence_, header);
+        frame_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        frame_.append(a_event.entry_, header.entry_length_);
+        frame_.append(parent, header.parent_length_);
+        frame_.append(a_event.name_, header.name_length_);
+        frame_.append(old_name, header.old_name_length_);
+        return;
+    }
+    // ... JSON ...
+    const auto string = [this] (const char* a_value) {
+        frame_.append(1, '"');
+        for ( ; '\0' != *a_value ; ++a_value ) {
+            const unsigned char c = static_cast<unsigned char>(*a_value);
+            if ( '"' == c || '\\' == c ) {
+                frame_.append(1, '\\').append(1, static_cast<char>(c));
+            } else if ( c < 0x20 ) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                frame_.append(escaped);
+            } else {
+                frame_.append(1, static_cast<char>(c));
+            }
+        }
+        frame_.append(1, '"');
+    };
+    frame_.append("{\"sequence\":").append(std::to_string(sequence_));
+    frame_.append(",\"datetime\":");
+    string(a_event.datetime_);
+    frame_.append(",\"mask\":").append(std::to_string(a_event.mask_));
+    frame_.append(",\"event\":");
+    string(a_event.event_);
+    frame_.append(",\"directory\":").append(0 != ( a_event.mask_ & IN_ISDIR ) ? "true" : "false");
+    frame_.append(",\"entry\":");
+    string(a_event.entry_);
+    frame_.append(",\"parent\":");
+    if ( nullptr != a_event.parent_ ) {
+        string(a_event.parent_);
+    } else {
+        frame_.append("null");
+    }
+    frame_.append(",\"name\":");
+    string(a_event.name_);
+    frame_.append(",\"old_name\":");
+    if ( nullptr != a_event.old_name_ ) {
+        string(a_event.old_name_);
+    } else {
+        frame_.append("null");
+    }
+    frame_.append("}\n");
+}
@@ -0,0 +1,204 @@
+/**
+ * @file stream.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_STREAM_H_
+#define CASPER_INOTIFY_STREAM_H_
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint16_t, uint32_t, uint64_t
+
+#define STREAM_FRAME_VERSION     1
+#define STREAM_FLAG_INSIDE       0x0001 //!< Object is inside the watched directory.
+#define STREAM_FLAG_DIRECTORY    0x0002 //!< Object is a directory.
+#define STREAM_FLAG_TRUNCATED    0x0004 //!< Strings were cut to fit, see \link Ring \link.
+#define STREAM_DEFAULT_CAPACITY  1024
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Binary frame header, in host byte order; it's followed by the entry URI, parent, name and
+         *        old name, in this order and not NUL terminated.
+         */
+        typedef struct {
+            uint32_t length_;          //!< Whole frame, header included.
+            uint16_t version_;         //!< STREAM_FRAME_VERSION.
+            uint16_t flags_;           //!< STREAM_FLAG_*.
+            uint32_t mask_;            //!< inotify(7) event mask.
+            uint32_t reserved_;
+            uint64_t sequence_;        //!< Per stream, a gap means frames were dropped for this subscriber.
+            uint64_t timestamp_;       //!< Nanoseconds since epoch.
+            uint16_t entry_length_;    //!< Configured entry URI.
+            uint16_t parent_length_;   //!< Directory object is in, 0 when event is for the watched object itself.
+            uint16_t name_length_;     //!< Object name, or path for the watched object itself.
+            uint16_t old_name_length_; //!< Full path before a rename, 0 if none.
+        } StreamFrame;
+
+        /**
+         * @brief Fan events out to any number of subscribers connected to a SOCK_SEQPACKET unix socket, one
+         *        event per message.
+         *
+         * Publishing never blocks: each subscriber has a bounded queue of frames its socket could not take
+         * yet, flushed when it becomes writable; when full, frames are dropped or the subscriber disconnected.
+         * Subscribers are accepted and flushed by whoever polls the epoll instance given to \link Stream::Open \link.
+         */
+        class Stream final
+        {
+
+        public: // Enum(s)
+
+            typedef enum {
+                _Binary = 0, //!< \link StreamFrame \link followed by strings.
+                _JSON        //!< One JSON object per message, newline terminated.
+            } Format;
+
+            typedef enum {
+                _Drop = 0,   //!< Drop new frames while queue is full.
+                _Disconnect  //!< Disconnect subscribers whose queue is full.
+            } Policy;
+
+        public: // Data Type(s)
+
+            typedef struct {
+                uint32_t          mask_;
+                bool              inside_;   //!< True when event is for an object inside a watched directory.
+                const char*       event_;    //!< Actions names.
+                const char*       entry_;
+                const char*       parent_;   //!< nullptr when event is for the watched object itself.
+                const char*       name_;
+                const char*       old_name_; //!< nullptr when not renamed.
+                const char*       datetime_; //!< ISO 8601, as logged.
+            } Event;
+
+        private: // Data Type(s)
+
+            typedef struct {
+                std::deque<std::string> queue_; //!< Frames waiting for the socket to be writable.
+                bool                    armed_; //!< True while waiting for EPOLLOUT.
+            } Subscriber;
+
+        private: // Data
+
+            std::mutex                              mutex_;        //!< Protects everything but counters, publishers are shards threads.
+            int                                     fd_;           //!< Listening socket, -1 when closed.
+            int                                     epoll_fd_;
+            std::string                             uri_;
+            Format                                  format_;
+            size_t                                  capacity_;
+            Policy                                  policy_;
+            std::unordered_map<int, Subscriber>     subscribers_;  //!< By socket.
+            uint64_t                                sequence_;
+            std::string                             frame_;        //!< Reusable buffer.
+            std::atomic<size_t>                     count_;
+            std::atomic<uint64_t>                   published_;
+            std::atomic<uint64_t>                   dropped_;
+            std::atomic<uint64_t>                   disconnected_;
+
+        public: // Constructor(s) / Destructor
+
+            Stream (const Stream&) = delete;
+            Stream (const Stream&&) = delete;
+            Stream();
+            virtual ~Stream();
+
+        public: // Method(s) // Function(s)
+
+            void Open    (const std::string& a_uri, const Format a_format, const size_t a_capacity, const Policy a_policy, const int a_epoll_fd);
+            void Close   ();
+            bool Owns    (const int a_fd);
+            void OnEvent (const int a_fd, const uint32_t a_events);
+            void Publish (const Event& a_event);
+
+            static void Describe (const Event& a_event, const uint64_t a_sequence, StreamFrame& o_header);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True when listening.
+             */
+            inline bool IsOpen () const
+            {
+                return -1 != fd_;
+            }
+
+            /**
+             * @return True when listening with these settings.
+             */
+            inline bool Matches (const std::string& a_uri, const Format a_format, const size_t a_capacity, const Policy a_policy) const
+            {
+                return IsOpen() && uri_ == a_uri && format_ == a_format && capacity_ == a_capacity && policy_ == a_policy;
+            }
+
+            /**
+             * @return Number of subscribers.
+             */
+            inline size_t count () const
+            {
+                return count_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of frames published.
+             */
+            inline uint64_t published () const
+            {
+                return published_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of frames dropped, all subscribers.
+             */
+            inline uint64_t dropped () const
+            {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @return Number of subscribers disconnected for being too slow.
+             */
+            inline uint64_t disconnected () const
+            {
+                return disconnected_.load(std::memory_order_relaxed);
+            }
+
+        private: // Method(s) // Function(s)
+
+            void Accept  ();
+            bool Flush   (const int a_fd, Subscriber& a_subscriber);
+            void Watch   (const int a_fd, Subscriber& a_subscriber, const bool a_writable);
+            void Remove  (const int a_fd);
+            void Encode  (const Event& a_event);
+
+        }; // end of class 'Stream'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_STREAM_H_
@@ -0,0 +1,104 @@
+/**
+ * @file template.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "template.h"
+
+#include <string.h> // strlen, strncmp
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::Template::Template ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::Template::~Template ()
+{
+    /* empty */
+}
+
+/**
+ * @brief Parse a string into a list of literals and variable slots.
+ *
+ * @param a_source String to parse.
+ * @param a_names  Known variables names, slot is the index in this array.
+ * @param a_count  Number of known variables.
+ *
+ * @note Unknown ${NAME} placeholders are kept as literals.
+ */
+void casper::inotify::Template::Compile (const std::string& a_source, const char* const* a_names, const size_t a_count)
+{
+    source_ = a_source;
+    tokens_.clear();
+    // ...
+    size_t literal = 0;
+    size_t idx     = 0;
+    while ( std::string::npos != ( idx = source_.find("${", idx) ) ) {
+        const size_t end = source_.find('}', idx + 2);
+        if ( std::string::npos == end ) {
+            break;
+        }
+        const size_t length = end - idx - 2;
+        int          slot   = -1;
+        for ( size_t n = 0 ; n < a_count ; ++n ) {
+            if ( length == strlen(a_names[n]) && 0 == source_.compare(idx + 2, length, a_names[n]) ) {
+                slot = static_cast<int>(n);
+                break;
+            }
+        }
+        if ( -1 == slot ) {
+            // ... unknown, keep it as part of the literal ...
+            idx += 2;
+            continue;
+        }
+        if ( idx > literal ) {
+            tokens_.push_back({ literal, idx - literal, -1 });
+        }
+        tokens_.push_back({ 0, 0, slot });
+        idx     = end + 1;
+        literal = idx;
+    }
+    if ( literal < source_.length() ) {
+        tokens_.push_back({ literal, source_.length() - literal, -1 });
+    }
+}
+
+/**
+ * @brief Render this template.
+ *
+ * @param a_values Variables values, indexed by slot, nullptr is rendered as an empty string.
+ * @param o_buffer Buffer to render to, it's contents are replaced but it's capacity is reused.
+ */
+void casper::inotify::Template::Render (const char* const* a_values, std::string& o_buffer) const
+{
+    o_buffer.clear();
+    for ( const auto& token : tokens_ ) {
+        if ( -1 == token.slot_ ) {
+            o_buffer.append(source_, token.offset_, token.length_);
+        } else if ( nullptr != a_values[token.slot_] ) {
+            o_buffer.append(a_values[token.slot_]);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * @file template.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_TEMPLATE_H_
+#define CASPER_INOTIFY_TEMPLATE_H_
+
+#include <string>
+#include <vector>
+
+#include <stddef.h> // size_t
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief A string with ${NAME} placeholders, parsed once and rendered in a single pass.
+         */
+        class Template final
+        {
+
+        private: // Data Type(s)
+
+            typedef struct {
+                size_t offset_; //!< Literal offset in source.
+                size_t length_; //!< Literal length.
+                int    slot_;   //!< Variable slot, -1 for literals.
+            } Token;
+
+        private: // Data
+
+            std::string        source_;
+            std::vector<Token> tokens_;
+
+        public: // Constructor(s) / Destructor
+
+            Template();
+            virtual ~Template();
+
+        public: // Method(s) // Function(s)
+
+            void Compile (const std::string& a_source, const char* const* a_names, const size_t a_count);
+            void Render  (const char* const* a_values, std::string& o_buffer) const;
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return Original, non-rendered, value.
+             */
+            inline const std::string& source () const
+            {
+                return source_;
+            }
+
+        }; // end of class 'Template'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_TEMPLATE_H_
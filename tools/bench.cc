@@ -0,0 +1,701 @@
+/**
+ * @file bench.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @brief Cost of daemon hot paths, measured in process, one mode per run:
+ *
+ *     g++ -std=c++11 -O2 -Isrc -Itools -I/usr/include/jsoncpp tools/bench.cc tools/ring_reader.cc $(find src -name '*.cc' ! -name main.cc) -ljsoncpp -lpthread -ldl -o bench
+ *     ./bench lookup [lookups]   - watch descriptor to watched entries, at 1k, 100k and 1M watches
+ *     ./bench render [renders]   - command and message of an event
+ *     ./bench launch [launches] [rss MB] - command processes per second, from a process of a given size
+ *     ./bench latency [events]   - from a file being created to it's event being dispatched, by a running API::Watch
+ *     ./bench now [calls]        - event and log lines timestamps
+ *     ./bench rotate [files]     - deletes and creates again watched files, all must be re-armed, by a running API::Watch
+ */
+
+#include "api.h"
+#include "ring_reader.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+
+#include "exception.h"
+
+#include <stdio.h>
+#include <stdlib.h> // strtoull
+#include <string.h> // strcmp, strerror
+#include <unistd.h> // fork, execle, getdtablesize
+#include <grp.h>    // initgroups
+#include <pwd.h>    // getpwnam
+#include <errno.h>
+#include <fcntl.h>  // open
+#include <signal.h>
+
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <sys/stat.h> // mkdir
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Runs daemon code paths as the daemon would, without it's event loop.
+         */
+        class Bench final
+        {
+
+        private: // Static Data
+
+            static volatile uintptr_t s_sink_; //!< Results are stored here, so they are not optimized away.
+
+        private: // Static Method(s) / Function(s)
+
+            /**
+             * @brief xorshift64, a cheap deterministic sequence, so every run probes the same keys.
+             */
+            static uint64_t Next (uint64_t& a_state)
+            {
+                a_state ^= a_state << 13;
+                a_state ^= a_state >> 7;
+                a_state ^= a_state << 17;
+                return a_state;
+            }
+
+            /**
+             * @brief Replace all occurrences of a string, as API::Spawn did for each variable before templates.
+             */
+            static std::string Replace (std::string a_value, const std::string& a_from, const std::string& a_to)
+            {
+                size_t start_pos = 0;
+                while ( std::string::npos != ( start_pos = a_value.find(a_from, start_pos) ) ) {
+                    a_value.replace(start_pos, a_from.length(), a_to);
+                    start_pos += a_to.length();
+                }
+                return a_value;
+            }
+
+            /**
+             * @brief Render an entry's message and command as API::Spawn did before templates: a map of variables,
+             *        then one scan per variable per string.
+             */
+            static void Replace (const API::Entry& a_entry, const char* const* a_vars, std::string& o_msg, std::string& o_cmd)
+            {
+                std::map<const char* const, std::string> values;
+                for ( size_t idx = 0 ; idx < API::Variable::_VariablesCount ; ++idx ) {
+                    values[API::sk_variables_[idx]] = a_vars[idx];
+                }
+                const std::map<const std::string*, std::string*> strings = { { &a_entry.cmd_, &o_cmd }, { &a_entry.msg_, &o_msg } };
+                for ( auto it : strings ) {
+                    (*it.second) = *it.first;
+                    for ( auto it2 : values ) {
+                        (*it.second) = Replace((*it.second), ( "${" + std::string(it2.first) + "}" ), it2.second);
+                    }
+                }
+            }
+
+        public: // Static Method(s) / Function(s)
+
+            /**
+             * @brief API::Lookup against the std::map<int, ...> it replaced, with watch descriptors
+             *        allocated as the kernel does ( 1, 2, ... ) and probed in random order.
+             *
+             * @param a_lookups Number of lookups per table size.
+             */
+            static void Lookup (const uint64_t a_lookups)
+            {
+                API api;
+                for ( const size_t count : { static_cast<size_t>(1000), static_cast<size_t>(100000), static_cast<size_t>(1000000) } ) {
+                    API::Shard*                shard = new API::Shard();
+                    std::map<int, API::Group*> map;
+                    shard->watches_.resize(count + 1, nullptr);
+                    for ( size_t wd = 1 ; wd <= count ; ++wd ) {
+                        API::Group* group = new API::Group();
+                        group->mask_    = 0;
+                        group->ignored_ = false;
+                        shard->watches_[wd]       = group;
+                        map[static_cast<int>(wd)] = group;
+                    }
+                    // ... same keys for both ...
+                    std::vector<int> keys(64 * 1024);
+                    uint64_t         state = 0x9E3779B97F4A7C15ULL;
+                    for ( auto& key : keys ) {
+                        key = static_cast<int>(1 + Next(state) % count);
+                    }
+                    const size_t mask = keys.size() - 1;
+                    // ... dense table ...
+                    auto start = std::chrono::steady_clock::now();
+                    for ( uint64_t n = 0 ; n < a_lookups ; ++n ) {
+                        s_sink_ = s_sink_ + reinterpret_cast<uintptr_t>(api.Lookup(*shard, keys[n & mask]));
+                    }
+                    const double table = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    // ... tree ...
+                    start = std::chrono::steady_clock::now();
+                    for ( uint64_t n = 0 ; n < a_lookups ; ++n ) {
+                        const auto it = map.find(keys[n & mask]);
+                        s_sink_ = s_sink_ + reinterpret_cast<uintptr_t>(map.end() != it ? it->second : nullptr);
+                    }
+                    const double tree = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    printf("%8zu watches: Lookup %6.1f ns, std::map %6.1f ns\n", count,
+                           table * 1e9 / static_cast<double>(a_lookups), tree * 1e9 / static_cast<double>(a_lookups)
+                    );
+                    for ( auto group : shard->watches_ ) {
+                        delete group;
+                    }
+                    delete shard;
+                }
+            }
+
+            /**
+             * @brief Entry templates, compiled as API::Add does and rendered as API::Spawn does, against the
+             *        per variable Replace loop they replaced.
+             *
+             * @param a_renders Number of events rendered by each.
+             */
+            static void Render (const uint64_t a_renders)
+            {
+                API::Entry entry(API::Type::_Directory, "/srv/uploads/incoming", IN_ALL_EVENTS, "root",
+                                 "/usr/local/bin/on-upload --event \"${CASPER_INOTIFY_EVENT}\" --file \"${CASPER_INOTIFY_PARENT_NAME}/${CASPER_INOTIFY_NAME}\""
+                                 " --at \"${CASPER_INOTIFY_DATETIME}\" --host ${CASPER_INOTIFY_HOSTNAME} --msg \"${CASPER_INOTIFY_MSG}\"",
+                                 "${CASPER_INOTIFY_OBJECT} ${CASPER_INOTIFY_NAME} was ${CASPER_INOTIFY_EVENT}"
+                );
+                entry.cmd_tpl_.Compile(entry.cmd_, API::sk_variables_, API::Variable::_VariablesCount);
+                entry.msg_tpl_.Compile(entry.msg_, API::sk_variables_, API::Variable::_VariablesCount);
+                const char* vars[API::Variable::_VariablesCount];
+                vars[API::Variable::_EventVar]      = "created, close_write";
+                vars[API::Variable::_ObjectVar]     = "file";
+                vars[API::Variable::_NameVar]       = "report-2026-10-16.csv";
+                vars[API::Variable::_ParentNameVar] = "/srv/uploads/incoming";
+                vars[API::Variable::_OldNameVar]    = "";
+                vars[API::Variable::_DateTimeVar]   = "2026-10-16T02:20:00+00:00";
+                vars[API::Variable::_HostNameVar]   = "build-01";
+                vars[API::Variable::_MsgVar]        = entry.msg_.c_str();
+                vars[API::Variable::_CmdVar]        = entry.cmd_.c_str();
+                // ... templates, into reused buffers ...
+                std::string msg;
+                std::string cmd;
+                auto start = std::chrono::steady_clock::now();
+                for ( uint64_t n = 0 ; n < a_renders ; ++n ) {
+                    entry.msg_tpl_.Render(vars, msg);
+                    vars[API::Variable::_MsgVar] = msg.c_str();
+                    entry.cmd_tpl_.Render(vars, cmd);
+                    vars[API::Variable::_MsgVar] = entry.msg_.c_str();
+                    s_sink_ = s_sink_ + cmd.length();
+                }
+                const double compiled = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                // ... as it was done before ...
+                std::string old_msg;
+                std::string old_cmd;
+                start = std::chrono::steady_clock::now();
+                for ( uint64_t n = 0 ; n < a_renders ; ++n ) {
+                    Replace(entry, vars, old_msg, old_cmd);
+                    s_sink_ = s_sink_ + old_cmd.length();
+                }
+                const double replaced = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                // ... ${CASPER_INOTIFY_MSG} used to be the message source, it's now the rendered message ...
+                vars[API::Variable::_MsgVar] = msg.c_str();
+                Replace(entry, vars, old_msg, old_cmd);
+                printf("%s\n", cmd.c_str());
+                printf("Template::Render %7.1f ns/event, Replace loop %7.1f ns/event, same output: %s\n",
+                       compiled * 1e9 / static_cast<double>(a_renders), replaced * 1e9 / static_cast<double>(a_renders),
+                       ( cmd == old_cmd && msg == old_msg ) ? "yes" : "no"
+                );
+            }
+
+            /**
+             * @brief Format current time as API::Now did before it cached it: clock, gmtime_r(3) and snprintf(3) on every call.
+             */
+            static const char* Stamp (char* a_buffer)
+            {
+                const auto now = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+                time_t tt = (time_t)now;
+                tm     utc_tm;
+                if ( &utc_tm != gmtime_r(&tt, &utc_tm) ) {
+                    throw inotify::Exception("Unable to convert epoch to human readable time!");
+                }
+                const int w = snprintf(a_buffer, 26, "%04u-%02u-%02uT%02u:%02u:%02u+%02u:%02u",
+                                       static_cast<unsigned>(utc_tm.tm_year + 1900), static_cast<unsigned>(utc_tm.tm_mon + 1), static_cast<unsigned>(utc_tm.tm_mday),
+                                       static_cast<unsigned>(utc_tm.tm_hour), static_cast<unsigned>(utc_tm.tm_min), static_cast<unsigned>(utc_tm.tm_sec),
+                                       0, 0
+                );
+                if ( w <= 0 || w > 25 ) {
+                    throw inotify::Exception("Unable to convert epoch to ISO8601WithTZ!");
+                }
+                return a_buffer;
+            }
+
+            /**
+             * @brief Launch a command as API::Spawn did before API::Launch: fork(2), close every possible
+             *        descriptor, resolve and set credentials, set environment and exec /bin/sh ( API_DEFAULT_SHELL ).
+             */
+            static pid_t Fork (const API& a_api, const std::string& a_user, const std::string& a_cmd, const std::vector<std::string>& a_env)
+            {
+                const pid_t pid = fork();
+                if ( 0 != pid ) {
+                    return pid;
+                }
+                const int max = getdtablesize();
+                for ( int n = 3; n < max; n++ ) {
+                    close(n);
+                }
+                setsid();
+                sigprocmask(SIG_UNBLOCK, &a_api.reactor_.signals_, nullptr);
+                struct passwd* pwd = getpwnam(a_user.c_str());
+                if ( nullptr == pwd || 0 != setgid(pwd->pw_gid) || 0 != initgroups(a_user.c_str(), pwd->pw_gid)
+                    || 0 != setuid(pwd->pw_uid) || 0 != clearenv() ) {
+                    _exit(127);
+                }
+                for ( const auto& var : a_env ) {
+                    const size_t eq = var.find('=');
+                    if ( 0 != setenv(var.substr(0, eq).c_str(), var.c_str() + eq + 1, 1) ) {
+                        _exit(127);
+                    }
+                }
+                execl("/bin/sh", "/bin/sh", "-c", a_cmd.c_str(), (char*)nullptr);
+                _exit(127);
+            }
+
+            /**
+             * @brief Wait for a launched command, it must have succeeded.
+             */
+            static void Wait (const pid_t a_pid, const char* const a_how)
+            {
+                int status = -1;
+                if ( a_pid < 0 ) {
+                    throw inotify::Exception("%s failed: %d - %s", a_how, errno, strerror(errno));
+                }
+                while ( -1 == waitpid(a_pid, &status, 0) && EINTR == errno ) {
+                    /* retry */
+                }
+                if ( false == WIFEXITED(status) || 0 != WEXITSTATUS(status) ) {
+                    throw inotify::Exception("%s: command exited with status %d", a_how, status);
+                }
+            }
+
+            /**
+             * @brief API::Launch against the fork(2) based launch it replaced, from a process whose resident memory
+             *        was grown to a given size, as a daemon's is by it's buffers and entries.
+             *
+             * @param a_launches Number of commands launched by each, one at a time.
+             * @param a_rss_mb   Memory to allocate and touch before launching, in MB.
+             */
+            static void Launch (const uint64_t a_launches, const size_t a_rss_mb)
+            {
+                API api;
+                std::vector<char> ballast(a_rss_mb * 1024 * 1024);
+                for ( size_t offset = 0 ; offset < ballast.size() ; offset += 4096 ) {
+                    ballast[offset] = 1;
+                }
+                const API::Credentials* credentials = api.Resolve("root");
+                if ( 0 != credentials->error_.length() ) {
+                    throw inotify::Exception("%s", credentials->error_.c_str());
+                }
+                const std::string        cmd = ":";
+                std::vector<std::string> env = {
+                    "PATH=/usr/bin:/usr/local/bin", "LOGNAME=root", "USER=root", "USERNAME=root", "HOME=/root", "SHELL=/bin/sh",
+                    "CASPER_INOTIFY_EVENT=created", "CASPER_INOTIFY_OBJECT=file", "CASPER_INOTIFY_NAME=report-2026-10-16.csv",
+                    "CASPER_INOTIFY_PARENT_NAME=/srv/uploads/incoming", "CASPER_INOTIFY_DATETIME=2026-10-16T02:20:00+00:00"
+                };
+                std::vector<char*> envp;
+                for ( auto& var : env ) {
+                    envp.push_back(const_cast<char*>(var.c_str()));
+                }
+                envp.push_back(nullptr);
+                // ... vfork(2), pre-resolved credentials and prebuilt environment ...
+                auto start = std::chrono::steady_clock::now();
+                for ( uint64_t n = 0 ; n < a_launches ; ++n ) {
+                    const char* what = nullptr;
+                    int         no   = 0;
+                    const pid_t pid  = api.Launch(*credentials, cmd, envp.data(), what, no);
+                    if ( pid < 0 ) {
+                        throw inotify::Exception("Launch failed, %s: %d - %s", what, no, strerror(no));
+                    }
+                    Wait(pid, "Launch");
+                }
+                const double launched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                // ... as it was done before ...
+                start = std::chrono::steady_clock::now();
+                for ( uint64_t n = 0 ; n < a_launches ; ++n ) {
+                    Wait(Fork(api, "root", cmd, env), "fork");
+                }
+                const double forked = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printf("%zu MB resident, %d descriptors limit\n", a_rss_mb, getdtablesize());
+                printf("API::Launch %7.0f commands/s, fork %7.0f commands/s\n",
+                       static_cast<double>(a_launches) / launched, static_cast<double>(a_launches) / forked
+                );
+            }
+
+            /**
+             * @brief Write a daemon configuration, block signals as main.cc does and load it.
+             *
+             * @param a_api  Instance to initialize.
+             * @param a_base Directory for configuration and log.
+             * @param a_json Configuration.
+             */
+            static void Start (API& a_api, const std::string& a_base, const std::string& a_json)
+            {
+                // ... blocked before any thread is started, they are handled on main loop ...
+                sigset_t signals;
+                sigemptyset(&signals);
+                for ( auto signal : { SIGUSR1, SIGQUIT, SIGTERM, SIGCHLD, SIGHUP } ) {
+                    sigaddset(&signals, signal);
+                }
+                if ( 0 != sigprocmask(SIG_BLOCK, &signals, nullptr) ) {
+                    throw inotify::Exception("Unable to block signals: %d - %s", errno, strerror(errno));
+                }
+                const std::string conf = a_base + "/conf.json";
+                FILE* file = fopen(conf.c_str(), "w");
+                if ( nullptr == file ) {
+                    throw inotify::Exception("Unable to create %s: %d - %s", conf.c_str(), errno, strerror(errno));
+                }
+                fwrite(a_json.data(), 1, a_json.length(), file);
+                fclose(file);
+                a_api.Init(API::LogLevel::_Event, a_base + "/events.log", signals);
+                a_api.Load(conf);
+            }
+
+            /**
+             * @brief Remove what \link Bench::Start \link and a ring sink left behind.
+             */
+            static void Clean (const std::string& a_base, const std::string& a_dir)
+            {
+                for ( const std::string name : { "/conf.json", "/ring.sock", "/events.log" } ) {
+                    (void)unlink(( a_base + name ).c_str());
+                }
+                (void)rmdir(a_dir.c_str());
+                (void)rmdir(a_base.c_str());
+            }
+
+            /**
+             * @brief Delay from a file being created to it's event being dispatched, by API::Watch running as the
+             *        daemon does, to a ring sink; a reader thread notes when each event shows up.
+             *
+             * @param a_events Number of files created, 1 to 10 ms apart, so events are not batched.
+             */
+            static void Latency (const size_t a_events)
+            {
+                // ... a directory entry whose events go to a ring ...
+                const std::string base = "/tmp/casper-inotify-bench-" + std::to_string(getpid());
+                const std::string dir  = base + "/w";
+                const std::string ring = base + "/ring.sock";
+                if ( 0 != mkdir(base.c_str(), 0700) || 0 != mkdir(dir.c_str(), 0700) ) {
+                    throw inotify::Exception("Unable to create %s: %d - %s", dir.c_str(), errno, strerror(errno));
+                }
+                API api;
+                Start(api, base, "{ \"sink\": \"ring\", \"ring\": { \"socket\": \"" + ring + "\" },"
+                                 "  \"directories\": [ { \"uri\": \"" + dir + "\", \"events\": [\"create\"] } ] }\n");
+                // ... when each file was created and when it's event was read ...
+                std::vector<std::chrono::steady_clock::time_point> created(a_events);
+                std::vector<std::chrono::steady_clock::time_point> seen(a_events);
+                std::atomic<bool>                                  connected(false);
+                std::thread reader([&] () {
+                    RingReader reader;
+                    while ( false == reader.IsConnected() ) {
+                        try {
+                            reader.Connect(ring);
+                        } catch (const inotify::Exception& a_e) {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        }
+                    }
+                    connected = true;
+                    size_t count = 0;
+                    while ( count < a_events && true == reader.Wait(1000) ) {
+                        const RingReader::Frame* frame;
+                        while ( nullptr != ( frame = reader.Peek() ) ) {
+                            const auto  now = std::chrono::steady_clock::now();
+                            std::string name(frame->name_, frame->header_.name_length_);
+                            const size_t slash = name.rfind('/');
+                            const size_t idx   = strtoull(name.c_str() + ( std::string::npos != slash ? slash + 2 : 1 ), nullptr, 10);
+                            if ( true == reader.Release() && idx < a_events ) {
+                                seen[idx] = now;
+                                count++;
+                            }
+                        }
+                    }
+                });
+                std::thread writer([&] () {
+                    while ( false == connected ) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                    std::mt19937 random(1);
+                    for ( size_t idx = 0 ; idx < a_events ; ++idx ) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(1000 + random() % 9000));
+                        const std::string uri = dir + "/f" + std::to_string(idx);
+                        created[idx] = std::chrono::steady_clock::now();
+                        const int fd = open(uri.c_str(), O_CREAT | O_WRONLY, 0600);
+                        if ( -1 != fd ) {
+                            close(fd);
+                        }
+                        (void)unlink(uri.c_str());
+                    }
+                    // ... reader gives up after one idle second ...
+                    reader.join();
+                    kill(getpid(), SIGTERM);
+                });
+                (void)api.Watch();
+                writer.join();
+                // ... report ...
+                std::vector<double> latency;
+                for ( size_t idx = 0 ; idx < a_events ; ++idx ) {
+                    if ( std::chrono::steady_clock::time_point() != seen[idx] ) {
+                        latency.push_back(std::chrono::duration<double, std::micro>(seen[idx] - created[idx]).count());
+                    }
+                }
+                Clean(base, dir);
+                if ( true == latency.empty() ) {
+                    throw inotify::Exception("No events were dispatched!");
+                }
+                std::sort(latency.begin(), latency.end());
+                printf("%zu/%zu events, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", latency.size(), a_events,
+                       latency[latency.size() / 2], latency[latency.size() * 9 / 10], latency[latency.size() * 99 / 100], latency.back()
+                );
+            }
+
+            /**
+             * @brief API::Now, in each of it's formats, against the formatting it replaced.
+             *
+             * @param a_calls Number of timestamps formatted by each.
+             */
+            static void Now (const uint64_t a_calls)
+            {
+                API  api;
+                char buffer[64];
+                // ... as it was done before ...
+                auto start = std::chrono::steady_clock::now();
+                for ( uint64_t n = 0 ; n < a_calls ; ++n ) {
+                    s_sink_ = s_sink_ + static_cast<uintptr_t>(Stamp(buffer)[18]);
+                }
+                const double before = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printf("%-32s %-32s %6.1f ns\n", "gmtime_r + snprintf", buffer, before * 1e9 / static_cast<double>(a_calls));
+                // ... cached, UTC or local offset, in seconds, milliseconds or microseconds ...
+                const struct {
+                    const char* name_;
+                    bool        local_;
+                    uint8_t     precision_;
+                } formats[] = {
+                    { "API::Now"                     , false, 0 },
+                    { "API::Now, milliseconds"       , false, 3 },
+                    { "API::Now, microseconds, local", true , 6 }
+                };
+                for ( const auto& format : formats ) {
+                    api.timestamp_.local_     = format.local_;
+                    api.timestamp_.precision_ = format.precision_;
+                    start = std::chrono::steady_clock::now();
+                    for ( uint64_t n = 0 ; n < a_calls ; ++n ) {
+                        s_sink_ = s_sink_ + static_cast<uintptr_t>(api.Now(buffer)[18]);
+                    }
+                    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    printf("%-32s %-32s %6.1f ns\n", format.name_, buffer, elapsed * 1e9 / static_cast<double>(a_calls));
+                }
+            }
+
+            /**
+             * @brief Rotate watched files, as a log rotation deleting them would: each one is deleted and created
+             *        again, so it's entry goes pending and it's directory helper ( \link API::Handler \link ) must
+             *        re-arm it. Events go to a ring sink, a reader thread counts the IN_CREATE each re-armed entry
+             *        is dispatched, then the IN_MODIFY of a write to every file, proving their new watches work.
+             *
+             * @param a_files Number of files, bounded by fs.inotify.max_user_watches.
+             */
+            static void Rotate (size_t a_files)
+            {
+                size_t limit = 0;
+                FILE*  file  = fopen("/proc/sys/fs/inotify/max_user_watches", "r");
+                if ( nullptr != file ) {
+                    unsigned long value = 0;
+                    if ( 1 == fscanf(file, "%lu", &value) ) {
+                        limit = static_cast<size_t>(value);
+                    }
+                    fclose(file);
+                }
+                // ... one watch per file, one for their directory and some room for anyone else ...
+                if ( 0 != limit && a_files + 1 + 64 > limit ) {
+                    const size_t files = ( limit > 65 ? limit - 65 : 0 );
+                    fprintf(stderr, "fs.inotify.max_user_watches is %zu, rotating %zu files instead of %zu\n", limit, files, a_files);
+                    a_files = files;
+                }
+                const std::string base = "/tmp/casper-inotify-bench-" + std::to_string(getpid());
+                const std::string dir  = base + "/w";
+                const std::string ring = base + "/ring.sock";
+                if ( 0 != mkdir(base.c_str(), 0700) || 0 != mkdir(dir.c_str(), 0700) ) {
+                    throw inotify::Exception("Unable to create %s: %d - %s", dir.c_str(), errno, strerror(errno));
+                }
+                std::string json = "{ \"sink\": \"ring\", \"ring\": { \"socket\": \"" + ring + "\", \"slots\": 262144 }, \"files\": [";
+                for ( size_t idx = 0 ; idx < a_files ; ++idx ) {
+                    const std::string uri = dir + "/f" + std::to_string(idx);
+                    const int fd = open(uri.c_str(), O_CREAT | O_WRONLY, 0600);
+                    if ( -1 == fd ) {
+                        throw inotify::Exception("Unable to create %s: %d - %s", uri.c_str(), errno, strerror(errno));
+                    }
+                    close(fd);
+                    json += ( 0 == idx ? "" : "," );
+                    json += "{ \"uri\": \"" + uri + "\", \"events\": [\"modify\"] }";
+                }
+                json += "] }\n";
+                API api;
+                Start(api, base, json);
+                // ... what reader saw, per file ...
+                std::vector<uint8_t> rearmed(a_files, 0);
+                std::vector<uint8_t> modified(a_files, 0);
+                std::atomic<size_t>  rearmed_count(0);
+                std::atomic<size_t>  modified_count(0);
+                std::atomic<bool>    connected(false);
+                std::atomic<bool>    done(false);
+                std::atomic<uint64_t> lost(0);
+                std::thread reader([&] () {
+                    RingReader reader;
+                    while ( false == reader.IsConnected() ) {
+                        try {
+                            reader.Connect(ring);
+                        } catch (const inotify::Exception& a_e) {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        }
+                    }
+                    connected = true;
+                    while ( false == done ) {
+                        (void)reader.Wait(100);
+                        const RingReader::Frame* frame;
+                        while ( nullptr != ( frame = reader.Peek() ) ) {
+                            const uint32_t    mask  = frame->header_.mask_;
+                            const std::string entry(frame->entry_, frame->header_.entry_length_);
+                            const size_t      idx   = strtoull(entry.c_str() + entry.rfind('/') + 2, nullptr, 10);
+                            if ( false == reader.Release() || idx >= a_files ) {
+                                continue;
+                            }
+                            if ( 0 != ( mask & IN_CREATE ) && 0 == rearmed[idx] ) {
+                                rearmed[idx] = 1;
+                                rearmed_count++;
+                            } else if ( 0 != ( mask & IN_MODIFY ) && 0 == modified[idx] ) {
+                                modified[idx] = 1;
+                                modified_count++;
+                            }
+                        }
+                    }
+                    lost = reader.lost();
+                });
+                // ... wait for a count to reach all files, or to stop moving for a few seconds ...
+                const auto settle = [&] (std::atomic<size_t>& a_count) {
+                    size_t last  = a_count;
+                    auto   moved = std::chrono::steady_clock::now();
+                    while ( a_count < a_files && std::chrono::steady_clock::now() - moved < std::chrono::seconds(3) ) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        if ( a_count != last ) {
+                            last  = a_count;
+                            moved = std::chrono::steady_clock::now();
+                        }
+                    }
+                };
+                double rotated_s = 0;
+                double rearmed_s = 0;
+                std::thread writer([&] () {
+                    while ( false == connected ) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+                    const auto start = std::chrono::steady_clock::now();
+                    for ( size_t idx = 0 ; idx < a_files ; ++idx ) {
+                        const std::string uri = dir + "/f" + std::to_string(idx);
+                        (void)unlink(uri.c_str());
+                        const int fd = open(uri.c_str(), O_CREAT | O_WRONLY, 0600);
+                        if ( -1 != fd ) {
+                            close(fd);
+                        }
+                    }
+                    rotated_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    settle(rearmed_count);
+                    rearmed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    // ... new watches must work ...
+                    for ( size_t idx = 0 ; idx < a_files ; ++idx ) {
+                        const std::string uri = dir + "/f" + std::to_string(idx);
+                        const int fd = open(uri.c_str(), O_WRONLY | O_APPEND);
+                        if ( -1 != fd ) {
+                            (void)write(fd, "x", 1);
+                            close(fd);
+                        }
+                    }
+                    settle(modified_count);
+                    done = true;
+                    reader.join();
+                    kill(getpid(), SIGTERM);
+                });
+                (void)api.Watch();
+                writer.join();
+                // ... report ...
+                printf("%zu files rotated in %.2f s, %zu re-armed %.2f s after rotation started, %zu written to and seen after\n",
+                       a_files, rotated_s, rearmed_count.load(), rearmed_s, modified_count.load()
+                );
+                printf("queue overflows %llu, ring frames lost %llu\n",
+                       static_cast<unsigned long long>(api.stats_.overflows_.load()), static_cast<unsigned long long>(lost.load())
+                );
+                for ( size_t idx = 0 ; idx < a_files ; ++idx ) {
+                    (void)unlink(( dir + "/f" + std::to_string(idx) ).c_str());
+                }
+                Clean(base, dir);
+                if ( rearmed_count != a_files || modified_count != a_files ) {
+                    throw inotify::Exception("%zu file(s) were not re-armed!", a_files - std::min<size_t>(rearmed_count, modified_count));
+                }
+            }
+
+        }; // end of class 'Bench'
+
+        volatile uintptr_t Bench::s_sink_ = 0;
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+int main (int a_argc, char** a_argv)
+{
+    const char* const mode = ( a_argc > 1 ? a_argv[1] : "" );
+    try {
+        if ( 0 == strcmp(mode, "lookup") ) {
+            casper::inotify::Bench::Lookup(a_argc > 2 ? strtoull(a_argv[2], nullptr, 10) : 10000000);
+        } else if ( 0 == strcmp(mode, "render") ) {
+            casper::inotify::Bench::Render(a_argc > 2 ? strtoull(a_argv[2], nullptr, 10) : 500000);
+        } else if ( 0 == strcmp(mode, "launch") ) {
+            casper::inotify::Bench::Launch(a_argc > 2 ? strtoull(a_argv[2], nullptr, 10) : 2000,
+                                           a_argc > 3 ? static_cast<size_t>(strtoull(a_argv[3], nullptr, 10)) : 256);
+        } else if ( 0 == strcmp(mode, "latency") ) {
+            casper::inotify::Bench::Latency(a_argc > 2 ? static_cast<size_t>(strtoull(a_argv[2], nullptr, 10)) : 500);
+        } else if ( 0 == strcmp(mode, "now") ) {
+            casper::inotify::Bench::Now(a_argc > 2 ? strtoull(a_argv[2], nullptr, 10) : 10000000);
+        } else if ( 0 == strcmp(mode, "rotate") ) {
+            casper::inotify::Bench::Rotate(a_argc > 2 ? static_cast<size_t>(strtoull(a_argv[2], nullptr, 10)) : 50000);
+        } else {
+            fprintf(stderr, "usage: %s lookup [lookups] | render [renders] | launch [launches] [rss MB] | latency [events] | now [calls] | rotate [files]\n", a_argv[0]);
+            return -1;
+        }
+    } catch (const casper::inotify::Exception& a_e) {
+        fprintf(stderr, "%s\n", a_e.what());
+        return -1;
+    } catch (const std::exception& a_e) {
+        fprintf(stderr, "%s\n", a_e.what());
+        return -1;
+    }
+    return 0;
+}
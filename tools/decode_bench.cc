@@ -0,0 +1,187 @@
+/**
+ * @file decode_bench.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @brief Heap allocations and time per event of API::Decode, over full inotify read buffers.
+ *
+ * malloc(3) family and operator new are replaced by counting versions, only allocations made by the thread
+ * that decodes are counted, so it should report none:
+ *
+ *     g++ -std=c++11 -O2 -Isrc -I/usr/include/jsoncpp tools/decode_bench.cc $(find src -name '*.cc' ! -name main.cc) -ljsoncpp -lpthread -ldl -o decode_bench
+ *     ./decode_bench [buffers]
+ */
+
+#include "api.h"
+
+#include <new>
+#include <chrono>
+
+#include "exception.h"
+
+#include <stdio.h>
+#include <stdlib.h> // strtoull
+#include <string.h> // memset
+
+#include <sys/inotify.h>
+
+extern "C" void* __libc_malloc  (size_t);
+extern "C" void* __libc_calloc  (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void  __libc_free    (void*);
+
+static thread_local bool s_counting_ = false; //!< Set, on decoding thread, while decoding.
+static uint64_t          s_allocations_ = 0;  //!< Made while counting.
+
+extern "C" void* malloc (size_t a_size)
+{
+    if ( true == s_counting_ ) {
+        s_allocations_++;
+    }
+    return __libc_malloc(a_size);
+}
+
+extern "C" void* calloc (size_t a_count, size_t a_size)
+{
+    if ( true == s_counting_ ) {
+        s_allocations_++;
+    }
+    return __libc_calloc(a_count, a_size);
+}
+
+extern "C" void* realloc (void* a_ptr, size_t a_size)
+{
+    if ( true == s_counting_ ) {
+        s_allocations_++;
+    }
+    return __libc_realloc(a_ptr, a_size);
+}
+
+extern "C" void free (void* a_ptr)
+{
+    __libc_free(a_ptr);
+}
+
+void* operator new (size_t a_size)
+{
+    void* ptr = malloc(0 != a_size ? a_size : 1);
+    if ( nullptr == ptr ) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[] (size_t a_size)
+{
+    return operator new(a_size);
+}
+
+void operator delete (void* a_ptr) noexcept
+{
+    free(a_ptr);
+}
+
+void operator delete[] (void* a_ptr) noexcept
+{
+    free(a_ptr);
+}
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Decodes full read buffers, as Watch would.
+         */
+        class DecodeBench final
+        {
+
+        public: // Static Method(s) / Function(s)
+
+            /**
+             * @param a_buffers Number of times buffer is decoded.
+             */
+            static void Run (const uint64_t a_buffers)
+            {
+                API api;
+                // ... as Add builds it, anything not given is what a configured entry defaults to ...
+                API::Entry* entry = new API::Entry(API::Type::_Directory, "/var/spool/casper-inotify-decode-bench", IN_ALL_EVENTS);
+                entry->wd_ = 1;
+                // ... IN_MAX_EVENTS_PER_LOOP events, names padded as the kernel does ...
+                const uint32_t masks[] = {
+                    IN_CREATE, IN_MODIFY, IN_CLOSE_WRITE, IN_MOVED_FROM, IN_MOVED_TO, IN_DELETE, IN_CREATE | IN_ISDIR, IN_ATTRIB
+                };
+                char*  buffer = new char[IN_MAX_EVENTS_PER_LOOP * ( IN_STRUCT_EVENT_SIZE + 32 )];
+                size_t length = 0;
+                for ( size_t idx = 0 ; idx < IN_MAX_EVENTS_PER_LOOP ; ++idx ) {
+                    struct inotify_event* event = reinterpret_cast<struct inotify_event*>(buffer + length);
+                    event->wd     = entry->wd_;
+                    event->mask   = masks[idx % ( sizeof(masks) / sizeof(masks[0]) )];
+                    event->cookie = 0;
+                    event->len    = 32;
+                    memset(event->name, 0, event->len);
+                    snprintf(event->name, event->len, "file-%04zu.dat", idx);
+                    length += IN_STRUCT_EVENT_SIZE + event->len;
+                }
+                // ... once, so per thread caches are warm, as they are on a running shard ...
+                API::Event e;
+                api.Decode(IN_CREATE, "warm-up", *entry, e);
+                uint64_t events = 0;
+                s_counting_ = true;
+                const auto start = std::chrono::steady_clock::now();
+                for ( uint64_t round = 0 ; round < a_buffers ; ++round ) {
+                    for ( size_t offset = 0 ; offset < length ; ) {
+                        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                        api.Decode(event->mask, event->len > 0 ? event->name : nullptr, *entry, e);
+                        offset += IN_STRUCT_EVENT_SIZE + event->len;
+                        events++;
+                    }
+                }
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                s_counting_ = false;
+                printf("%llu events, %llu buffer(s) of %zu bytes\n", static_cast<unsigned long long>(events), static_cast<unsigned long long>(a_buffers), length);
+                printf("allocations: %llu\n", static_cast<unsigned long long>(s_allocations_));
+                printf("decode     : %.1f ns/event\n", seconds * 1e9 / static_cast<double>(events));
+                delete [] buffer;
+                delete entry;
+            }
+
+        }; // end of class 'DecodeBench'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+int main (int a_argc, char** a_argv)
+{
+    const uint64_t buffers = ( a_argc > 1 ? strtoull(a_argv[1], nullptr, 10) : 1000 );
+    try {
+        casper::inotify::DecodeBench::Run(buffers);
+    } catch (const casper::inotify::Exception& a_e) {
+        fprintf(stderr, "%s\n", a_e.what());
+        return -1;
+    } catch (const std::exception& a_e) {
+        fprintf(stderr, "%s\n", a_e.what());
+        return -1;
+    }
+    return 0;
+}
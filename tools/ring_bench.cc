@@ -0,0 +1,158 @@
+/**
+ * @file ring_bench.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @brief Events ring throughput, in events per second, of one producer and a number of readers.
+ *
+ * Producer publishes as fast as it can, readers follow it from other threads, through the same socket and
+ * shared memory a daemon would hand them:
+ *
+ *     g++ -std=c++11 -O2 -Isrc -Itools tools/ring_bench.cc tools/ring_reader.cc src/ring.cc src/stream.cc -lpthread -o ring_bench
+ *     ./ring_bench [events] [readers] [slots] [slot size]
+ */
+
+#include "ring.h"
+#include "ring_reader.h"
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include "exception.h"
+
+#include <stdio.h>
+#include <stdlib.h> // strtoull
+#include <string.h> // memset
+#include <unistd.h> // getpid, close
+
+#include <sys/epoll.h>
+#include <sys/inotify.h> // IN_CREATE
+
+typedef struct {
+    uint64_t read_;    //!< Intact frames.
+    uint64_t lost_;
+    uint64_t bad_;     //!< Intact frames with unexpected contents.
+    double   seconds_;
+} Result;
+
+int main (int a_argc, char** a_argv)
+{
+    const uint64_t events    = ( a_argc > 1 ? strtoull(a_argv[1], nullptr, 10) : 10000000 );
+    const size_t   readers   = ( a_argc > 2 ? static_cast<size_t>(strtoull(a_argv[2], nullptr, 10)) : 1 );
+    const size_t   slots     = ( a_argc > 3 ? static_cast<size_t>(strtoull(a_argv[3], nullptr, 10)) : RING_DEFAULT_SLOTS );
+    const size_t   slot_size = ( a_argc > 4 ? static_cast<size_t>(strtoull(a_argv[4], nullptr, 10)) : RING_DEFAULT_SLOT_SIZE );
+    const std::string uri    = "/tmp/casper-inotify-ring-bench." + std::to_string(getpid());
+
+    casper::inotify::Ring ring;
+    std::atomic<bool>     stop(false);
+    std::atomic<uint64_t> last(0); // ... sequence of last frame, once all were published ...
+    std::vector<Result>   results(readers);
+    std::vector<std::thread> threads;
+    try {
+        // ... producer side, readers are accepted from a thread of it's own like the daemon's main loop ...
+        const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        ring.Open(uri, slots, slot_size, epoll_fd);
+        threads.push_back(std::thread([&ring, &stop, epoll_fd] () {
+            struct epoll_event ev[8];
+            while ( false == stop ) {
+                const int count = epoll_wait(epoll_fd, ev, 8, 10);
+                for ( int n = 0 ; n < count ; ++n ) {
+                    ring.OnEvent(ev[n].data.fd, ev[n].events);
+                }
+            }
+        }));
+        // ... readers ...
+        std::atomic<size_t> connected(0);
+        for ( size_t idx = 0 ; idx < readers ; ++idx ) {
+            threads.push_back(std::thread([&, idx] () {
+                casper::inotify::RingReader reader;
+                Result& result = results[idx];
+                memset(&result, 0, sizeof(result));
+                try {
+                    reader.Connect(uri);
+                } catch (const casper::inotify::Exception& a_e) {
+                    fprintf(stderr, "%s\n", a_e.what());
+                    return;
+                }
+                connected.fetch_add(1);
+                const auto start = std::chrono::steady_clock::now();
+                uint64_t   seen  = 0;
+                while ( 0 == last.load(std::memory_order_acquire) || seen < last.load(std::memory_order_acquire) ) {
+                    const casper::inotify::RingReader::Frame* frame = reader.Peek();
+                    if ( nullptr == frame ) {
+                        if ( 0 != last.load(std::memory_order_acquire) && 0 == reader.backlog() ) {
+                            break;
+                        }
+                        (void)reader.Wait(10);
+                        continue;
+                    }
+                    const uint64_t sequence = frame->header_.sequence_;
+                    const bool     good     = ( 4 == frame->header_.entry_length_ && 0 == memcmp(frame->entry_, "/tmp", 4) );
+                    if ( true == reader.Release() ) {
+                        result.read_ += 1;
+                        result.bad_  += ( true == good ? 0 : 1 );
+                        seen          = sequence;
+                    }
+                }
+                result.lost_    = reader.lost();
+                result.seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }));
+        }
+        while ( connected.load() < readers || ring.count() < readers ) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // ... publish ...
+        char name[32];
+        const auto start = std::chrono::steady_clock::now();
+        for ( uint64_t idx = 0 ; idx < events ; ++idx ) {
+            snprintf(name, sizeof(name), "file-%llu", static_cast<unsigned long long>(idx % 1000));
+            ring.Publish({ IN_CREATE, true, "create", "/tmp", "/tmp", name, nullptr, "1970-01-01T00:00:00+0000" });
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        last.store(ring.published(), std::memory_order_release);
+        for ( size_t idx = 1 ; idx < threads.size() ; ++idx ) {
+            threads[idx].join();
+        }
+        stop = true;
+        threads[0].join();
+        ring.Close();
+        close(epoll_fd);
+        // ... report ...
+        printf("%llu events, %zu slots of %zu bytes, %zu reader(s)\n", static_cast<unsigned long long>(events), slots, slot_size, readers);
+        printf("producer : %12.0f events/s\n", static_cast<double>(events) / seconds);
+        for ( size_t idx = 0 ; idx < readers ; ++idx ) {
+            const Result& result = results[idx];
+            printf("reader %-2zu: %12.0f events/s, %llu read, %llu lost, %llu bad\n", idx,
+                   result.seconds_ > 0 ? static_cast<double>(result.read_) / result.seconds_ : 0.0,
+                   static_cast<unsigned long long>(result.read_), static_cast<unsigned long long>(result.lost_),
+                   static_cast<unsigned long long>(result.bad_));
+        }
+    } catch (const casper::inotify::Exception& a_e) {
+        fprintf(stderr, "%s\n", a_e.what());
+        stop = true;
+        for ( auto& thread : threads ) {
+            thread.join();
+        }
+        return -1;
+    }
+    return 0;
+}
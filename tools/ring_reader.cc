@@ -0,0 +1,307 @@
+/**
+ * @file ring_reader.cc
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ring_reader.h"
+
+#include <vector>
+#include <chrono>
+
+#include "exception.h"
+
+#include <string.h> // strerror, memset, memcpy
+#include <errno.h>
+#include <unistd.h> // close, read
+#include <poll.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+
+/**
+ * @brief Default constructor.
+ */
+casper::inotify::RingReader::RingReader ()
+{
+    socket_    = -1;
+    doorbell_  = -1;
+    size_      = 0;
+    header_    = nullptr;
+    control_   = nullptr;
+    base_      = nullptr;
+    index_     = 0;
+    mask_      = 0;
+    slot_size_ = 0;
+    cursor_    = 0;
+    head_      = 0;
+    lost_      = 0;
+    slot_      = nullptr;
+    memset(&frame_, 0, sizeof(frame_));
+}
+
+/**
+ * @brief Destructor.
+ */
+casper::inotify::RingReader::~RingReader ()
+{
+    Disconnect();
+}
+
+/**
+ * @brief Connect to a producer and map it's ring; only frames published from now on will be read.
+ *
+ * @param a_uri Producer's unix socket path.
+ */
+void casper::inotify::RingReader::Connect (const std::string& a_uri)
+{
+    Disconnect();
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if ( a_uri.length() >= sizeof(address.sun_path) ) {
+        throw inotify::Exception("Ring socket path '%s' is too long!", a_uri.c_str());
+    }
+    strncpy(address.sun_path, a_uri.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if ( fd < 0 ) {
+        throw inotify::Exception("An error occurred while creating ring socket: %d - %s", errno, strerror(errno));
+    }
+    if ( 0 != connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) ) {
+        const int no = errno;
+        close(fd);
+        throw inotify::Exception("An error occurred while connecting to ring '%s': %d - %s", a_uri.c_str(), no, strerror(no));
+    }
+    // ... hello, with shared memory and doorbell ...
+    RingHello     hello;
+    int           fds[2] = { -1, -1 };
+    char          control[CMSG_SPACE(sizeof(fds))];
+    struct iovec  iov = { &hello, sizeof(hello) };
+    struct msghdr msg;
+    memset(&hello, 0, sizeof(hello));
+    memset(control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t rv = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    for ( struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg) ; nullptr != cmsg ; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+        if ( SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type && CMSG_LEN(sizeof(fds)) == cmsg->cmsg_len ) {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        }
+    }
+    const auto fail = [&] (const char* const a_why) {
+        for ( const int other : fds ) {
+            if ( -1 != other ) {
+                close(other);
+            }
+        }
+        close(fd);
+        throw inotify::Exception("Unable to connect to ring '%s': %s!", a_uri.c_str(), a_why);
+    };
+    if ( static_cast<ssize_t>(sizeof(hello)) != rv || -1 == fds[0] || -1 == fds[1] ) {
+        fail("invalid hello");
+    }
+    if ( RING_MAGIC != hello.magic_ || RING_VERSION != hello.version_ ) {
+        fail("unsupported version");
+    }
+    if ( hello.index_ >= RING_MAX_READERS || 0 == hello.slots_ || 0 != ( hello.slots_ & ( hello.slots_ - 1 ) ) || hello.slot_size_ < sizeof(RingSlot) + sizeof(StreamFrame)
+        || hello.size_ != RING_HEADER_SIZE + static_cast<uint64_t>(hello.slots_) * hello.slot_size_ ) {
+        fail("invalid geometry");
+    }
+    // ... all read only, but for the header page ...
+    void* memory = mmap(nullptr, static_cast<size_t>(hello.size_), PROT_READ, MAP_SHARED, fds[0], 0);
+    if ( MAP_FAILED == memory ) {
+        fail(strerror(errno));
+    }
+    void* writable = mmap(nullptr, RING_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if ( MAP_FAILED == writable ) {
+        munmap(memory, static_cast<size_t>(hello.size_));
+        fail(strerror(errno));
+    }
+    // ... mappings outlive the shared memory file descriptor ...
+    close(fds[0]);
+    socket_    = fd;
+    doorbell_  = fds[1];
+    size_      = static_cast<size_t>(hello.size_);
+    header_    = static_cast<const RingHeader*>(memory);
+    control_   = static_cast<RingHeader*>(writable);
+    base_      = static_cast<const uint8_t*>(memory) + RING_HEADER_SIZE;
+    index_     = hello.index_;
+    mask_      = hello.slots_ - 1;
+    slot_size_ = hello.slot_size_;
+    head_      = header_->head_.load(std::memory_order_acquire);
+    cursor_    = head_ + 1;
+    lost_      = 0;
+    slot_      = nullptr;
+}
+
+/**
+ * @brief Disconnect from producer and unmap it's ring.
+ */
+void casper::inotify::RingReader::Disconnect ()
+{
+    if ( -1 != socket_ ) {
+        close(socket_);
+        socket_ = -1;
+    }
+    if ( -1 != doorbell_ ) {
+        close(doorbell_);
+        doorbell_ = -1;
+    }
+    if ( nullptr != control_ ) {
+        munmap(control_, RING_HEADER_SIZE);
+        control_ = nullptr;
+    }
+    if ( nullptr != header_ ) {
+        munmap(const_cast<RingHeader*>(header_), size_);
+        header_ = nullptr;
+        base_   = nullptr;
+    }
+    slot_ = nullptr;
+}
+
+/**
+ * @return Next frame, in place, nullptr if there's none; it must be released before peeking again.
+ *
+ * @note Frames overwritten before being read are skipped and counted as lost.
+ */
+const casper::inotify::RingReader::Frame* casper::inotify::RingReader::Peek ()
+{
+    if ( nullptr != slot_ ) {
+        return &frame_;
+    }
+    if ( nullptr == header_ ) {
+        return nullptr;
+    }
+    const size_t capacity = slot_size_ - sizeof(RingSlot);
+    while ( true ) {
+        // ... producer's cache line is only touched when we caught up with what we know of, or were lapped ...
+        if ( cursor_ > head_ ) {
+            head_ = header_->head_.load(std::memory_order_acquire);
+            if ( cursor_ > head_ ) {
+                return nullptr;
+            }
+        }
+        const RingSlot* slot = reinterpret_cast<const RingSlot*>(base_ + ( cursor_ & mask_ ) * slot_size_);
+        if ( cursor_ != slot->sequence_.load(std::memory_order_acquire) ) {
+            // ... being or already overwritten, skip what's gone ...
+            head_ = header_->head_.load(std::memory_order_acquire);
+            if ( head_ - cursor_ > mask_ ) {
+                lost_   += head_ - mask_ - cursor_;
+                cursor_  = head_ - mask_;
+            } else {
+                ++lost_;
+                ++cursor_;
+            }
+            continue;
+        }
+        const char* payload = reinterpret_cast<const char*>(slot + 1);
+        memcpy(&frame_.header_, payload, sizeof(frame_.header_));
+        const StreamFrame& header = frame_.header_;
+        if ( sizeof(header) + header.entry_length_ + header.parent_length_ + header.name_length_ + header.old_name_length_ > capacity ) {
+            // ... torn, only possible if overwritten while copying ...
+            ++lost_;
+            ++cursor_;
+            continue;
+        }
+        frame_.entry_    = payload + sizeof(header);
+        frame_.parent_   = frame_.entry_ + header.entry_length_;
+        frame_.name_     = frame_.parent_ + header.parent_length_;
+        frame_.old_name_ = frame_.name_ + header.name_length_;
+        slot_            = slot;
+        return &frame_;
+    }
+}
+
+/**
+ * @brief Done with frame returned by \link RingReader::Peek \link, move on to the next one.
+ *
+ * @return True when frame was not overwritten while it was being used, false if it must be discarded.
+ */
+bool casper::inotify::RingReader::Release ()
+{
+    if ( nullptr == slot_ ) {
+        return false;
+    }
+    // ... reads of the frame happen before the sequence is checked again ...
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool intact = ( cursor_ == slot_->sequence_.load(std::memory_order_relaxed) );
+    if ( false == intact ) {
+        ++lost_;
+    }
+    ++cursor_;
+    slot_ = nullptr;
+    return intact;
+}
+
+/**
+ * @brief Wait for frames to read.
+ *
+ * @param a_timeout_ms Milliseconds, -1 to wait forever, 0 to only check.
+ *
+ * @return True when there are frames to read, false on timeout or once producer is gone and all frames were read.
+ */
+bool casper::inotify::RingReader::Wait (const int a_timeout_ms)
+{
+    if ( nullptr == header_ ) {
+        return false;
+    }
+    if ( cursor_ <= header_->head_.load(std::memory_order_acquire) ) {
+        return true;
+    }
+    if ( -1 == socket_ || 0 == a_timeout_ms ) {
+        return false;
+    }
+    // ... announce we're going to sleep, then check one last time, see \link Ring::Publish \link ...
+    control_->sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(a_timeout_ms);
+    int        timeout  = a_timeout_ms;
+    while ( -1 != socket_ ) {
+        control_->waiting_[index_].store(1, std::memory_order_seq_cst);
+        if ( cursor_ <= header_->head_.load(std::memory_order_seq_cst) ) {
+            break;
+        }
+        struct pollfd fds[2];
+        fds[0] = { doorbell_, POLLIN, 0 };
+        fds[1] = { socket_, POLLIN | POLLRDHUP, 0 };
+        if ( poll(fds, 2, timeout) > 0 ) {
+            if ( 0 != ( fds[0].revents & POLLIN ) ) {
+                uint64_t value;
+                (void)read(doorbell_, &value, sizeof(value));
+            }
+            if ( 0 != fds[1].revents ) {
+                // ... producer is gone, frames already published can still be read ...
+                close(socket_);
+                socket_ = -1;
+            }
+        }
+        // ... a doorbell rung for an earlier sleep wakes us up for nothing ...
+        if ( a_timeout_ms > 0 ) {
+            timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+            if ( timeout <= 0 ) {
+                break;
+            }
+        }
+    }
+    control_->waiting_[index_].store(0, std::memory_order_relaxed);
+    control_->sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+    return ( cursor_ <= header_->head_.load(std::memory_order_acquire) );
+}
@@ -0,0 +1,135 @@
+/**
+ * @file ring_reader.h
+ *
+ * Copyright (c) 2011-2023 Cloudware S.A. All rights reserved.
+ *
+ * This file is part of casper-inotify.
+ *
+ * casper-inotify is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * casper-inotify is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with casper. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CASPER_INOTIFY_RING_READER_H_
+#define CASPER_INOTIFY_RING_READER_H_
+
+#include "ring.h" // from src/, layout shared with the producer
+
+#include <string>
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+namespace casper
+{
+
+    namespace inotify
+    {
+
+        /**
+         * @brief Reference reader for events published to a \link Ring \link.
+         *
+         * Frames are read in place, no system call or copy is involved unless the reader runs out of frames
+         * and decides to \link RingReader::Wait \link:
+         *
+         *     RingReader reader;
+         *     reader.Connect("/run/casper-inotify.ring");
+         *     while ( true == reader.Wait(-1) ) {
+         *         const RingReader::Frame* frame;
+         *         while ( nullptr != ( frame = reader.Peek() ) ) {
+         *             ... use frame, it's strings might change under our feet ...
+         *             if ( true == reader.Release() ) {
+         *                 ... it did not, act on it ...
+         *             }
+         *         }
+         *     }
+         *
+         * Not thread safe, each thread should have it's own reader.
+         */
+        class RingReader final
+        {
+
+        public: // Data Type(s)
+
+            typedef struct {
+                StreamFrame header_;   //!< Copy, lengths are checked to fit the slot.
+                const char* entry_;    //!< In shared memory, not NUL terminated.
+                const char* parent_;
+                const char* name_;
+                const char* old_name_;
+            } Frame;
+
+        private: // Data
+
+            int                socket_;    //!< Connection to producer, closed by it when it's gone.
+            int                doorbell_;  //!< eventfd, signaled by producer while we're sleeping.
+            size_t             size_;
+            const RingHeader*  header_;    //!< Read only mapping.
+            RingHeader*        control_;   //!< Writable mapping of the header page, for \link RingHeader::sleepers_ \link.
+            const uint8_t*     base_;      //!< First slot.
+            uint32_t           index_;     //!< Our \link RingHeader::waiting_ \link.
+            uint64_t           mask_;      //!< Slots - 1.
+            size_t             slot_size_;
+            uint64_t           cursor_;    //!< Sequence of next frame to read.
+            uint64_t           head_;      //!< Last \link RingHeader::head_ \link seen, reloaded only once it's reached.
+            uint64_t           lost_;      //!< Frames overwritten before they were read.
+            const RingSlot*    slot_;      //!< Slot of \link RingReader::frame_ \link, nullptr if none is being read.
+            Frame              frame_;
+
+        public: // Constructor(s) / Destructor
+
+            RingReader (const RingReader&) = delete;
+            RingReader (const RingReader&&) = delete;
+            RingReader();
+            virtual ~RingReader();
+
+        public: // Method(s) // Function(s)
+
+            void         Connect    (const std::string& a_uri);
+            void         Disconnect ();
+            const Frame* Peek       ();
+            bool         Release    ();
+            bool         Wait       (const int a_timeout_ms);
+
+        public: // Inline Method(s) // Function(s)
+
+            /**
+             * @return True while connected.
+             */
+            inline bool IsConnected () const
+            {
+                return -1 != socket_;
+            }
+
+            /**
+             * @return Number of frames lost, overwritten before they were read.
+             */
+            inline uint64_t lost () const
+            {
+                return lost_;
+            }
+
+            /**
+             * @return Number of frames published and not read yet, lost ones included.
+             */
+            inline uint64_t backlog () const
+            {
+                const uint64_t head = header_->head_.load(std::memory_order_acquire);
+                return ( head >= cursor_ ? head - cursor_ + 1 : 0 );
+            }
+
+        }; // end of class 'RingReader'
+
+    } // end of namespace 'inotify'
+
+} // end of namespace 'casper'
+
+#endif // CASPER_INOTIFY_RING_READER_H_